@@ -30,11 +30,80 @@
  *   by the remote server.  It was brought to my attention that this occurs when
  *   operating with client connection to HTTP servers. <CE>
  * - Added a MAC address parser and MAC to String Converter. <CE>
+ * V1.3
+ * - Added an optional DMA block transfer engine for the PSoC 5LP SPIM so that
+ *   _W51_WriteBlock() and _W51_ReadBlock() no longer poll the SPI per byte.
+ *   The end of each transfer is signalled by the nrq interrupt of the Rx DMA.
+ * - Added optional frame streaming for block transfers, which loads each frame
+ *   in a tight loop without the per-byte register access overhead, and builds
+ *   the next frame while the current one shifts.  The chip select is released
+ *   after every frame, as required by the W5100.
+ * - Added an interrupt driven asynchronous SPI job queue (_SpiSubmit()), which
+ *   loads one frame each time the SPI releases the chip select.
+ * - Added optional SPI frame and socket command counters (_GetBusStats()),
+ *   with bytes on the wire and modeled bus time at _SPI_CLOCK_KHZ.
+ * - Added an optional shadow register cache (_REG_CACHE) so that reads of driver
+ *   owned registers and writes of unchanged values do not use the SPI.
+ * - _SocketProcessConnections() reads the socket status once unless it closes
+ *   the socket.
+ * - Added an optional /INT driven socket event engine (_IntStart()), which
+ *   replaces the 1ms polling of the SEND and connection waits once it has
+ *   been attached; until then the driver polls the registers.
+ * - Added an optional socket event reactor (_Poll()) that dispatches registered
+ *   handlers for the events of all four sockets.  The Writable handler also
+ *   reports the SENDs which the blocking send functions waited for.
+ * - _ExecuteSocketCommand() polls the command register with a microsecond
+ *   backoff instead of 1ms delays, and added the non-blocking
+ *   _SocketCommandStart()/_SocketCommandDone() for the SEND_KEEP, DISCON and
+ *   LISTEN commands.
+ * - Added an optional asynchronous SEND (_ASYNC_SEND), so the send functions
+ *   return once the SEND is issued, and the next data is copied while the
+ *   previous SEND is in progress.  UDP destinations are only changed once
+ *   the previous SEND has completed.
+ * - Added _TcpWrite() and _TcpSendStream() to send data in pieces as transmit
+ *   memory becomes free, with no 2K limit.  With the asynchronous SEND,
+ *   _TcpWrite() copies data behind the SEND in progress rather than waiting.
+ * - Added a receive cursor (_RxBegin(), _RxPeek(), _RxFind(), _RxRead(),
+ *   _RxSkip(), _RxCommit()) to parse data in place in the receive buffer.
+ * - Added _TcpSendv() and _UdpSendv() to send a list of data segments with a
+ *   single SEND command.
+ * - Fixed _UdpSend() and _UdpReceive() checking for the ESTABLISHED status
+ *   rather than the UDP status of the socket.
+ * - Added an optional deferred RECV (_RECV_THRESHOLD), and _SocketRecvFlush().
+ * - Fixed _UdpReceive() skipping 8 bytes of packet data, and overrunning the
+ *   buffer with packets larger than the buffer length.
+ * - Added configurable socket buffer sizes (_TX_MEMORY, _RX_MEMORY and
+ *   _SetSocketMemory()), and fixed the buffer base address of sockets 1-3.
+ * - Added socket buffer occupancy profiling and _RebalanceMemory() to
+ *   re-assign the buffer memory from the measured demand (_MEM_PROFILE).
+ * - The Tx write and Rx read pointers are kept in the socket table, and the
+ *   free/received size registers are read in 3 frames rather than 4 or more
+ *   (2 frames when they read 0, as before).
+ * - Added _TcpListen(), _TcpAccept() and _TcpListenStop() to keep several
+ *   sockets listening on a port, re-armed when each connection is closed.
+ * - Added the non-blocking _TcpConnectStart() and _TcpConnectStatus().
+ *   _TcpConnect() now initializes its timeout and returns the result.
+ * - Added the connection manager, _ManageConnections(), which sends
+ *   keep-alive probes and reclaims idle and dead sockets (_IDLE_MANAGER).
+ * - _SetRetryTime(), _SetRetryCount() and the matching reads are public, with
+ *   build time defaults, and the retry time may be set from the measured
+ *   round trip time (_ADAPTIVE_RTO).
+ * - Added _SocketOpenOptions() and the _SocketSetMSS(), _SocketSetTOS(),
+ *   _SocketSetTTL() and _SocketGetOptions() socket options.
+ * - Added write coalescing (_COALESCE): _TcpPrint() and _TcpQueue() stage
+ *   data in the transmit buffer, sent by size, _TcpFlush() or _TcpFlushTimer().
+ * - Added _TcpPrintf(), which formats directly in to the transmit buffer.
+ * - Replaced the socket command, status and interrupt flag values with named
+ *   constants (_CMD_xxx, _SOCK_xxx, _IR_xxx).
+ * - Fixed _ParseMAC() advancing past each hex digit several times, which made
+ *   _Start() fall back to the default MAC address.
  */
 
 /* Cypress library includes */
 #include <cytypes.h>
 #include <cylib.h>
+/* V1.3: variable arguments for _TcpPrintf() */
+#include <stdarg.h>
 
 /*  include functions and types for the driver */
 #include "`$INSTANCE_NAME`.h"
@@ -48,17 +117,309 @@ typedef struct
 	uint8  Protocol;
 	uint8  SocketFlags;
 	uint16 SourcePort;
-	uint8  ServerFlag;
+	uint8  ServerFlag; /* V1.3: listener membership (_LISTENER_xxx) */
+	/*
+	 * V1.3: The driver is the only writer of the Tx write and Rx read
+	 * pointers, so they are kept here rather than read from the device.
+	 */
+	uint16 TxWritePtr;
+	uint16 RxReadPtr;
+	uint8  PointersValid;
+	uint8  OptionsSet; /* V1.3: MSS/TOS/TTL changed, restored on close */
 } `$INSTANCE_NAME`_SOCKET;
 
-#define `$INSTANCE_NAME`_SOCKET_TX_BASE(s)    ( 0x4000 + (s<<15) )
-#define `$INSTANCE_NAME`_SOCKET_RX_BASE(s)    ( 0x6000 + (s<<15) )
+/*
+ * V1.3: The socket buffer memory layout is calculated from the TMSR/RMSR
+ * settings.  (This also corrects the base address of sockets 1-3, which
+ * were previously calculated as (s<<15) rather than 2K apart.)
+ */
+static uint16 `$INSTANCE_NAME`_TxBufferBase[4];
+static uint16 `$INSTANCE_NAME`_TxBufferSize[4];
+static uint16 `$INSTANCE_NAME`_RxBufferBase[4];
+static uint16 `$INSTANCE_NAME`_RxBufferSize[4];
+
+#define `$INSTANCE_NAME`_SOCKET_TX_BASE(s)    ( `$INSTANCE_NAME`_TxBufferBase[s] )
+#define `$INSTANCE_NAME`_SOCKET_TX_SIZE(s)    ( `$INSTANCE_NAME`_TxBufferSize[s] )
+#define `$INSTANCE_NAME`_SOCKET_TX_MASK(s)    ( `$INSTANCE_NAME`_TxBufferSize[s] - 1 )
+#define `$INSTANCE_NAME`_SOCKET_RX_BASE(s)    ( `$INSTANCE_NAME`_RxBufferBase[s] )
+#define `$INSTANCE_NAME`_SOCKET_RX_SIZE(s)    ( `$INSTANCE_NAME`_RxBufferSize[s] )
+#define `$INSTANCE_NAME`_SOCKET_RX_MASK(s)    ( `$INSTANCE_NAME`_RxBufferSize[s] - 1 )
+
+/* V1.3: ServerFlag values of the sockets managed by _TcpListen() */
+#define `$INSTANCE_NAME`_LISTENER_NONE       ( 0 )
+#define `$INSTANCE_NAME`_LISTENER_WAITING    ( 1 )
+#define `$INSTANCE_NAME`_LISTENER_ACCEPTED   ( 2 )
 
 static `$INSTANCE_NAME`_SOCKET `$INSTANCE_NAME`_SocketConfig[4];
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+/* V1.3: socket buffer occupancy measured since the last rebalance */
+static `$INSTANCE_NAME`_MEMORY_PROFILE `$INSTANCE_NAME`_MemProfile[4];
+#endif
 static uint32 `$INSTANCE_NAME`_SubnetMask;
+/* V1.3: Sockets with a CONNECT in progress, which need the subnet mask set */
+static uint8 `$INSTANCE_NAME`_ConnectPending;
+/* V1.3: Result of the last CONNECT of each socket (_CONNECT_xxx) */
+static uint8 `$INSTANCE_NAME`_ConnectState[4];
+
+#if (`$INSTANCE_NAME`_COALESCE)
+/* V1.3: Bytes written to the transmit buffer of each socket, but not yet sent */
+static uint16 `$INSTANCE_NAME`_Staged[4];
+/* V1.3: Time (ms) since the oldest staged data of each socket was written */
+static uint16 `$INSTANCE_NAME`_StagedAge[4];
+#endif
+
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+/*
+ * V1.3: Bytes copied after the write pointer of each socket by _TcpWrite()
+ * while a SEND was in progress, which are committed by the next send.
+ */
+static uint16 `$INSTANCE_NAME`_TxCopied[4];
+#endif
+
+#if (`$INSTANCE_NAME`_POLL_ENABLE) && !(`$INSTANCE_NAME`_ASYNC_SEND)
+/*
+ * V1.3: Sockets on which a blocking SEND completed since the last _Poll().
+ * The wait consumes the SEND_OK flag, so it is recorded for the Writable
+ * handler.
+ */
+static uint8 `$INSTANCE_NAME`_SendReported;
+#endif
+
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+/* V1.3: smoothed round trip time of each socket (x8, 100us units), 0 before the first sample */
+static uint16 `$INSTANCE_NAME`_SmoothRtt[4];
+/* V1.3: round trip time variation of each socket (x4, 100us units) */
+static uint16 `$INSTANCE_NAME`_RttVar[4];
+/* V1.3: retransmission timeout of each socket (100us units) */
+static uint16 `$INSTANCE_NAME`_SocketRto[4];
+/* V1.3: value last written to the retry time register */
+static uint16 `$INSTANCE_NAME`_RetryTime;
+#endif
+
+#if (`$INSTANCE_NAME`_IDLE_MANAGER)
+/* V1.3: Time (ms) since data was last sent or read on each socket */
+static uint16 `$INSTANCE_NAME`_IdleTime[4];
+/* V1.3: Time (ms) since the last activity or keep-alive probe of each socket */
+static uint16 `$INSTANCE_NAME`_KeepTime[4];
+/* V1.3: Sockets seen ESTABLISHED by the connection manager */
+static uint8 `$INSTANCE_NAME`_Managed;
+/**
+ * \brief Record data activity on a socket for the connection manager
+ * \param socket the socket on which data was sent or read
+ */
+#define `$INSTANCE_NAME`_Activity(socket)   ( `$INSTANCE_NAME`_IdleTime[socket] = 0, `$INSTANCE_NAME`_KeepTime[socket] = 0 )
+#else
+#define `$INSTANCE_NAME`_Activity(socket)
+#endif
 
 static uint8 `$INSTANCE_NAME`_MAC[6]; /* V1.2: removed = {`$MAC`}; */
 
+#if (`$INSTANCE_NAME`_SPI_ASYNC)
+/* V1.3: Head of the asynchronous SPI job queue, NULL when the queue is idle */
+static `$INSTANCE_NAME`_SPI_JOB* volatile `$INSTANCE_NAME`_JobHead = NULL;
+/**
+ * \brief Wait for the asynchronous job queue to release the SPI
+ * Every synchronous access to the SPI waits for queued jobs to finish first.
+ * The queue is advanced by the SPI interrupt, so this never returns when it
+ * is called from a job callback (or any handler of the same or a higher
+ * priority) while jobs are queued.
+ */
+#define `$INSTANCE_NAME`_SpiAcquire()    while (`$INSTANCE_NAME`_JobHead != NULL) { }
+#else
+#define `$INSTANCE_NAME`_SpiAcquire()
+#endif
+
+#if (`$INSTANCE_NAME`_STATS_ENABLE)
+/* V1.3: SPI bus usage counters */
+static `$INSTANCE_NAME`_BUS_STATS `$INSTANCE_NAME`_BusStats;
+/**
+ * \brief Count SPI frames or socket commands
+ * \param field the counter to increment
+ * \param n the number of frames/commands to add
+ */
+#define `$INSTANCE_NAME`_Count(field,n)  ( `$INSTANCE_NAME`_BusStats.field += (n) )
+#else
+#define `$INSTANCE_NAME`_Count(field,n)
+#endif
+
+/* ======================================================================== */
+/* Shadow Register Cache */
+#if (`$INSTANCE_NAME`_REG_CACHE)
+/*
+ * V1.3: The cache holds the common registers (0x0000-0x002F) followed by the
+ * first 0x30 registers of each socket register block.  Each register is
+ * classified as:
+ *   VOLATILE - changed by the device, always accessed on the bus
+ *   OWNED    - only changed by the driver, reads are served from the cache
+ *              and writes of an unchanged value are skipped
+ *   WRITE    - written by the driver but may be updated by the device (such
+ *              as the peer address of an accepted connection), so reads are
+ *              always from the bus, and only unchanged writes are skipped
+ */
+#define `$INSTANCE_NAME`_REG_VOLATILE     ( 0 )
+#define `$INSTANCE_NAME`_REG_OWNED        ( 1 )
+#define `$INSTANCE_NAME`_REG_WRITE        ( 2 )
+
+#define `$INSTANCE_NAME`_CACHE_BLOCK      ( 0x30 )
+#define `$INSTANCE_NAME`_CACHE_SIZE       ( 5*`$INSTANCE_NAME`_CACHE_BLOCK )
+
+static const uint8 `$INSTANCE_NAME`_CommonRegClass[`$INSTANCE_NAME`_CACHE_BLOCK] = {
+	1,                  /* 0x00 MR */
+	1, 1, 1, 1,         /* 0x01 GAR */
+	1, 1, 1, 1,         /* 0x05 SUBR */
+	1, 1, 1, 1, 1, 1,   /* 0x09 SHAR */
+	1, 1, 1, 1,         /* 0x0F SIPR */
+	0, 0,               /* 0x13 reserved */
+	0,                  /* 0x15 IR */
+	1,                  /* 0x16 IMR */
+	1, 1,               /* 0x17 RTR */
+	1,                  /* 0x19 RCR */
+	1,                  /* 0x1A RMSR */
+	1,                  /* 0x1B TMSR */
+	0, 0,               /* 0x1C PATR */
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x1E reserved */
+	1,                  /* 0x28 PTIMER */
+	1,                  /* 0x29 PMAGIC */
+	0, 0, 0, 0,         /* 0x2A UIPR */
+	0, 0                /* 0x2E UPORT */
+};
+
+static const uint8 `$INSTANCE_NAME`_SocketRegClass[`$INSTANCE_NAME`_CACHE_BLOCK] = {
+	1,                  /* 0x00 Sn_MR */
+	0,                  /* 0x01 Sn_CR */
+	0,                  /* 0x02 Sn_IR */
+	0,                  /* 0x03 Sn_SR */
+	1, 1,               /* 0x04 Sn_PORT */
+	2, 2, 2, 2, 2, 2,   /* 0x06 Sn_DHAR */
+	2, 2, 2, 2,         /* 0x0C Sn_DIPR */
+	2, 2,               /* 0x10 Sn_DPORT */
+	2, 2,               /* 0x12 Sn_MSSR */
+	1,                  /* 0x14 Sn_PROTO */
+	1,                  /* 0x15 Sn_TOS */
+	1,                  /* 0x16 Sn_TTL */
+	0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x17 reserved */
+	0, 0,               /* 0x20 Sn_TX_FSR */
+	0, 0,               /* 0x22 Sn_TX_RD */
+	1, 1,               /* 0x24 Sn_TX_WR */
+	0, 0,               /* 0x26 Sn_RX_RSR */
+	1, 1,               /* 0x28 Sn_RX_RD */
+	0, 0, 0, 0, 0, 0    /* 0x2A reserved */
+};
+
+static uint8 `$INSTANCE_NAME`_RegCache[`$INSTANCE_NAME`_CACHE_SIZE];
+static uint8 `$INSTANCE_NAME`_RegValid[(`$INSTANCE_NAME`_CACHE_SIZE+7)>>3];
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Find the cache entry and register class of an address
+ * \param addr the device address
+ * \param *index pointer to the location to hold the cache index
+ * \returns the register class of the address
+ */
+static uint8 `$INSTANCE_NAME`_CacheClass(uint16 addr, uint16* index)
+{
+	uint16 offset;
+
+	if (addr < `$INSTANCE_NAME`_CACHE_BLOCK) {
+		*index = addr;
+		return( `$INSTANCE_NAME`_CommonRegClass[addr] );
+	}
+	else if ( (addr >= 0x0400) && (addr < 0x0800) ) {
+		offset = addr & 0x00FF;
+		if (offset < `$INSTANCE_NAME`_CACHE_BLOCK) {
+			*index = ( (((addr - 0x0400)>>8) + 1) * `$INSTANCE_NAME`_CACHE_BLOCK ) + offset;
+			return( `$INSTANCE_NAME`_SocketRegClass[offset] );
+		}
+	}
+	return( `$INSTANCE_NAME`_REG_VOLATILE );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Discard a range of cache entries
+ * \param index the first cache entry to discard
+ * \param length the number of entries to discard
+ */
+static void `$INSTANCE_NAME`_CacheInvalidate(uint16 index, uint16 length)
+{
+	while (length > 0) {
+		`$INSTANCE_NAME`_RegValid[index>>3] &= ~(1<<(index&0x07));
+		++index;
+		--length;
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Store a register value in the cache
+ * \param addr the device address of the register
+ * \param dat the value of the register
+ */
+static void `$INSTANCE_NAME`_CacheUpdate(uint16 addr, uint8 dat)
+{
+	uint16 index;
+
+	if (`$INSTANCE_NAME`_CacheClass(addr,&index) != `$INSTANCE_NAME`_REG_VOLATILE) {
+		`$INSTANCE_NAME`_RegCache[index] = dat;
+		`$INSTANCE_NAME`_RegValid[index>>3] |= (1<<(index&0x07));
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a register from the cache
+ * \param addr the device address of the register
+ * \param *dat pointer to the location to hold the value
+ * \returns 1 when the value was read from the cache, 0 when the bus must be read
+ */
+static uint8 `$INSTANCE_NAME`_CacheRead(uint16 addr, uint8* dat)
+{
+	uint16 index;
+
+	if ( (`$INSTANCE_NAME`_CacheClass(addr,&index) == `$INSTANCE_NAME`_REG_OWNED) &&
+		((`$INSTANCE_NAME`_RegValid[index>>3] & (1<<(index&0x07))) != 0) ) {
+		*dat = `$INSTANCE_NAME`_RegCache[index];
+		return( 1 );
+	}
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Process a register write through the cache
+ * \param addr the device address of the register
+ * \param dat the value to be written
+ * \returns 1 when the write may be skipped, 0 when it must be sent to the device
+ *
+ * A device reset (MR.RST) discards the whole cache, and the socket commands
+ * which re-initialize a socket (OPEN, LISTEN, CONNECT, DISCON and CLOSE)
+ * discard the cache of the socket register block.
+ */
+static uint8 `$INSTANCE_NAME`_CacheWrite(uint16 addr, uint8 dat)
+{
+	uint16 index;
+
+	if ( (addr == 0x0000) && ((dat & 0x80) != 0) ) {
+		`$INSTANCE_NAME`_CacheInvalidate(0, `$INSTANCE_NAME`_CACHE_SIZE);
+		return( 0 );
+	}
+	if ( (addr >= 0x0400) && (addr < 0x0800) && ((addr & 0x00FF) == 0x01) ) {
+		if ( (dat == `$INSTANCE_NAME`_CMD_OPEN) || (dat == `$INSTANCE_NAME`_CMD_LISTEN) ||
+			(dat == `$INSTANCE_NAME`_CMD_CONNECT) || (dat == `$INSTANCE_NAME`_CMD_DISCON) ||
+			(dat == `$INSTANCE_NAME`_CMD_CLOSE) ) {
+			`$INSTANCE_NAME`_CacheInvalidate( (((addr - 0x0400)>>8) + 1) * `$INSTANCE_NAME`_CACHE_BLOCK,
+				`$INSTANCE_NAME`_CACHE_BLOCK );
+		}
+		return( 0 );
+	}
+	if (`$INSTANCE_NAME`_CacheClass(addr,&index) == `$INSTANCE_NAME`_REG_VOLATILE) {
+		return( 0 );
+	}
+	if ( ((`$INSTANCE_NAME`_RegValid[index>>3] & (1<<(index&0x07))) != 0) &&
+		(`$INSTANCE_NAME`_RegCache[index] == dat) ) {
+		return( 1 );
+	}
+	`$INSTANCE_NAME`_RegCache[index] = dat;
+	`$INSTANCE_NAME`_RegValid[index>>3] |= (1<<(index&0x07));
+	return( 0 );
+}
+#endif
+
 /* ------------------------------------------------------------------------ */
 /* V1.2 HEX digit conversion tools for MAC Address parsing */
 #define `$INSTANCE_NAME`_ISXDIGIT(x) \
@@ -95,6 +456,12 @@ static uint8 `$INSTANCE_NAME`_MAC[6]; /* V1.2: removed = {`$MAC`}; */
  */
 #define `$INSTANCE_NAME`_SpiDone     (`$SPI_INSTANCE`_ReadTxStatus() & (`$SPI_INSTANCE`_STS_SPI_DONE | `$SPI_INSTANCE`_STS_SPI_IDLE))
 /* ------------------------------------------------------------------------ */
+/* V1.3: FIFO access used by the frame streaming functions */
+#define `$INSTANCE_NAME`_SpiRxCount        (`$SPI_INSTANCE`_GetRxBufferSize())
+#define `$INSTANCE_NAME`_SpiPut(x)         `$SPI_INSTANCE`_WriteTxData(x)
+#define `$INSTANCE_NAME`_SpiGet()          `$SPI_INSTANCE`_ReadRxData()
+#define `$INSTANCE_NAME`_SpiClearRx()      `$SPI_INSTANCE`_ClearRxBuffer()
+/* ------------------------------------------------------------------------ */
 /**
  * \brief Select the active SCB chip select connected to the W51
  *
@@ -131,6 +498,14 @@ static void `$INSTANCE_NAME`_W51_Select( void )
  */
 void `$INSTANCE_NAME`_W51_Write(uint16 addr, uint8 dat)
 {
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	/* V1.3: skip writes of unchanged values */
+	if (`$INSTANCE_NAME`_CacheWrite(addr,dat) != 0) {
+		return;
+	}
+#endif
+	`$INSTANCE_NAME`_SpiAcquire();
+	`$INSTANCE_NAME`_Count(WriteFrames,1);
 	/* V1.1: Wait for SPI operation to complete */
 	while( `$INSTANCE_NAME`_SpiDone == 0) {
 		CyDelayUs(1);
@@ -166,7 +541,18 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 {
 	uint32 dat;
 	uint32 count;
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	uint8 cached;
+#endif
 	
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	/* V1.3: serve driver owned registers from the cache */
+	if (`$INSTANCE_NAME`_CacheRead(addr,&cached) != 0) {
+		return( cached );
+	}
+#endif
+	`$INSTANCE_NAME`_SpiAcquire();
+	`$INSTANCE_NAME`_Count(ReadFrames,1);
 	/* V1.1: Wait for SPI operation to complete */
 	while( `$INSTANCE_NAME`_SpiDone == 0) {
 		CyDelayUs(1);
@@ -195,12 +581,17 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 	}
 	/* V1.1: End change */
 
+	/* V1.3: defined for the compiler, the frame always returns 4 bytes */
+	dat = 0;
 	count = `$SPI_INSTANCE`_GetRxBufferSize();
 	while( count > 0 )
 	{
 		dat = `$SPI_INSTANCE`_ReadRxData(); 
 		count = `$SPI_INSTANCE`_GetRxBufferSize();
 	}
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	`$INSTANCE_NAME`_CacheUpdate(addr, dat&0xFF);
+#endif
 	
 	return( dat&0xFF );
 }
@@ -228,6 +619,12 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 #define `$INSTANCE_NAME`_SpiDone    (`$SPI_INSTANCE`_ss0_m_Read())
 #endif
 /* ------------------------------------------------------------------------ */
+/* V1.3: FIFO access used by the frame streaming functions */
+#define `$INSTANCE_NAME`_SpiRxCount        (`$SPI_INSTANCE`_SpiUartGetRxBufferSize())
+#define `$INSTANCE_NAME`_SpiPut(x)         `$SPI_INSTANCE`_SpiUartWriteTxData(x)
+#define `$INSTANCE_NAME`_SpiGet()          `$SPI_INSTANCE`_SpiUartReadRxData()
+#define `$INSTANCE_NAME`_SpiClearRx()      `$SPI_INSTANCE`_SpiUartClearRxBuffer()
+/* ------------------------------------------------------------------------ */
 /**
  * \brief Select the active SCB chip select connected to the W51
  *
@@ -259,6 +656,14 @@ static void `$INSTANCE_NAME`_W51_Select( void )
  */
 void `$INSTANCE_NAME`_W51_Write(uint16 addr, uint8 dat)
 {
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	/* V1.3: skip writes of unchanged values */
+	if (`$INSTANCE_NAME`_CacheWrite(addr,dat) != 0) {
+		return;
+	}
+#endif
+	`$INSTANCE_NAME`_SpiAcquire();
+	`$INSTANCE_NAME`_Count(WriteFrames,1);
 	/* V1.1: Wait for SPI operation to complete */
 	while( `$INSTANCE_NAME`_SpiDone == 0) {
 		CyDelayUs(1);
@@ -292,7 +697,18 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 {
 	uint32 dat;
 	uint32 count;
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	uint8 cached;
+#endif
 	
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	/* V1.3: serve driver owned registers from the cache */
+	if (`$INSTANCE_NAME`_CacheRead(addr,&cached) != 0) {
+		return( cached );
+	}
+#endif
+	`$INSTANCE_NAME`_SpiAcquire();
+	`$INSTANCE_NAME`_Count(ReadFrames,1);
 	/* V1.1: Wait for SPI operation to complete */
 	while( `$INSTANCE_NAME`_SpiDone == 0) {
 		CyDelayUs(1);
@@ -320,12 +736,17 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 	}
 	/* V1.1: End change */
 
+	/* V1.3: defined for the compiler, the frame always returns 4 bytes */
+	dat = 0;
 	count = `$SPI_INSTANCE`_SpiUartGetRxBufferSize();
 	while( count > 0 )
 	{
 		dat = `$SPI_INSTANCE`_SpiUartReadRxData(); 
 		count = `$SPI_INSTANCE`_SpiUartGetRxBufferSize();
 	}
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	`$INSTANCE_NAME`_CacheUpdate(addr, dat&0xFF);
+#endif
 	
 	return( dat&0xFF );
 }
@@ -333,149 +754,708 @@ uint8 `$INSTANCE_NAME`_W51_Read(uint16 addr)
 #endif
 
 /* ======================================================================== */
-/* W5100 Register Access Primitaves */
-#if (1)
+/* Pipelined Frame Streaming */
+#if (`$INSTANCE_NAME`_SPI_PIPELINE)
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Write a MAC (hardware) address to a group of registers
- * \param addr The starting address of the registers/memory for the MAC address
- * \param *mac pointer to the array of bytes holding the MAC address.
+ * \brief Stream a block of frames to/from consecutive W5100 addresses
+ * \param op the W5100 opcode (READ_OP or WRITE_OP) for the transfer
+ * \param addr the starting address of the transfer
+ * \param *buffer pointer to the data to write, or the buffer for the read data
+ * \param length the number of bytes to transfer
+ *
+ * The W5100 has no burst mode, and requires that the chip select is raised
+ * after every 4 byte frame, so frames cannot be queued behind each other in
+ * the Tx FIFO.  Instead, the work for the next frame is overlapped with the
+ * current one: each frame is loaded in to the Tx FIFO in one go, and while it
+ * shifts, the next frame is built and the received bytes are drained (keeping
+ * only the last byte of each read frame).  The prepared frame is loaded as
+ * soon as the SPI has released the chip select.  This saves the per-frame
+ * call, cache and delay overhead of the byte-wise functions.
  */
-static void `$INSTANCE_NAME`_W51_SetMAC(uint16 addr, uint8 *mac)
+static void `$INSTANCE_NAME`_W51_StreamBlock(uint8 op, uint16 addr, uint8* buffer, uint16 length)
 {
-	uint32 index;
-	
-	for(index = 0;index<6;++index)
-	{
-		`$INSTANCE_NAME`_W51_Write(addr+index,mac[index]);
+	uint16 index;
+	uint8 rx;
+	uint8 dat;
+	uint8 frame[4];
+
+	/* Wait for any byte-wise operation to complete */
+	`$INSTANCE_NAME`_SpiAcquire();
+	if (op == `$INSTANCE_NAME`_READ_OP) {
+		`$INSTANCE_NAME`_Count(ReadFrames,length);
 	}
-}
-/* ------------------------------------------------------------------------ */
-/**
- * \brief Read a MAC (hardware) address from a set of registers.
- * \param addr the address from which the data will be read
- * \param *mac pointer to the array of bytes to hold the output mac address.
- */
-static void `$INSTANCE_NAME`_W51_GetMAC( uint16 addr, uint8* mac )
-{
-	uint32 index;
-	for(index=0;index<6;++index) {
-		mac[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
+	else {
+		`$INSTANCE_NAME`_Count(WriteFrames,length);
+	}
+	while( `$INSTANCE_NAME`_SpiDone == 0) {
+		CyDelayUs(1);
+	}
+	`$INSTANCE_NAME`_W51_Select();
+	`$INSTANCE_NAME`_SpiClearRx();
+
+	frame[0] = op;
+	frame[1] = (addr>>8)&0x00FF;
+	frame[2] = addr&0x00FF;
+	frame[3] = (op == `$INSTANCE_NAME`_WRITE_OP) ? buffer[0] : 0;
+	for(index=0;index<length;++index) {
+		`$INSTANCE_NAME`_SpiPut(frame[0]);
+		`$INSTANCE_NAME`_SpiPut(frame[1]);
+		`$INSTANCE_NAME`_SpiPut(frame[2]);
+		`$INSTANCE_NAME`_SpiPut(frame[3]);
+		++addr;
+		/* build the next frame while this one shifts */
+		if ((index+1) < length) {
+			frame[1] = (addr>>8)&0x00FF;
+			frame[2] = addr&0x00FF;
+			frame[3] = (op == `$INSTANCE_NAME`_WRITE_OP) ? buffer[index+1] : 0;
+		}
+		/* drain the received bytes, keeping the data byte of read frames */
+		rx = 0;
+		while (rx < 4) {
+			if (`$INSTANCE_NAME`_SpiRxCount != 0) {
+				dat = `$INSTANCE_NAME`_SpiGet();
+				if ( (rx == 3) && (op == `$INSTANCE_NAME`_READ_OP) ) {
+					buffer[index] = dat;
+				}
+				++rx;
+			}
+		}
+		/* the chip select must be released before the next frame */
+		while( `$INSTANCE_NAME`_SpiDone == 0) { }
 	}
 }
+#endif
+/* ======================================================================== */
+/* Interrupt Driven Asynchronous SPI Jobs */
+#if (`$INSTANCE_NAME`_SPI_ASYNC)
+static `$INSTANCE_NAME`_SPI_JOB* `$INSTANCE_NAME`_JobTail;
+static uint32 `$INSTANCE_NAME`_JobTx;
+static uint32 `$INSTANCE_NAME`_JobRx;
+static uint16 `$INSTANCE_NAME`_JobAddr;
+
+CY_ISR_PROTO(`$INSTANCE_NAME`_SpiIsr);
+/*
+ * The jobs are advanced by the end of frame interrupt, which is raised once
+ * the SPI has shifted the last byte of a frame and released the chip select:
+ * SPI done on the SCB, and the SPIM going idle (the same tx_interrupt source
+ * which requests the DMA frames).  The interrupt is only unmasked while a job
+ * is active, since synchronous transfers end frames too.  The SPIM interrupt
+ * is gated in the interrupt controller, so that the tx_interrupt terminal
+ * remains available as a DMA request.
+ */
+#if defined(CY_SCB_`$SPI_INSTANCE`_H)
+#define `$INSTANCE_NAME`_SpiDoneIntOn()    `$SPI_INSTANCE`_SetMasterInterruptMode(`$SPI_INSTANCE`_INTR_MASTER_SPI_DONE)
+#define `$INSTANCE_NAME`_SpiDoneIntOff()   `$SPI_INSTANCE`_SetMasterInterruptMode(0)
+#define `$INSTANCE_NAME`_SpiDoneIntClear() `$SPI_INSTANCE`_ClearMasterInterruptSource(`$SPI_INSTANCE`_INTR_MASTER_SPI_DONE)
+#else
+#define `$INSTANCE_NAME`_SpiDoneIntOn()    `$SPI_INSTANCE`_EnableTxInt()
+#define `$INSTANCE_NAME`_SpiDoneIntOff()   `$SPI_INSTANCE`_DisableTxInt()
+#define `$INSTANCE_NAME`_SpiDoneIntClear() CyIntClearPending(`$SPI_INSTANCE`_TX_ISR_NUMBER)
+#endif
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Write an IPv4 address to the device.
- * \param addr the address of the memory/registers to write the IPv4 Address
- * \param ip the IP address to write
+ * \brief Load the Tx FIFO with the next frame of the active job
+ *
+ * A frame is only loaded once every byte of the previous frame has been
+ * received.  This is called when the job begins, and from the end of frame
+ * interrupt, so the SPI has already released the chip select, which the
+ * W5100 requires after each 4 byte frame.
  */
-static void `$INSTANCE_NAME`_W51_SetIP( uint16 addr, uint32 ip )
+static void `$INSTANCE_NAME`_JobFill( void )
 {
+	`$INSTANCE_NAME`_SPI_JOB* job;
 	uint32 index;
-	uint8* buffer;
 
-	buffer = (uint8*)&ip;
-	for(index = 0;index<4;++index) {
-		`$INSTANCE_NAME`_W51_Write(addr+index,buffer[index]);
+	job = `$INSTANCE_NAME`_JobHead;
+	if ( (`$INSTANCE_NAME`_JobTx != `$INSTANCE_NAME`_JobRx) ||
+		(`$INSTANCE_NAME`_JobTx >= (((uint32)job->Length)<<2)) ) {
+		return;
 	}
+
+	index = `$INSTANCE_NAME`_JobTx>>2;
+	`$INSTANCE_NAME`_SpiPut(job->Op);
+	`$INSTANCE_NAME`_SpiPut((`$INSTANCE_NAME`_JobAddr>>8)&0x00FF);
+	`$INSTANCE_NAME`_SpiPut(`$INSTANCE_NAME`_JobAddr&0x00FF);
+	`$INSTANCE_NAME`_SpiPut((job->Op == `$INSTANCE_NAME`_WRITE_OP) ? job->Buffer[index] : 0);
+	++`$INSTANCE_NAME`_JobAddr;
+	`$INSTANCE_NAME`_JobTx += 4;
 }
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Read an IPv4 address from a set of registers
- * \param addr the address from which the IP address will be retrieved.
- * \returns the IP address read from the device.
+ * \brief Begin shifting the job at the head of the queue
  */
-static uint32 `$INSTANCE_NAME`_W51_GetIP( uint16 addr )
+static void `$INSTANCE_NAME`_JobBegin( void )
 {
-	uint8 buffer[4];
-	int index;
-	uint32* ip;
-	
-	ip = (uint32*) &buffer[0];
-	*ip = 0;
-	for(index=0;index<4;++index) {
-		buffer[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
-	}
-	return( *ip );
+	`$INSTANCE_NAME`_JobHead->Status = `$INSTANCE_NAME`_JOB_ACTIVE;
+	`$INSTANCE_NAME`_JobTx = 0;
+	`$INSTANCE_NAME`_JobRx = 0;
+	`$INSTANCE_NAME`_JobAddr = `$INSTANCE_NAME`_JobHead->Address;
+	`$INSTANCE_NAME`_W51_Select();
+	`$INSTANCE_NAME`_SpiClearRx();
+	/* discard the end of the last synchronous frame before the first job frame */
+	`$INSTANCE_NAME`_SpiDoneIntClear();
+	`$INSTANCE_NAME`_JobFill();
+	`$INSTANCE_NAME`_SpiDoneIntOn();
 }
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Write a 16-bit word to the device
- * \param addr the starting address to which the data will be written
- * \param val the 16-bit value to write
+ * \brief SPI end of frame interrupt handler for the asynchronous job queue
+ *
+ * Each interrupt drains the 4 bytes of the frame which has just ended in to
+ * the active job, then either loads the next frame and returns, or completes
+ * the job (calling the completion callback) and starts the next queued job.
+ * Nothing in the handler waits on the SPI.
  */
-static void `$INSTANCE_NAME`_W51_Write16( uint16 addr, uint16 val )
+CY_ISR(`$INSTANCE_NAME`_SpiIsr)
 {
-	`$INSTANCE_NAME`_W51_Write( addr, val>>8);
-	`$INSTANCE_NAME`_W51_Write( addr + 1, val&0x00FF);
+	`$INSTANCE_NAME`_SPI_JOB* job;
+	uint8 dat;
+
+	`$INSTANCE_NAME`_SpiDoneIntClear();
+	job = `$INSTANCE_NAME`_JobHead;
+	if (job == NULL) {
+		return;
+	}
+	while (`$INSTANCE_NAME`_SpiRxCount != 0) {
+		dat = `$INSTANCE_NAME`_SpiGet();
+		if ( ((`$INSTANCE_NAME`_JobRx&0x03) == 3) && (job->Op == `$INSTANCE_NAME`_READ_OP) ) {
+			job->Buffer[`$INSTANCE_NAME`_JobRx>>2] = dat;
+		}
+		++`$INSTANCE_NAME`_JobRx;
+	}
+	if (`$INSTANCE_NAME`_JobRx != `$INSTANCE_NAME`_JobTx) {
+		/* the frame has not ended, so the interrupt was left from before it began */
+		return;
+	}
+	if (`$INSTANCE_NAME`_JobRx < (((uint32)job->Length)<<2) ) {
+		`$INSTANCE_NAME`_JobFill();
+		return;
+	}
+	/* the job is complete, so move to the next job in the queue */
+	`$INSTANCE_NAME`_JobHead = job->Next;
+	job->Status = `$INSTANCE_NAME`_JOB_DONE;
+	if (job->Callback != NULL) {
+		job->Callback( job );
+	}
+	if (`$INSTANCE_NAME`_JobHead != NULL) {
+		`$INSTANCE_NAME`_JobBegin();
+	}
+	else {
+		/* the queue is empty, the bus returns to the synchronous functions */
+		`$INSTANCE_NAME`_SpiDoneIntOff();
+	}
 }
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Read a 16-bit value from the device
- * \param addr The starting address from which data will be read
- * \returns the 16-bit value read from the memory.
+ * \brief Connect the job queue interrupt handler to the SPI interrupt
+ *
+ * The SPIM must be configured with the internal Tx interrupt enabled (and
+ * 4-byte buffers), or the SCB with the internal interrupt enabled.  The
+ * handler replaces the interrupt handler supplied by the SPI component.  The
+ * end of frame interrupt is left masked until a job is submitted.
  */
-static uint16 `$INSTANCE_NAME`_W51_Read16( uint16 addr )
+static void `$INSTANCE_NAME`_SpiAsyncStart( void )
 {
-	uint16 val;
-	
-	val = `$INSTANCE_NAME`_W51_Read( addr );
-	val <<= 8;
-	val += `$INSTANCE_NAME`_W51_Read( addr + 1);
-	
-	return( val );
+#if defined(CY_SCB_`$SPI_INSTANCE`_H)
+	`$INSTANCE_NAME`_SpiDoneIntOff();
+	`$SPI_INSTANCE`_SetCustomInterruptHandler(`$INSTANCE_NAME`_SpiIsr);
+	`$SPI_INSTANCE`_EnableInt();
+#else
+	`$INSTANCE_NAME`_SpiDoneIntOff();
+	CyIntSetVector(`$SPI_INSTANCE`_TX_ISR_NUMBER, `$INSTANCE_NAME`_SpiIsr);
+	`$SPI_INSTANCE`_SetTxInterruptMode(`$SPI_INSTANCE`_STS_SPI_IDLE);
+#endif
 }
 /* ------------------------------------------------------------------------ */
-/**
- * \brief Write a block of data to consecutive memory addresses
- * \param addr the starting address of the write
- * \param *buffer pointer to the data buffer holding the data to write
- * \param length the length of data to be written
- */
-static void `$INSTANCE_NAME`_W51_WriteBlock(uint16 addr, uint8* buffer, uint16 length)
+cystatus `$INSTANCE_NAME`_SpiSubmit( `$INSTANCE_NAME`_SPI_JOB* job )
 {
-	int index;
-	for(index=0;index<length;++index) {
-		`$INSTANCE_NAME`_W51_Write(addr+index,buffer[index]);
+	uint8 state;
+
+	if ( (job == NULL) || (job->Buffer == NULL) || (job->Length == 0) ||
+		((job->Op != `$INSTANCE_NAME`_READ_OP) && (job->Op != `$INSTANCE_NAME`_WRITE_OP)) ) {
+		return( CYRET_BAD_PARAM );
+	}
+
+	job->Status = `$INSTANCE_NAME`_JOB_PENDING;
+	job->Next = NULL;
+#if (`$INSTANCE_NAME`_REG_CACHE)
+	/* jobs bypass the register cache, so discard it when registers are accessed */
+	if (job->Address < 0x0800) {
+		`$INSTANCE_NAME`_CacheInvalidate(0, `$INSTANCE_NAME`_CACHE_SIZE);
+	}
+#endif
+
+	state = CyEnterCriticalSection();
+	if (job->Op == `$INSTANCE_NAME`_READ_OP) {
+		`$INSTANCE_NAME`_Count(ReadFrames,job->Length);
+	}
+	else {
+		`$INSTANCE_NAME`_Count(WriteFrames,job->Length);
+	}
+	if (`$INSTANCE_NAME`_JobHead == NULL) {
+		/* the queue was idle, so wait for the last synchronous frame to finish */
+		while( `$INSTANCE_NAME`_SpiDone == 0) {
+			CyDelayUs(1);
+		}
+		`$INSTANCE_NAME`_JobHead = job;
+		`$INSTANCE_NAME`_JobTail = job;
+		`$INSTANCE_NAME`_JobBegin();
+	}
+	else {
+		`$INSTANCE_NAME`_JobTail->Next = job;
+		`$INSTANCE_NAME`_JobTail = job;
 	}
+	CyExitCriticalSection(state);
+
+	return( CYRET_STARTED );
 }
 /* ------------------------------------------------------------------------ */
-/**
- * \brief read a block of data from consecutive memory addresses
- * \param addr the address from which the read will begin
- * \param *buffer pointer to the memory buffer which will hold the read data
- * \param length the length of data to read from the buffer.
- */
-static void `$INSTANCE_NAME`_W51_ReadBlock(uint16 addr, uint8* buffer, uint16 length)
+uint8 `$INSTANCE_NAME`_SpiBusy( void )
 {
-	int index;
-	
-	for(index=0;index<length;++index) {
-		buffer[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
-	}
+	return( `$INSTANCE_NAME`_JobHead != NULL );
 }
-/* ======================================================================== */
-/* END SECTION */
 #endif
 /* ======================================================================== */
-/* Chip Register access */
-#if (1)
-// Common Registers
-/* ------------------------------------------------------------------------ */
-/**
- * \brief Set teh chip mac address to teh specified address
- * \param *mac pointer to the array holding the MAC address
+/* DMA Block Transfer Engine (PSoC 5LP SPIM) */
+#if (`$INSTANCE_NAME`_DMA_ENABLE) && (CY_PSOC5LP) && !defined(CY_SCB_`$SPI_INSTANCE`_H)
+#include <CyDmac.h>
+
+#define `$INSTANCE_NAME`_USE_DMA            ( 1 )
+
+static uint8 `$INSTANCE_NAME`_DmaTxChannel = CY_DMA_INVALID_CHANNEL;
+static uint8 `$INSTANCE_NAME`_DmaRxChannel = CY_DMA_INVALID_CHANNEL;
+static uint8 `$INSTANCE_NAME`_DmaTxTd = CY_DMA_INVALID_TD;
+static uint8 `$INSTANCE_NAME`_DmaRxTd = CY_DMA_INVALID_TD;
+static uint8 `$INSTANCE_NAME`_DmaIntNumber;
+/* V1.3: Set by the Rx channel nrq handler once a chunk has been captured */
+static volatile uint8 `$INSTANCE_NAME`_DmaDone;
+
+CY_ISR_PROTO(`$INSTANCE_NAME`_DmaIsr);
+/*
+ * The frame table holds the opcode/address/data frames sent to the W5100.
+ * The capture table holds the 4 bytes shifted in from the device during each
+ * frame, where the last byte of each read frame is the data.
  */
-static void `$INSTANCE_NAME`_SetSourceMAC( uint8* mac ) { `$INSTANCE_NAME`_W51_SetMAC(9,mac); }
+static uint8 `$INSTANCE_NAME`_DmaFrame[`$INSTANCE_NAME`_DMA_CHUNK*4];
+static uint8 `$INSTANCE_NAME`_DmaCapture[`$INSTANCE_NAME`_DMA_CHUNK*4];
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Read the chip source MAC address from the MAC registers
- * \param *mac pointer to the address of the buffer to hold the read MAC address
+ * \brief Interrupt handler for the nrq output of the Rx DMA channel
+ *
+ * The Rx channel raises nrq when its TD has captured the final byte of a
+ * chunk, so the transfer waits on this flag instead of reading the TD.
  */
-static void `$INSTANCE_NAME`_GetSourceMAC( uint8* mac ) { `$INSTANCE_NAME`_W51_GetMAC(9,mac); }
+CY_ISR(`$INSTANCE_NAME`_DmaIsr)
+{
+	`$INSTANCE_NAME`_DmaDone = 1;
+}
 /* ------------------------------------------------------------------------ */
-/**
- * \brief Set the IPv4 address of the network gateway
+cystatus `$INSTANCE_NAME`_DmaStart( uint8 txChannel, uint8 rxChannel, uint8 intNumber )
+{
+	cystatus result;
+
+	result = CYRET_BAD_PARAM;
+	if ( (txChannel != CY_DMA_INVALID_CHANNEL) && (rxChannel != CY_DMA_INVALID_CHANNEL) &&
+		(intNumber <= CY_INT_NUMBER_MAX) ) {
+		`$INSTANCE_NAME`_DmaStop();
+		`$INSTANCE_NAME`_DmaTxTd = CyDmaTdAllocate();
+		`$INSTANCE_NAME`_DmaRxTd = CyDmaTdAllocate();
+		if ( (`$INSTANCE_NAME`_DmaTxTd == CY_DMA_INVALID_TD) || (`$INSTANCE_NAME`_DmaRxTd == CY_DMA_INVALID_TD) ) {
+			`$INSTANCE_NAME`_DmaStop();
+			result = CYRET_MEMORY;
+		}
+		else {
+			/*
+			 * The Tx channel moves the frame table (SRAM) to the SPIM Tx FIFO,
+			 * one 4 byte frame per burst, and the Rx channel moves the Rx FIFO
+			 * to the capture table.  The Tx DRQ rises when the SPIM goes idle,
+			 * which is after the chip select has been released at the end of
+			 * each frame, so the next frame is never queued behind the current
+			 * one.  The Rx DRQ is asserted while there is data in the Rx FIFO.
+			 */
+			CyDmaChSetExtendedAddress(txChannel, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+			CyDmaChSetExtendedAddress(rxChannel, HI16(CYDEV_PERIPH_BASE), HI16(CYDEV_SRAM_BASE));
+			`$SPI_INSTANCE`_SetTxInterruptMode(`$SPI_INSTANCE`_STS_SPI_IDLE);
+			`$SPI_INSTANCE`_SetRxInterruptMode(`$SPI_INSTANCE`_STS_RX_FIFO_NOT_EMPTY);
+			`$INSTANCE_NAME`_DmaTxChannel = txChannel;
+			`$INSTANCE_NAME`_DmaRxChannel = rxChannel;
+			`$INSTANCE_NAME`_DmaIntNumber = intNumber;
+			CyIntDisable(intNumber);
+			CyIntSetVector(intNumber, `$INSTANCE_NAME`_DmaIsr);
+			CyIntClearPending(intNumber);
+			CyIntEnable(intNumber);
+			result = CYRET_SUCCESS;
+		}
+	}
+	return( result );
+}
+/* ------------------------------------------------------------------------ */
+void `$INSTANCE_NAME`_DmaStop( void )
+{
+	if (`$INSTANCE_NAME`_DmaTxChannel != CY_DMA_INVALID_CHANNEL) {
+		CyIntDisable(`$INSTANCE_NAME`_DmaIntNumber);
+		CyDmaChDisable(`$INSTANCE_NAME`_DmaTxChannel);
+		CyDmaChDisable(`$INSTANCE_NAME`_DmaRxChannel);
+	}
+	if (`$INSTANCE_NAME`_DmaTxTd != CY_DMA_INVALID_TD) {
+		CyDmaTdFree(`$INSTANCE_NAME`_DmaTxTd);
+	}
+	if (`$INSTANCE_NAME`_DmaRxTd != CY_DMA_INVALID_TD) {
+		CyDmaTdFree(`$INSTANCE_NAME`_DmaRxTd);
+	}
+	`$INSTANCE_NAME`_DmaTxChannel = CY_DMA_INVALID_CHANNEL;
+	`$INSTANCE_NAME`_DmaRxChannel = CY_DMA_INVALID_CHANNEL;
+	`$INSTANCE_NAME`_DmaTxTd = CY_DMA_INVALID_TD;
+	`$INSTANCE_NAME`_DmaRxTd = CY_DMA_INVALID_TD;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Transfer a block of consecutive W5100 addresses using the DMA
+ * \param op the W5100 opcode (READ_OP or WRITE_OP) for the transfer
+ * \param addr the starting address of the transfer
+ * \param *buffer pointer to the data to write, or the buffer for the read data
+ * \param length the number of bytes to transfer
+ * \returns 0 when the DMA engine is not started, otherwise non-zero
+ *
+ * The block is split in to chunks of DMA_CHUNK frames.  For each chunk, the
+ * frame table is built, then both channels are armed and the first frame is
+ * requested by the processor.  Each following frame is requested by the SPIM
+ * going idle at the end of the previous frame, so that the chip select is
+ * raised between frames as the W5100 requires.  Once the nrq interrupt of the
+ * Rx channel reports that the final byte has been captured, read data is
+ * picked out of the capture table.
+ */
+static uint8 `$INSTANCE_NAME`_DmaTransfer(uint8 op, uint16 addr, uint8* buffer, uint16 length)
+{
+	uint16 count;
+	uint16 index;
+	uint8* frame;
+
+	if (`$INSTANCE_NAME`_DmaTxChannel == CY_DMA_INVALID_CHANNEL) {
+		return( 0 );
+	}
+
+	/* Wait for any byte-wise operation to leave the SPIM */
+	`$INSTANCE_NAME`_SpiAcquire();
+	if (op == `$INSTANCE_NAME`_READ_OP) {
+		`$INSTANCE_NAME`_Count(ReadFrames,length);
+	}
+	else {
+		`$INSTANCE_NAME`_Count(WriteFrames,length);
+	}
+	while( `$INSTANCE_NAME`_SpiDone == 0) {
+		CyDelayUs(1);
+	}
+	`$INSTANCE_NAME`_W51_Select();
+	`$SPI_INSTANCE`_ClearRxBuffer();
+
+	while (length > 0) {
+		count = (length > `$INSTANCE_NAME`_DMA_CHUNK) ? `$INSTANCE_NAME`_DMA_CHUNK : length;
+		/* Build the frame table for this chunk */
+		frame = &`$INSTANCE_NAME`_DmaFrame[0];
+		for(index=0;index<count;++index) {
+			frame[0] = op;
+			frame[1] = (addr>>8)&0x00FF;
+			frame[2] = addr&0x00FF;
+			frame[3] = (op == `$INSTANCE_NAME`_WRITE_OP) ? buffer[index] : 0;
+			frame += 4;
+			++addr;
+		}
+		/*
+		 * Arm the Rx channel first so that no received byte is lost, then
+		 * request the first frame of the table.  The Rx TD ends the chain, so
+		 * the Rx channel raises nrq once the final byte has been captured.
+		 */
+		`$INSTANCE_NAME`_DmaDone = 0;
+		CyDmaTdSetConfiguration(`$INSTANCE_NAME`_DmaRxTd, count<<2, CY_DMA_DISABLE_TD, CY_DMA_TD_INC_DST_ADR);
+		CyDmaTdSetAddress(`$INSTANCE_NAME`_DmaRxTd, LO16((uint32)`$SPI_INSTANCE`_RXDATA_PTR), LO16((uint32)&`$INSTANCE_NAME`_DmaCapture[0]));
+		CyDmaTdSetConfiguration(`$INSTANCE_NAME`_DmaTxTd, count<<2, CY_DMA_DISABLE_TD, CY_DMA_TD_INC_SRC_ADR);
+		CyDmaTdSetAddress(`$INSTANCE_NAME`_DmaTxTd, LO16((uint32)&`$INSTANCE_NAME`_DmaFrame[0]), LO16((uint32)`$SPI_INSTANCE`_TXDATA_PTR));
+		CyDmaChSetInitialTd(`$INSTANCE_NAME`_DmaRxChannel, `$INSTANCE_NAME`_DmaRxTd);
+		CyDmaChSetInitialTd(`$INSTANCE_NAME`_DmaTxChannel, `$INSTANCE_NAME`_DmaTxTd);
+		CyDmaClearPendingDrq(`$INSTANCE_NAME`_DmaTxChannel);
+		CyDmaChEnable(`$INSTANCE_NAME`_DmaRxChannel, 0);
+		CyDmaChEnable(`$INSTANCE_NAME`_DmaTxChannel, 0);
+		CyDmaChSetRequest(`$INSTANCE_NAME`_DmaTxChannel, CPU_REQ);
+		/* wait for the final byte of the chunk to be captured, without touching the DMA controller */
+		while (`$INSTANCE_NAME`_DmaDone == 0) { }
+
+		if (op == `$INSTANCE_NAME`_READ_OP) {
+			for(index=0;index<count;++index) {
+				buffer[index] = `$INSTANCE_NAME`_DmaCapture[(index<<2)+3];
+			}
+		}
+		buffer += count;
+		length -= count;
+	}
+
+	return( 1 );
+}
+#elif (`$INSTANCE_NAME`_DMA_ENABLE)
+/* ------------------------------------------------------------------------ */
+/* The DMA engine is not supported by this device/SPI combination */
+cystatus `$INSTANCE_NAME`_DmaStart( uint8 txChannel, uint8 rxChannel, uint8 intNumber )
+{
+	(void)txChannel;
+	(void)rxChannel;
+	(void)intNumber;
+	return( CYRET_BAD_PARAM );
+}
+/* ------------------------------------------------------------------------ */
+void `$INSTANCE_NAME`_DmaStop( void )
+{
+}
+#endif
+/* ======================================================================== */
+/* SPI Bus Usage Counters */
+#if (`$INSTANCE_NAME`_STATS_ENABLE)
+/* ------------------------------------------------------------------------ */
+void `$INSTANCE_NAME`_GetBusStats( `$INSTANCE_NAME`_BUS_STATS* stats )
+{
+	uint8 state;
+	uint32 frames;
+
+	if (stats != NULL) {
+		state = CyEnterCriticalSection();
+		*stats = `$INSTANCE_NAME`_BusStats;
+		CyExitCriticalSection(state);
+		frames = stats->ReadFrames + stats->WriteFrames;
+		stats->Bytes = frames<<2;
+		/*
+		 * 32 bit clocks per frame.  The division is split to avoid overflowing
+		 * the 32-bit intermediate value for large frame counts.
+		 */
+		stats->BusTime = ((frames/`$INSTANCE_NAME`_SPI_CLOCK_KHZ)*32000) +
+			(((frames%`$INSTANCE_NAME`_SPI_CLOCK_KHZ)*32000)/`$INSTANCE_NAME`_SPI_CLOCK_KHZ);
+	}
+}
+/* ------------------------------------------------------------------------ */
+void `$INSTANCE_NAME`_ClearBusStats( void )
+{
+	uint8 state;
+
+	state = CyEnterCriticalSection();
+	`$INSTANCE_NAME`_BusStats.ReadFrames = 0;
+	`$INSTANCE_NAME`_BusStats.WriteFrames = 0;
+	`$INSTANCE_NAME`_BusStats.Commands = 0;
+	`$INSTANCE_NAME`_BusStats.CommandPolls = 0;
+	CyExitCriticalSection(state);
+}
+#endif
+/* ======================================================================== */
+/* W5100 Register Access Primitaves */
+#if (1)
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write a MAC (hardware) address to a group of registers
+ * \param addr The starting address of the registers/memory for the MAC address
+ * \param *mac pointer to the array of bytes holding the MAC address.
+ */
+static void `$INSTANCE_NAME`_W51_SetMAC(uint16 addr, uint8 *mac)
+{
+	uint32 index;
+	
+	for(index = 0;index<6;++index)
+	{
+		`$INSTANCE_NAME`_W51_Write(addr+index,mac[index]);
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a MAC (hardware) address from a set of registers.
+ * \param addr the address from which the data will be read
+ * \param *mac pointer to the array of bytes to hold the output mac address.
+ */
+static void `$INSTANCE_NAME`_W51_GetMAC( uint16 addr, uint8* mac )
+{
+	uint32 index;
+	for(index=0;index<6;++index) {
+		mac[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write an IPv4 address to the device.
+ * \param addr the address of the memory/registers to write the IPv4 Address
+ * \param ip the IP address to write
+ */
+static void `$INSTANCE_NAME`_W51_SetIP( uint16 addr, uint32 ip )
+{
+	uint32 index;
+	uint8* buffer;
+
+	buffer = (uint8*)&ip;
+	for(index = 0;index<4;++index) {
+		`$INSTANCE_NAME`_W51_Write(addr+index,buffer[index]);
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read an IPv4 address from a set of registers
+ * \param addr the address from which the IP address will be retrieved.
+ * \returns the IP address read from the device.
+ */
+static uint32 `$INSTANCE_NAME`_W51_GetIP( uint16 addr )
+{
+	uint8 buffer[4];
+	int index;
+	uint32* ip;
+	
+	ip = (uint32*) &buffer[0];
+	*ip = 0;
+	for(index=0;index<4;++index) {
+		buffer[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
+	}
+	return( *ip );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write a 16-bit word to the device
+ * \param addr the starting address to which the data will be written
+ * \param val the 16-bit value to write
+ */
+static void `$INSTANCE_NAME`_W51_Write16( uint16 addr, uint16 val )
+{
+	`$INSTANCE_NAME`_W51_Write( addr, val>>8);
+	`$INSTANCE_NAME`_W51_Write( addr + 1, val&0x00FF);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a 16-bit value from the device
+ * \param addr The starting address from which data will be read
+ * \returns the 16-bit value read from the memory.
+ */
+static uint16 `$INSTANCE_NAME`_W51_Read16( uint16 addr )
+{
+	uint16 val;
+	
+	val = `$INSTANCE_NAME`_W51_Read( addr );
+	val <<= 8;
+	val += `$INSTANCE_NAME`_W51_Read( addr + 1);
+	
+	return( val );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a consistent value from a 16-bit register updated by the device
+ * \param addr The address of the high byte of the register
+ * \returns the 16-bit value read from the register.
+ *
+ * V1.3: The device may update the register between the reads of the two
+ * bytes.  Rather than reading the whole register until two reads match,
+ * the high byte is read again after the low byte: when it has not changed,
+ * the value is consistent.  This takes 3 frames instead of 4 or more.  A
+ * value of 0 (the common empty receive poll) is returned after 2 frames, as
+ * it was before: at worst it hides a change which the next read reports.
+ *
+ * The value may be stale by the time it is used, so callers must tolerate
+ * it: a size may have grown since, or the socket may have been reset and
+ * its buffer emptied.  Arithmetic on it against driver state must not wrap,
+ * see _GetTxFreeSize() and _GetRxSize().
+ */
+static uint16 `$INSTANCE_NAME`_W51_ReadCounter16( uint16 addr )
+{
+	uint8 high;
+	uint8 low;
+	uint8 check;
+	
+	high = `$INSTANCE_NAME`_W51_Read( addr );
+	low = `$INSTANCE_NAME`_W51_Read( addr + 1 );
+	while ( (high != 0) || (low != 0) ) {
+		check = `$INSTANCE_NAME`_W51_Read( addr );
+		if (check == high) {
+			break;
+		}
+		high = check;
+		low = `$INSTANCE_NAME`_W51_Read( addr + 1 );
+	}
+	
+	return( ((uint16)high << 8) | low );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write a block of data to consecutive memory addresses
+ * \param addr the starting address of the write
+ * \param *buffer pointer to the data buffer holding the data to write
+ * \param length the length of data to be written
+ */
+static void `$INSTANCE_NAME`_W51_WriteBlock(uint16 addr, uint8* buffer, uint16 length)
+{
+#if !(`$INSTANCE_NAME`_SPI_PIPELINE)
+	int index;
+#endif
+
+#if defined(`$INSTANCE_NAME`_USE_DMA)
+	/* V1.3: Use the DMA engine when it has been started */
+	if (`$INSTANCE_NAME`_DmaTransfer(`$INSTANCE_NAME`_WRITE_OP, addr, buffer, length) != 0) {
+		return;
+	}
+#endif
+#if (`$INSTANCE_NAME`_SPI_PIPELINE)
+	/* V1.3: stream the frames, building each one while the previous one shifts */
+	`$INSTANCE_NAME`_W51_StreamBlock(`$INSTANCE_NAME`_WRITE_OP, addr, buffer, length);
+#else
+	for(index=0;index<length;++index) {
+		`$INSTANCE_NAME`_W51_Write(addr+index,buffer[index]);
+	}
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief read a block of data from consecutive memory addresses
+ * \param addr the address from which the read will begin
+ * \param *buffer pointer to the memory buffer which will hold the read data
+ * \param length the length of data to read from the buffer.
+ */
+static void `$INSTANCE_NAME`_W51_ReadBlock(uint16 addr, uint8* buffer, uint16 length)
+{
+#if !(`$INSTANCE_NAME`_SPI_PIPELINE)
+	int index;
+#endif
+
+#if defined(`$INSTANCE_NAME`_USE_DMA)
+	/* V1.3: Use the DMA engine when it has been started */
+	if (`$INSTANCE_NAME`_DmaTransfer(`$INSTANCE_NAME`_READ_OP, addr, buffer, length) != 0) {
+		return;
+	}
+#endif
+#if (`$INSTANCE_NAME`_SPI_PIPELINE)
+	/* V1.3: stream the frames, building each one while the previous one shifts */
+	`$INSTANCE_NAME`_W51_StreamBlock(`$INSTANCE_NAME`_READ_OP, addr, buffer, length);
+#else
+	for(index=0;index<length;++index) {
+		buffer[index] = `$INSTANCE_NAME`_W51_Read(addr+index);
+	}
+#endif
+}
+/* ======================================================================== */
+/* END SECTION */
+#endif
+/* ======================================================================== */
+/* Chip Register access */
+#if (1)
+/*
+ * V1.3: The accessors which the driver does not use in every build are
+ * CY_INLINE (empty for the PSoC 3 compiler), so that they draw no unused
+ * function warnings.
+ */
+// Common Registers
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Set teh chip mac address to teh specified address
+ * \param *mac pointer to the array holding the MAC address
+ */
+static void `$INSTANCE_NAME`_SetSourceMAC( uint8* mac ) { `$INSTANCE_NAME`_W51_SetMAC(9,mac); }
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read the chip source MAC address from the MAC registers
+ * \param *mac pointer to the address of the buffer to hold the read MAC address
+ */
+static void `$INSTANCE_NAME`_GetSourceMAC( uint8* mac ) { `$INSTANCE_NAME`_W51_GetMAC(9,mac); }
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Set the IPv4 address of the network gateway
  * \param ip IP address of the gateway
  */
 static void `$INSTANCE_NAME`_SetGatewayAddress(uint32 ip) { `$INSTANCE_NAME`_W51_SetIP(1,ip); }
@@ -484,7 +1464,7 @@ static void `$INSTANCE_NAME`_SetGatewayAddress(uint32 ip) { `$INSTANCE_NAME`_W51
  * \brief Read the gateway address from the device
  * \returns the IP address of the gateway
  */
-static uint32 `$INSTANCE_NAME`_GetGatewayAddress( void ) { return `$INSTANCE_NAME`_W51_GetIP(1); }
+static CY_INLINE uint32 `$INSTANCE_NAME`_GetGatewayAddress( void ) { return `$INSTANCE_NAME`_W51_GetIP(1); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief set the subnet mask of the ethernet device
@@ -496,7 +1476,7 @@ static void `$INSTANCE_NAME`_SetSubnetMask( uint32 ip ) { `$INSTANCE_NAME`_W51_S
  * \brief Read the subnet mask from the device
  * \returns the subnet mask that was read from the device.
  */
-static uint32 `$INSTANCE_NAME`_GetSubnetMask( void ) { return `$INSTANCE_NAME`_W51_GetIP(5); }
+static CY_INLINE uint32 `$INSTANCE_NAME`_GetSubnetMask( void ) { return `$INSTANCE_NAME`_W51_GetIP(5); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write the device source IPv4 address
@@ -520,7 +1500,7 @@ static void `$INSTANCE_NAME`_SetMode( uint8 mode ) { `$INSTANCE_NAME`_W51_Write(
  * \brief Read the present contents of the device internal mode register
  * \returns the value of the mode register
  */
-static uint8 `$INSTANCE_NAME`_GetMode( void ) { return `$INSTANCE_NAME`_W51_Read(0); }
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetMode( void ) { return `$INSTANCE_NAME`_W51_Read(0); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write the value of the interrupt register
@@ -532,43 +1512,44 @@ static void `$INSTANCE_NAME`_SetIR( uint8 ir ) { `$INSTANCE_NAME`_W51_Write(0x00
  * \brief Read the contents of the interrupt register
  * \returns the contents read from the interrupt register
  */
-static uint8 `$INSTANCE_NAME`_GetIR( void ) { return `$INSTANCE_NAME`_W51_Read(0x0015); }
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetIR( void ) { return `$INSTANCE_NAME`_W51_Read(0x0015); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Set the value of the interrupt mask register
  * \param imr the value to be written to the interrupt mask register
  */
-static void `$INSTANCE_NAME`_SetIMR( uint8 imr) { `$INSTANCE_NAME`_W51_Write( 0x0016, imr ); }
+static CY_INLINE void `$INSTANCE_NAME`_SetIMR( uint8 imr) { `$INSTANCE_NAME`_W51_Write( 0x0016, imr ); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Read the interrupt mask register
  * \returns the contents of the interrupt mask register
  */
-static uint8 `$INSTANCE_NAME`_GetIMR( void ) { return `$INSTANCE_NAME`_W51_Read( 0x0016 ); }
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetIMR( void ) { return `$INSTANCE_NAME`_W51_Read( 0x0016 ); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write the retry time register
  * \param time the value to be written to the regster
+ * V1.3: public, see the header for details
  */
-static void `$INSTANCE_NAME`_SetRetryTime( uint16 time) { `$INSTANCE_NAME`_W51_Write16( 0x0017, time ); }
+void `$INSTANCE_NAME`_SetRetryTime( uint16 time) { `$INSTANCE_NAME`_W51_Write16( 0x0017, time ); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Read the retry tie register
  * \returns the value read from the register
  */
-static uint16 `$INSTANCE_NAME`_GetRetryTime( void ) { return `$INSTANCE_NAME`_W51_Read16( 0x0017 ); }
+uint16 `$INSTANCE_NAME`_GetRetryTime( void ) { return `$INSTANCE_NAME`_W51_Read16( 0x0017 ); }
 /* ------------------------------------------------------------------------ */
 /**
- * \breif write a value to the retry count register
+ * \brief write a value to the retry count register
  * \param count the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetRetryCount( uint8 count ) { `$INSTANCE_NAME`_W51_Write( 0x0019, count); }
+void `$INSTANCE_NAME`_SetRetryCount( uint8 count ) { `$INSTANCE_NAME`_W51_Write( 0x0019, count); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Read the contents of the retry count register
  * \returns the value read from teh register
  */
-static uint8 `$INSTANCE_NAME`_GetRetryCount( void ) { return `$INSTANCE_NAME`_W51_Read( 0x0019 ); }
+uint8 `$INSTANCE_NAME`_GetRetryCount( void ) { return `$INSTANCE_NAME`_W51_Read( 0x0019 ); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief write a value to the Rx mem size register
@@ -580,7 +1561,7 @@ static void `$INSTANCE_NAME`_SetRxMemSize( uint8 size ) { `$INSTANCE_NAME`_W51_W
  * \brief Read the contents of hte rx mem size register
  * \returns the value read from teh register
  */
-static uint8 `$INSTANCE_NAME`_GetRxMemSize( void ) { return `$INSTANCE_NAME`_W51_Read(0x1A); }
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetRxMemSize( void ) { return `$INSTANCE_NAME`_W51_Read(0x1A); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief write a value to the tx mem size register
@@ -592,31 +1573,31 @@ static void `$INSTANCE_NAME`_SetTxMemSize( uint8 size ) { `$INSTANCE_NAME`_W51_W
  * \brief read the contents of the tx mem size register
  * \returns the value read from the register
  */
-static uint8 `$INSTANCE_NAME`_GetTxMemSize( void ) { return `$INSTANCE_NAME`_W51_Read( 0x1B);}
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetTxMemSize( void ) { return `$INSTANCE_NAME`_W51_Read( 0x1B);}
 /* ------------------------------------------------------------------------ */
 /**
  * \brief write a value to the unreachable IP register
  * \param ip the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetUnreachableIP( uint32 ip) { `$INSTANCE_NAME`_W51_SetIP( 0x2A, ip); }
+static CY_INLINE void `$INSTANCE_NAME`_SetUnreachableIP( uint32 ip) { `$INSTANCE_NAME`_W51_SetIP( 0x2A, ip); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief read the contents of the unreachable IP register
  * \returns the value read from teh register
  */
-static uint32 `$INSTANCE_NAME`_GetUnreachableIP( void ) { return `$INSTANCE_NAME`_W51_GetIP( 0x2A ); }
+static CY_INLINE uint32 `$INSTANCE_NAME`_GetUnreachableIP( void ) { return `$INSTANCE_NAME`_W51_GetIP( 0x2A ); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief write a value to the unreachable port register
  * \param port the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetUnreachablePort( uint16 port) { `$INSTANCE_NAME`_W51_Write16(0x2E, port); }
+static CY_INLINE void `$INSTANCE_NAME`_SetUnreachablePort( uint16 port) { `$INSTANCE_NAME`_W51_Write16(0x2E, port); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief read the contents of the unreachable port register
  * \returns the value read from the register
  */
-static uint16 `$INSTANCE_NAME`_GetUnreachablePort( void ) { return `$INSTANCE_NAME`_W51_Read16(0x2E); }
+static CY_INLINE uint16 `$INSTANCE_NAME`_GetUnreachablePort( void ) { return `$INSTANCE_NAME`_W51_Read16(0x2E); }
 /* ======================================================================== */
 /* End Section */
 #endif
@@ -642,7 +1623,7 @@ static void `$INSTANCE_NAME`_SetSocketMode(uint8 socket, uint8 mode)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint8 `$INSTANCE_NAME`_GetSocketMode(uint8 socket)
+static CY_INLINE uint8 `$INSTANCE_NAME`_GetSocketMode(uint8 socket)
 { return `$INSTANCE_NAME`_W51_Read(`$INSTANCE_NAME`_SOCKET_BASE(socket)); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -651,7 +1632,17 @@ static uint8 `$INSTANCE_NAME`_GetSocketMode(uint8 socket)
  * \param cmd the value to be written to the register
  */
 static void `$INSTANCE_NAME`_SetSocketCommand(uint8 socket, uint8 cmd)
-{ `$INSTANCE_NAME`_W51_Write(`$INSTANCE_NAME`_SOCKET_BASE(socket)+1, cmd); }
+{
+	/*
+	 * V1.3: The device re-initializes the buffer pointers when a socket is
+	 * opened or connected, so reload the local copies on their next use.
+	 */
+	if ( (cmd == `$INSTANCE_NAME`_CMD_OPEN) || (cmd == `$INSTANCE_NAME`_CMD_LISTEN) ||
+		(cmd == `$INSTANCE_NAME`_CMD_CONNECT) || (cmd == `$INSTANCE_NAME`_CMD_CLOSE) ) {
+		`$INSTANCE_NAME`_SocketConfig[socket].PointersValid = 0;
+	}
+	`$INSTANCE_NAME`_W51_Write(`$INSTANCE_NAME`_SOCKET_BASE(socket)+1, cmd);
+}
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Read a value from the socket command register
@@ -682,7 +1673,7 @@ static uint8 `$INSTANCE_NAME`_GetSocketIR(uint8 socket)
  * \param socket the socket number for the addressed register
  * \param status the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetSocketStatus(uint8 socket, uint8 status)
+static CY_INLINE void `$INSTANCE_NAME`_SetSocketStatus(uint8 socket, uint8 status)
 { `$INSTANCE_NAME`_W51_Write(`$INSTANCE_NAME`_SOCKET_BASE(socket)+3,status); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -706,7 +1697,7 @@ static void `$INSTANCE_NAME`_SetSocketSourcePort(uint8 socket, uint16 port)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint16 `$INSTANCE_NAME`_GetSocketSourcePort(uint8 socket)
+static CY_INLINE uint16 `$INSTANCE_NAME`_GetSocketSourcePort(uint8 socket)
 { return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+4); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -714,7 +1705,7 @@ static uint16 `$INSTANCE_NAME`_GetSocketSourcePort(uint8 socket)
  * \param socket the socket number for the addressed register
  * \param *mac poitner to the array holding the values to be written to the register
  */
-static void `$INSTANCE_NAME`_SetSocketDestMAC(uint8 socket, uint8* mac)
+static CY_INLINE void `$INSTANCE_NAME`_SetSocketDestMAC(uint8 socket, uint8* mac)
 { `$INSTANCE_NAME`_W51_SetMAC( `$INSTANCE_NAME`_SOCKET_BASE(socket)+6, mac); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -722,7 +1713,7 @@ static void `$INSTANCE_NAME`_SetSocketDestMAC(uint8 socket, uint8* mac)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static void `$INSTANCE_NAME`_GetSocketDestMAC(uint8 socket, uint8* mac)
+static CY_INLINE void `$INSTANCE_NAME`_GetSocketDestMAC(uint8 socket, uint8* mac)
 { `$INSTANCE_NAME`_W51_GetMAC( `$INSTANCE_NAME`_SOCKET_BASE(socket)+6,mac); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -738,7 +1729,7 @@ static void `$INSTANCE_NAME`_SetSocketDestIP(uint8 socket, uint32 ip)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint32 `$INSTANCE_NAME`_GetSocketDestIP(uint8 socket )
+static CY_INLINE uint32 `$INSTANCE_NAME`_GetSocketDestIP(uint8 socket )
 { return `$INSTANCE_NAME`_W51_GetIP(`$INSTANCE_NAME`_SOCKET_BASE(socket)+12); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -754,7 +1745,7 @@ static void `$INSTANCE_NAME`_SetSocketDestPort(uint8 socket, uint16 port)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint16 `$INSTANCE_NAME`_GetSocketDestPort(uint8 socket)
+static CY_INLINE uint16 `$INSTANCE_NAME`_GetSocketDestPort(uint8 socket)
 { return `$INSTANCE_NAME`_W51_Read16( `$INSTANCE_NAME`_SOCKET_BASE(socket)+16 ); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -778,7 +1769,7 @@ static uint16 `$INSTANCE_NAME`_GetSocketMaxSegSize(uint8 socket)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint16  `$INSTANCE_NAME`_GetSocketProto(uint8 socket)
+static CY_INLINE uint16  `$INSTANCE_NAME`_GetSocketProto(uint8 socket)
 { return `$INSTANCE_NAME`_W51_Read(`$INSTANCE_NAME`_SOCKET_BASE(socket)+20); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -818,7 +1809,7 @@ static uint8 `$INSTANCE_NAME`_GetSocketTTL(uint8 socket)
  * \param socket the socket number for the addressed register
  * \param size the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetSocketTxFree( uint8 socket, uint16 size)
+static CY_INLINE void `$INSTANCE_NAME`_SetSocketTxFree( uint8 socket, uint16 size)
 { `$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x20,size); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -827,14 +1818,14 @@ static void `$INSTANCE_NAME`_SetSocketTxFree( uint8 socket, uint16 size)
  * \returns the value read from the register
  */
 static uint16 `$INSTANCE_NAME`_GetSocketTxFree(uint8 socket)
-{ return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x20); }
+{ return `$INSTANCE_NAME`_W51_ReadCounter16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x20); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write a value to the socket tx read pointer register
  * \param socket the socket number for the addressed register
  * \param ptr the value to be written to the register
  */
-static void `$INSTANCE_NAME`_SetSocketTxReadPtr(uint8 socket, uint16 ptr)
+static CY_INLINE void `$INSTANCE_NAME`_SetSocketTxReadPtr(uint8 socket, uint16 ptr)
 { `$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x22,ptr); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -842,7 +1833,7 @@ static void `$INSTANCE_NAME`_SetSocketTxReadPtr(uint8 socket, uint16 ptr)
  * \param socket the socket number for the addressed register
  * \returns the value read from the register
  */
-static uint16 `$INSTANCE_NAME`_GetSocketTxReadPtr(uint8 socket)
+static CY_INLINE uint16 `$INSTANCE_NAME`_GetSocketTxReadPtr(uint8 socket)
 { return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x22); }
 /* ------------------------------------------------------------------------ */
 /**
@@ -851,15 +1842,37 @@ static uint16 `$INSTANCE_NAME`_GetSocketTxReadPtr(uint8 socket)
  * \param ptr the value to be written to the register
  */
 static void `$INSTANCE_NAME`_SetSocketTxWritePtr(uint8 socket, uint16 ptr)
-{ `$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x24,ptr); }
+{
+	`$INSTANCE_NAME`_SocketConfig[socket].TxWritePtr = ptr;
+	`$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x24,ptr);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Load the local copies of the socket buffer pointers from the device
+ * \param socket the socket number for the addressed registers
+ *
+ * V1.3: The pointers are only read from the device after the socket has
+ * been opened or connected, the local copies are used after that.
+ */
+static void `$INSTANCE_NAME`_LoadSocketPointers(uint8 socket)
+{
+	if (`$INSTANCE_NAME`_SocketConfig[socket].PointersValid == 0) {
+		`$INSTANCE_NAME`_SocketConfig[socket].TxWritePtr = `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x24);
+		`$INSTANCE_NAME`_SocketConfig[socket].RxReadPtr = `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x28);
+		`$INSTANCE_NAME`_SocketConfig[socket].PointersValid = 1;
+	}
+}
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Read a value from the socket tx buffer write pointer register
+ * \brief Read the socket tx buffer write pointer
  * \param socket the socket number for the addressed register
- * \returns the value read from the register
+ * \returns the value of the register
  */
 static uint16 `$INSTANCE_NAME`_GetSocketTxWritePtr(uint8 socket)
-{ return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x24); }
+{
+	`$INSTANCE_NAME`_LoadSocketPointers(socket);
+	return `$INSTANCE_NAME`_SocketConfig[socket].TxWritePtr;
+}
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Read a value from the socket rx received data size register
@@ -867,7 +1880,7 @@ static uint16 `$INSTANCE_NAME`_GetSocketTxWritePtr(uint8 socket)
  * \returns the value read from the register
  */
 static uint16 `$INSTANCE_NAME`_GetSocketRxSize(uint8 socket)
-{ return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x26); }
+{ return `$INSTANCE_NAME`_W51_ReadCounter16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x26); }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write a value to the socket rx read pointer register
@@ -875,15 +1888,21 @@ static uint16 `$INSTANCE_NAME`_GetSocketRxSize(uint8 socket)
  * \param ptr the value to be written to the register
  */
 static void `$INSTANCE_NAME`_SetSocketRxReadPtr(uint8 socket, uint16 ptr)
-{ `$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x28,ptr); }
+{
+	`$INSTANCE_NAME`_SocketConfig[socket].RxReadPtr = ptr;
+	`$INSTANCE_NAME`_W51_Write16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x28,ptr);
+}
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Read a value from the socket rx buffer read pointer register
+ * \brief Read the socket rx buffer read pointer
  * \param socket the socket number for the addressed register
- * \returns the value read from the register
+ * \returns the value of the register
  */
 static uint16 `$INSTANCE_NAME`_GetSocketRxReadPtr(uint8 socket)
-{ return `$INSTANCE_NAME`_W51_Read16(`$INSTANCE_NAME`_SOCKET_BASE(socket)+0x28); }
+{
+	`$INSTANCE_NAME`_LoadSocketPointers(socket);
+	return `$INSTANCE_NAME`_SocketConfig[socket].RxReadPtr;
+}
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Write a command to the socket command register and wait for completion
@@ -893,15 +1912,107 @@ static uint16 `$INSTANCE_NAME`_GetSocketRxReadPtr(uint8 socket)
 static uint32 `$INSTANCE_NAME`_ExecuteSocketCommand( uint8 socket, int cmd)
 {
 	uint32 timeout;
+	uint16 delay;
 	timeout = 0;
+	delay = 1;
 	
+	`$INSTANCE_NAME`_Count(Commands,1);
 	`$INSTANCE_NAME`_SetSocketCommand(socket,cmd);
-	while ( ( `$INSTANCE_NAME`_GetSocketCommand(socket) ) && (timeout < `$CMD_TIMEOUT`))
+	/*
+	 * V1.3: The device usually clears the command register within a few
+	 * microseconds, so poll with a delay starting at 1us and doubling up to
+	 * 1ms rather than waiting 1ms between each poll.  The timeout is still
+	 * CMD_TIMEOUT milliseconds, and is counted in microseconds.
+	 */
+	while ( ( `$INSTANCE_NAME`_GetSocketCommand(socket) ) && (timeout < (`$CMD_TIMEOUT`*1000ul)))
 	{
-		++timeout;
-		CyDelay(1);
+		`$INSTANCE_NAME`_Count(CommandPolls,1);
+		CyDelayUs(delay);
+		timeout += delay;
+		delay = (delay < 500) ? (delay<<1) : 1000;
+	}
+	return( timeout/1000 );
+}
+/* ------------------------------------------------------------------------ */
+cystatus `$INSTANCE_NAME`_SocketCommandStart( uint8 socket, uint8 cmd )
+{
+	if (socket >= 4) {
+		return( CYRET_BAD_PARAM );
+	}
+	/*
+	 * V1.3: OPEN, CLOSE, RECV, SEND, SEND_MAC and CONNECT change the socket
+	 * table, the buffer pointers or the subnet mask errata handling, so only
+	 * the commands which leave no state in the driver may be issued here.
+	 */
+	if ( (cmd != `$INSTANCE_NAME`_CMD_SEND_KEEP) && (cmd != `$INSTANCE_NAME`_CMD_DISCON) &&
+		(cmd != `$INSTANCE_NAME`_CMD_LISTEN) ) {
+		return( CYRET_BAD_PARAM );
+	}
+#if (`$INSTANCE_NAME`_COALESCE) && (`$INCLUDE_TCP`)
+	/* send the staged data ahead of the FIN, as _TcpDisconnect() does */
+	if (cmd == `$INSTANCE_NAME`_CMD_DISCON) {
+		`$INSTANCE_NAME`_TcpFlush(socket);
+	}
+#endif
+	`$INSTANCE_NAME`_Count(Commands,1);
+	`$INSTANCE_NAME`_SetSocketCommand(socket,cmd);
+
+	return( CYRET_STARTED );
+}
+/* ------------------------------------------------------------------------ */
+uint8 `$INSTANCE_NAME`_SocketCommandDone( uint8 socket )
+{
+	if (socket >= 4) {
+		return( 1 );
 	}
-	return( timeout );
+	return( `$INSTANCE_NAME`_GetSocketCommand(socket) == 0 );
+}
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+/* V1.3: number of bytes read from each socket without a RECV command */
+static uint16 `$INSTANCE_NAME`_RecvPending[4];
+#endif
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Release data read from the receive buffer to the device
+ * \param socket the socket from which the data was read
+ * \param length the number of bytes read
+ *
+ * V1.3: When a receive threshold is configured, the RECV command is only
+ * issued once the threshold number of bytes has been read.  The threshold is
+ * limited to the receive buffer size of the socket, which could otherwise
+ * fill without the threshold being reached.
+ */
+static void `$INSTANCE_NAME`_SocketRecv( uint8 socket, uint16 length )
+{
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+	uint16 threshold;
+#endif
+
+	`$INSTANCE_NAME`_Activity(socket);
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+	threshold = (`$INSTANCE_NAME`_RECV_THRESHOLD > `$INSTANCE_NAME`_SOCKET_RX_SIZE(socket)) ?
+		`$INSTANCE_NAME`_SOCKET_RX_SIZE(socket) : `$INSTANCE_NAME`_RECV_THRESHOLD;
+	`$INSTANCE_NAME`_RecvPending[socket] += length;
+	if (`$INSTANCE_NAME`_RecvPending[socket] < threshold) {
+		return;
+	}
+	`$INSTANCE_NAME`_RecvPending[socket] = 0;
+#else
+	(void)length;
+#endif
+	`$INSTANCE_NAME`_ExecuteSocketCommand(socket, `$INSTANCE_NAME`_CMD_RECV);
+}
+/* ------------------------------------------------------------------------ */
+void `$INSTANCE_NAME`_SocketRecvFlush( uint8 socket )
+{
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+	if ( (socket < 4) && (`$INSTANCE_NAME`_RecvPending[socket] != 0) ) {
+		`$INSTANCE_NAME`_RecvPending[socket] = 0;
+		`$INSTANCE_NAME`_ExecuteSocketCommand(socket, `$INSTANCE_NAME`_CMD_RECV);
+	}
+#else
+	(void)socket;
+#endif
 }
 /* ------------------------------------------------------------------------ */
 /**
@@ -911,19 +2022,21 @@ static uint32 `$INSTANCE_NAME`_ExecuteSocketCommand( uint8 socket, int cmd)
  */
 static uint16 `$INSTANCE_NAME`_GetTxFreeSize( uint8 socket )
 {
-	uint16 first, second;
-	
-	first = 0;
-	second = 0;
-	do {
-		first = `$INSTANCE_NAME`_GetSocketTxFree( socket );
-		if (first != 0) {
-			second = `$INSTANCE_NAME`_GetSocketTxFree( socket );
-		}
-	}
-	while (first != second );
-	
-	return( second );
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	uint16 size;
+
+	/* V1.3: the register read is consistent, see _W51_ReadCounter16() */
+	size = `$INSTANCE_NAME`_GetSocketTxFree( socket );
+	/*
+	 * V1.3: the device does not count the data copied behind a SEND.  A reset
+	 * or closed socket may report less free memory than was copied.
+	 */
+	return( (size > `$INSTANCE_NAME`_TxCopied[socket]) ?
+		(size - `$INSTANCE_NAME`_TxCopied[socket]) : 0 );
+#else
+	/* V1.3: the register read is consistent, see _W51_ReadCounter16() */
+	return( `$INSTANCE_NAME`_GetSocketTxFree( socket ) );
+#endif
 }
 /* ------------------------------------------------------------------------ */
 /**
@@ -933,52 +2046,290 @@ static uint16 `$INSTANCE_NAME`_GetTxFreeSize( uint8 socket )
  */
 static uint16 `$INSTANCE_NAME`_GetRxSize( uint8 socket )
 {
-	uint16 first, second;
+	uint16 size;
 	
-	first = 0;
-	second = 0;
-	do {
-		first = `$INSTANCE_NAME`_GetSocketRxSize( socket );
-		if (first != 0) {
-			second = `$INSTANCE_NAME`_GetSocketRxSize( socket );
-		}
+	/* V1.3: the register read is consistent, see _W51_ReadCounter16() */
+	size = `$INSTANCE_NAME`_GetSocketRxSize( socket );
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+	if (size > `$INSTANCE_NAME`_MemProfile[socket].RxHighWater) {
+		`$INSTANCE_NAME`_MemProfile[socket].RxHighWater = size;
 	}
-	while (first != second );
+#endif
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+	/*
+	 * V1.3: the device does not remove read data until the RECV is issued.
+	 * A reset or closed socket may have dropped the data already read.
+	 */
+	size = (size > `$INSTANCE_NAME`_RecvPending[socket]) ?
+		(size - `$INSTANCE_NAME`_RecvPending[socket]) : 0;
+#endif
+	
+	return size;
+}
+/* ------------------------------------------------------------------------ */
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+/**
+ * \brief Record the transmit memory needed by a send
+ * \param socket the socket on which the data is sent
+ * \param available the free transmit memory read from the device
+ * \param length the number of bytes the caller is sending
+ *
+ * The memory in use plus the length of the send is the transmit buffer size
+ * that would have allowed the send without waiting.
+ */
+static void `$INSTANCE_NAME`_ProfileTx( uint8 socket, uint16 available, uint16 length )
+{
+	uint32 demand;
 	
-	return second;
+	demand = (uint32)(`$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) - available) + length;
+	demand = (demand > 0xFFFF) ? 0xFFFF : demand;
+	if (demand > `$INSTANCE_NAME`_MemProfile[socket].TxHighWater) {
+		`$INSTANCE_NAME`_MemProfile[socket].TxHighWater = (uint16)demand;
+	}
+	if (available < length) {
+		++`$INSTANCE_NAME`_MemProfile[socket].TxStalls;
+	}
 }
+#else
+#define `$INSTANCE_NAME`_ProfileTx(socket, available, length)
+#endif
 /* ------------------------------------------------------------------------ */
 
 // END Socket Register access section
 #endif
 /* ======================================================================== */
+/* Interrupt Event Engine */
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+/* V1.3: Set by the /INT handler, cleared when the interrupt registers are read */
+static volatile uint8 `$INSTANCE_NAME`_IntPending;
+/* V1.3: Socket interrupt flags collected from the device since they were cleared */
+static uint8 `$INSTANCE_NAME`_SocketEvents[4];
+/* V1.3: Set once the interrupt handler has been attached */
+static uint8 `$INSTANCE_NAME`_IntEnabled;
+
+CY_ISR_PROTO(`$INSTANCE_NAME`_IntIsr);
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Interrupt handler for the W5100 /INT output
+ *
+ * The SPI may be in use by the application when the interrupt occurs, so the
+ * handler only flags the interrupt, and the interrupt registers are read by
+ * the driver the next time that it checks for socket events.
+ */
+CY_ISR(`$INSTANCE_NAME`_IntIsr)
+{
+	`$INSTANCE_NAME`_IntPending = 1;
+	/* `#START W5100_INTERRUPT` */
+
+	/* `#END` */
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Collect the pending socket interrupt flags from the device
+ *
+ * When the /INT handler has flagged an interrupt, the interrupt register is
+ * read, and the interrupt register of each flagged socket is read, cleared,
+ * and added to the socket events.  When there is no pending interrupt, the
+ * bus is not accessed.  Until _IntStart() has attached the handler, nothing
+ * would flag an interrupt, so the interrupt register is polled on each call.
+ */
+static void `$INSTANCE_NAME`_ServiceInterrupt( void )
+{
+	uint8 ir;
+	uint8 sir;
+	uint8 socket;
+
+	if ( (`$INSTANCE_NAME`_IntPending != 0) || (`$INSTANCE_NAME`_IntEnabled == 0) ) {
+		`$INSTANCE_NAME`_IntPending = 0;
+		ir = `$INSTANCE_NAME`_GetIR() & 0x0F;
+		/* the /INT output remains active until all flagged sockets are cleared */
+		while (ir != 0) {
+			for(socket=0;socket<4;++socket) {
+				if ( (ir & (1<<socket)) != 0) {
+					sir = `$INSTANCE_NAME`_GetSocketIR(socket);
+					`$INSTANCE_NAME`_SetSocketIR(socket, sir);
+					`$INSTANCE_NAME`_SocketEvents[socket] |= sir;
+				}
+			}
+			ir = `$INSTANCE_NAME`_GetIR() & 0x0F;
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+cystatus `$INSTANCE_NAME`_IntStart( uint8 intNumber )
+{
+	if (intNumber > CY_INT_NUMBER_MAX) {
+		return( CYRET_BAD_PARAM );
+	}
+	CyIntDisable(intNumber);
+	CyIntSetVector(intNumber, `$INSTANCE_NAME`_IntIsr);
+	`$INSTANCE_NAME`_IntEnabled = 1;
+	/* force the first service to collect interrupts that are already pending */
+	`$INSTANCE_NAME`_IntPending = 1;
+	/* enable the interrupt output for the four sockets */
+	`$INSTANCE_NAME`_SetIMR(0x0F);
+	CyIntClearPending(intNumber);
+	CyIntEnable(intNumber);
+
+	return( CYRET_SUCCESS );
+}
+/* ------------------------------------------------------------------------ */
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+static void `$INSTANCE_NAME`_SendComplete( uint8 socket, uint8 release );
+#endif
+uint8 `$INSTANCE_NAME`_GetSocketEvents( uint8 socket )
+{
+	uint8 events;
+
+	if (socket >= 4) {
+		return( 0 );
+	}
+	`$INSTANCE_NAME`_ServiceInterrupt();
+	events = `$INSTANCE_NAME`_SocketEvents[socket];
+	`$INSTANCE_NAME`_SocketEvents[socket] = 0;
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	/* V1.3: the events are consumed here, so record the end of the SEND */
+	if ( (events & (`$INSTANCE_NAME`_IR_SEND_OK|`$INSTANCE_NAME`_IR_TIMEOUT|`$INSTANCE_NAME`_IR_DISCON)) != 0) {
+		`$INSTANCE_NAME`_SendComplete( socket, 1 );
+	}
+#endif
+
+	return( events );
+}
+#endif
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read the interrupt flags of a socket
+ * \param socket the socket number
+ * \returns the socket interrupt flags
+ *
+ * When the interrupt engine is enabled, the flags collected by the interrupt
+ * service are returned (which polls the registers until _IntStart() has been
+ * called), otherwise the socket interrupt register is read.
+ */
+static uint8 `$INSTANCE_NAME`_SocketFlags( uint8 socket )
+{
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+	`$INSTANCE_NAME`_ServiceInterrupt();
+	return( `$INSTANCE_NAME`_SocketEvents[socket] );
+#else
+	return( `$INSTANCE_NAME`_GetSocketIR(socket) );
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Clear interrupt flags of a socket
+ * \param socket the socket number
+ * \param flags the flags to clear
+ */
+static void `$INSTANCE_NAME`_ClearSocketFlags( uint8 socket, uint8 flags )
+{
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+	`$INSTANCE_NAME`_SocketEvents[socket] &= ~flags;
+#else
+	`$INSTANCE_NAME`_SetSocketIR(socket, flags);
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Wait for a change of socket state
+ *
+ * When the interrupt engine is enabled and attached, this waits (without
+ * accessing the SPI) for the device to signal an interrupt, otherwise it
+ * waits 1ms, and the caller polls the registers.
+ */
+static void `$INSTANCE_NAME`_SocketIdle( void )
+{
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+	/* V1.3: without _IntStart() nothing sets the pending flag */
+	if (`$INSTANCE_NAME`_IntEnabled != 0) {
+		while (`$INSTANCE_NAME`_IntPending == 0) {
+			/* the SPI is idle until the device signals an event */
+		}
+		`$INSTANCE_NAME`_ServiceInterrupt();
+		return;
+	}
+#endif
+	CyDelay(1);
+}
+/* ======================================================================== */
+/* Asynchronous SEND tracking */
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+/* V1.3: sockets with a SEND command in progress */
+static uint8 `$INSTANCE_NAME`_SendPending;
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Record the completion of the SEND in progress on a socket
+ * \param socket the socket on which the SEND completed
+ * \param release set to clear the subnet mask (ERRATA FIX) when no other
+ *  SEND is in progress
+ */
+static void `$INSTANCE_NAME`_SendComplete( uint8 socket, uint8 release )
+{
+	if ( (`$INSTANCE_NAME`_SendPending & (1<<socket)) != 0) {
+		`$INSTANCE_NAME`_SendPending &= ~(1<<socket);
+		if ( (release != 0) && (`$INSTANCE_NAME`_SendPending == 0) && (`$INSTANCE_NAME`_ConnectPending == 0) ) {
+			`$INSTANCE_NAME`_SetSubnetMask( 0 );
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Check the SEND in progress on a socket for completion
+ * \param socket the socket to check
+ * \param release set to clear the subnet mask when all SENDs are complete
+ * \returns 0 while the SEND is still in progress
+ */
+static uint8 `$INSTANCE_NAME`_SendCheck( uint8 socket, uint8 release )
+{
+	uint8 ir;
+
+	if ( (`$INSTANCE_NAME`_SendPending & (1<<socket)) != 0) {
+		ir = `$INSTANCE_NAME`_SocketFlags( socket );
+		if ( (ir & (`$INSTANCE_NAME`_IR_SEND_OK|`$INSTANCE_NAME`_IR_TIMEOUT|`$INSTANCE_NAME`_IR_DISCON)) != 0) {
+			/* clear the SEND_OK flag from the register */
+			`$INSTANCE_NAME`_ClearSocketFlags( socket, `$INSTANCE_NAME`_IR_SEND_OK );
+			`$INSTANCE_NAME`_SendComplete( socket, release );
+		}
+	}
+	return( (`$INSTANCE_NAME`_SendPending & (1<<socket)) == 0 );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Wait for the SEND in progress on a socket to complete
+ * \param socket the socket on which to wait
+ */
+static void `$INSTANCE_NAME`_SendWait( uint8 socket )
+{
+	while (`$INSTANCE_NAME`_SendCheck( socket, 0 ) == 0) {
+		`$INSTANCE_NAME`_SocketIdle();
+	}
+}
+#endif
+/* ======================================================================== */
 /* W5100 Data Buffer Memory access primitives */
 #if (1)
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Transfer data from a local data buffer to the chip Tx fifo
+ * \brief Write data to the transmit buffer memory of a socket
  * \param socket the socket buffer to which the data will be written
- * \param offset The offest in to the socket buffer
+ * \param ptr the transmit buffer pointer (Sn_TX_WR based) of the first byte
  * \param *buffer pointer to the local buffer to copy to the transmit fifo
  * \param length the number of bytes to be copied to the transmit fifo
+ *
+ * V1.3: separated from _ProcessTxData() so that data may be written at any
+ * position in the transmit buffer.
  */
-static void `$INSTANCE_NAME`_ProcessTxData(uint8 socket, uint16 offset, uint8* buffer, uint16 length)
+static void `$INSTANCE_NAME`_WriteTxBuffer(uint8 socket, uint16 ptr, uint8* buffer, uint16 length)
 {
 	uint16 addr;
-	uint16 base;
 	uint16 PointerOffset;
 	uint16 size;
 	
-	/*
-	 * Read the offset pointer, and calculate the base address for the start of write
-	 * in to the chip buffers.  Written data will be offset by the offset byte count
-	 * specified in the parameters.
-	 */
-	base = `$INSTANCE_NAME`_GetSocketTxWritePtr(socket) + offset;
-	PointerOffset = (base & 0x07FF);
+	PointerOffset = (ptr & `$INSTANCE_NAME`_SOCKET_TX_MASK(socket));
 	addr = PointerOffset + `$INSTANCE_NAME`_SOCKET_TX_BASE(socket);
 	/* calculate the number of bytes from the pointer to the end of the buffer */
-	size = 0x0800 - PointerOffset;
+	size = `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) - PointerOffset;
 	
 	/*
 	 * is there enough space to write the complete packet
@@ -1001,40 +2352,140 @@ static void `$INSTANCE_NAME`_ProcessTxData(uint8 socket, uint16 offset, uint8* b
 		 */
 		`$INSTANCE_NAME`_W51_WriteBlock(addr,buffer,length);
 	}
-	/* move the write pointer */
-	base += length;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Store the new transmit write pointer of a socket
+ * \param socket the socket number
+ * \param ptr the new write pointer
+ */
+static void `$INSTANCE_NAME`_CommitTxData(uint8 socket, uint16 ptr)
+{
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	/*
+	 * V1.3: The data was copied while the previous SEND was in progress, but
+	 * the write pointer may not be moved until that SEND has completed.
+	 */
+	`$INSTANCE_NAME`_SendWait(socket);
+#endif
 	/* 
 	 * Store the new write pointer so that the device knows that there is data waiting
 	 * to be transmitted over the link.
 	 */
-	`$INSTANCE_NAME`_SetSocketTxWritePtr(socket, base);
+	`$INSTANCE_NAME`_SetSocketTxWritePtr(socket, ptr);
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	/* the data copied behind the previous SEND is included */
+	`$INSTANCE_NAME`_TxCopied[socket] = 0;
+#endif
 }
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Transfer data from the chip receive buffer to a local buffer
- * \param socket the socket buffer from which the data will be read
+ * \brief Find the position at which the next data is written to the Tx fifo
+ * \param socket the socket number
+ * \returns the transmit buffer pointer following the data already written
+ *
+ * V1.3: This is the write pointer, unless _TcpWrite() has copied data behind
+ * a SEND in progress.
+ */
+static uint16 `$INSTANCE_NAME`_GetTxAppendPtr(uint8 socket)
+{
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	return( `$INSTANCE_NAME`_GetSocketTxWritePtr(socket) + `$INSTANCE_NAME`_TxCopied[socket] );
+#else
+	return( `$INSTANCE_NAME`_GetSocketTxWritePtr(socket) );
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Transfer data from a local data buffer to the chip Tx fifo
+ * \param socket the socket buffer to which the data will be written
  * \param offset The offest in to the socket buffer
- * \param *buffer pointer to the local buffer to hold the receive fifo data
- * \param length the max number of bytes to be copied to the local buffer
- * \param flags Flag settings to control read fifo options (lookahead)
+ * \param *buffer pointer to the local buffer to copy to the transmit fifo
+ * \param length the number of bytes to be copied to the transmit fifo
  */
-static void `$INSTANCE_NAME`_ProcessRxData(uint8 socket, uint16 offset, uint8* buffer, uint16 length, uint8 flags)
+static void `$INSTANCE_NAME`_ProcessTxData(uint8 socket, uint16 offset, uint8* buffer, uint16 length)
 {
-	uint16 addr;
 	uint16 base;
-	uint16 PointerOffset;
-	uint16 size;
 	
 	/*
-	 * Read the offset pointer, and calculate the base address for the start of read
-	 * in to the chip buffers.  The data read will be offset by the offset byte count
+	 * Read the offset pointer, and calculate the base address for the start of write
+	 * in to the chip buffers.  Written data will be offset by the offset byte count
 	 * specified in the parameters.
 	 */
-	base = `$INSTANCE_NAME`_GetSocketRxReadPtr(socket) + offset;
-	PointerOffset = (base & 0x07FF);
+	base = `$INSTANCE_NAME`_GetTxAppendPtr(socket) + offset;
+	`$INSTANCE_NAME`_WriteTxBuffer(socket, base, buffer, length);
+	/* move the write pointer */
+	base += length;
+	`$INSTANCE_NAME`_CommitTxData(socket, base);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Transfer a list of data segments to the chip Tx fifo
+ * \param socket the socket buffer to which the data will be written
+ * \param *iov the array of data segments
+ * \param count the number of segments in the array
+ * \param length the total number of bytes to be copied to the transmit fifo
+ *
+ * V1.3: The segments are written consecutively, and the write pointer is
+ * read and updated once for the whole list.
+ */
+static void `$INSTANCE_NAME`_ProcessTxVector(uint8 socket, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count, uint16 length)
+{
+	uint16 base;
+	uint16 size;
+	uint8 index;
+	
+	base = `$INSTANCE_NAME`_GetTxAppendPtr(socket);
+	for(index=0;(index<count) && (length>0);++index) {
+		size = (iov[index].Length > length) ? length : iov[index].Length;
+		if (size > 0) {
+			`$INSTANCE_NAME`_WriteTxBuffer(socket, base, (uint8*)iov[index].Buffer, size);
+			base += size;
+			length -= size;
+		}
+	}
+	`$INSTANCE_NAME`_CommitTxData(socket, base);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Calculate the length of a list of data segments
+ * \param socket the socket on which the data will be sent
+ * \param *iov the array of data segments
+ * \param count the number of segments in the array
+ * \returns the total length, limited to the size of the socket transmit buffer
+ */
+static uint16 `$INSTANCE_NAME`_IovLength(uint8 socket, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count)
+{
+	uint32 length;
+	uint8 index;
+	
+	length = 0;
+	for(index=0;index<count;++index) {
+		length += iov[index].Length;
+	}
+	return( (length > `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket)) ? `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) : (uint16)length );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read data from the receive buffer memory of a socket
+ * \param socket the socket buffer from which the data will be read
+ * \param ptr the receive buffer pointer (Sn_RX_RD based) of the first byte
+ * \param *buffer pointer to the local buffer to hold the receive fifo data
+ * \param length the number of bytes to be copied to the local buffer
+ *
+ * V1.3: separated from _ProcessRxData() so that data may be read at any
+ * position in the receive buffer.
+ */
+static void `$INSTANCE_NAME`_ReadRxBuffer(uint8 socket, uint16 ptr, uint8* buffer, uint16 length)
+{
+	uint16 addr;
+	uint16 PointerOffset;
+	uint16 size;
+	
+	PointerOffset = (ptr & `$INSTANCE_NAME`_SOCKET_RX_MASK(socket));
 	addr = PointerOffset + `$INSTANCE_NAME`_SOCKET_RX_BASE(socket);
 	/* calculate the number of bytes from the pointer to the end of the buffer */
-	size = 0x0800 - PointerOffset;
+	size = `$INSTANCE_NAME`_SOCKET_RX_SIZE(socket) - PointerOffset;
 	/*
 	 * is there enough space to read the complete packet
 	 * or, should the data be split in to two reads.
@@ -1056,6 +2507,27 @@ static void `$INSTANCE_NAME`_ProcessRxData(uint8 socket, uint16 offset, uint8* b
 		 */
 		`$INSTANCE_NAME`_W51_ReadBlock(addr,buffer,length);
 	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Transfer data from the chip receive buffer to a local buffer
+ * \param socket the socket buffer from which the data will be read
+ * \param offset The offest in to the socket buffer
+ * \param *buffer pointer to the local buffer to hold the receive fifo data
+ * \param length the max number of bytes to be copied to the local buffer
+ * \param flags Flag settings to control read fifo options (lookahead)
+ */
+static void `$INSTANCE_NAME`_ProcessRxData(uint8 socket, uint16 offset, uint8* buffer, uint16 length, uint8 flags)
+{
+	uint16 base;
+	
+	/*
+	 * Read the offset pointer, and calculate the base address for the start of read
+	 * in to the chip buffers.  The data read will be offset by the offset byte count
+	 * specified in the parameters.
+	 */
+	base = `$INSTANCE_NAME`_GetSocketRxReadPtr(socket) + offset;
+	`$INSTANCE_NAME`_ReadRxBuffer(socket, base, buffer, length);
 	if ( (flags & 0x01) == 0 ) { /* V1.1: Added ==0 condition to lookahead flag check */
 		/* move the write pointer */
 		base += length;
@@ -1071,6 +2543,175 @@ static void `$INSTANCE_NAME`_ProcessRxData(uint8 socket, uint16 offset, uint8* b
 /* Driver Initialization */
 #if (1)
 /* ------------------------------------------------------------------------ */
+/**
+ * \brief Calculate the size of the socket buffers from a memory size register value
+ * \param msr the TMSR or RMSR value
+ * \param *base array to hold the base address of each socket buffer
+ * \param *size array to hold the size of each socket buffer
+ * \param start the address of the start of the buffer memory
+ * \returns the total memory requested, more than 8K when the last sockets
+ *  were left without memory
+ *
+ * Each socket uses two bits of the register (socket 0 in bits 0-1) to
+ * select 1K, 2K, 4K or 8K.  The memory is assigned to the sockets in order,
+ * so a socket is assigned no memory once the 8K has been used.
+ */
+static uint16 `$INSTANCE_NAME`_CalculateLayout(uint8 msr, uint16* base, uint16* size, uint16 start)
+{
+	uint16 total;
+	uint16 length;
+	uint8 socket;
+	
+	total = 0;
+	for(socket=0;socket<4;++socket) {
+		length = 0x0400 << ((msr >> (socket<<1)) & 0x03);
+		base[socket] = start + total;
+		size[socket] = ( (total + length) > 0x2000 ) ? 0 : length;
+		total += length;
+	}
+	return( total );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Assign the socket buffer memory
+ * \param tmsr the transmit memory size register value
+ * \param rmsr the receive memory size register value
+ */
+static void `$INSTANCE_NAME`_SetMemoryLayout(uint8 tmsr, uint8 rmsr)
+{
+	`$INSTANCE_NAME`_SetTxMemSize(tmsr);
+	`$INSTANCE_NAME`_SetRxMemSize(rmsr);
+	`$INSTANCE_NAME`_CalculateLayout(tmsr, &`$INSTANCE_NAME`_TxBufferBase[0], &`$INSTANCE_NAME`_TxBufferSize[0], 0x4000);
+	`$INSTANCE_NAME`_CalculateLayout(rmsr, &`$INSTANCE_NAME`_RxBufferBase[0], &`$INSTANCE_NAME`_RxBufferSize[0], 0x6000);
+}
+/* ------------------------------------------------------------------------ */
+cystatus
+`$INSTANCE_NAME`_SetSocketMemory(uint8 tmsr, uint8 rmsr)
+{
+	uint8 socket;
+	
+	/* the memory may only be re-assigned while all of the sockets are closed */
+	for(socket=0;socket<4;++socket) {
+		if (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != 0) {
+			return( CYRET_INVALID_STATE );
+		}
+	}
+	/*
+	 * As with the _TX_MEMORY/_RX_MEMORY layout written by _Init(), sockets
+	 * which do not fit in the 8K are assigned no memory, and are skipped
+	 * by _SocketOpen().  This is how a socket is given 4K or 8K.
+	 */
+	`$INSTANCE_NAME`_SetMemoryLayout(tmsr, rmsr);
+	
+	return( CYRET_SUCCESS );
+}
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Plan a memory assignment from the measured demand of each socket
+ * \param *demand the measured buffer demand of each socket
+ * \param used the number of leading sockets which must be given memory
+ * \returns the memory size register value
+ *
+ * Each of the used sockets starts with 1K.  The remaining memory is assigned
+ * by doubling the buffer of the socket whose demand is largest compared to
+ * its current size, as long as the demand filled the buffer and the total
+ * fits in 8K.  The sockets after the used ones only get the memory left
+ * over, which may be none, so that a single busy socket can be given 8K.
+ */
+static uint8 `$INSTANCE_NAME`_PlanMemory( const uint16* demand, uint8 used )
+{
+	uint8 code[4];
+	uint16 total;
+	uint16 length;
+	uint8 socket;
+	uint8 best;
+	
+	total = 0;
+	for(socket=0;socket<4;++socket) {
+		code[socket] = `$INSTANCE_NAME`_MEM_1K;
+		total += (socket < used) ? 0x0400 : 0;
+	}
+	do {
+		best = 0xFF;
+		for(socket=0;socket<used;++socket) {
+			length = 0x0400 << code[socket];
+			if ( (code[socket] < `$INSTANCE_NAME`_MEM_8K) && (demand[socket] >= length) && ((total + length) <= 0x2000) ) {
+				/* compare demand/size without dividing */
+				if ( (best == 0xFF) ||
+					( ((uint32)demand[socket] << code[best]) > ((uint32)demand[best] << code[socket]) ) ) {
+					best = socket;
+				}
+			}
+		}
+		if (best != 0xFF) {
+			total += 0x0400 << code[best];
+			++code[best];
+		}
+	}
+	while (best != 0xFF);
+	
+	return( `$INSTANCE_NAME`_MEMORY(code[0], code[1], code[2], code[3]) );
+}
+/* ------------------------------------------------------------------------ */
+cystatus
+`$INSTANCE_NAME`_GetMemoryProfile(uint8 socket, `$INSTANCE_NAME`_MEMORY_PROFILE* profile)
+{
+	if ( (socket >= 4) || (profile == NULL) ) {
+		return( CYRET_BAD_PARAM );
+	}
+	*profile = `$INSTANCE_NAME`_MemProfile[socket];
+	
+	return( CYRET_SUCCESS );
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_ClearMemoryProfile( void )
+{
+	uint8 socket;
+	
+	for(socket=0;socket<4;++socket) {
+		`$INSTANCE_NAME`_MemProfile[socket].RxHighWater = 0;
+		`$INSTANCE_NAME`_MemProfile[socket].TxHighWater = 0;
+		`$INSTANCE_NAME`_MemProfile[socket].TxStalls = 0;
+	}
+}
+/* ------------------------------------------------------------------------ */
+cystatus
+`$INSTANCE_NAME`_RebalanceMemory( void )
+{
+	uint16 rx[4];
+	uint16 tx[4];
+	uint8 socket;
+	uint8 used;
+	cystatus result;
+	
+	used = 1;
+	for(socket=0;socket<4;++socket) {
+		rx[socket] = `$INSTANCE_NAME`_MemProfile[socket].RxHighWater;
+		tx[socket] = `$INSTANCE_NAME`_MemProfile[socket].TxHighWater;
+		/* the sockets up to the last one with any traffic keep their memory */
+		if ( (rx[socket] != 0) || (tx[socket] != 0) ) {
+			used = socket + 1;
+		}
+	}
+	result = `$INSTANCE_NAME`_SetSocketMemory(`$INSTANCE_NAME`_PlanMemory(&tx[0], used), `$INSTANCE_NAME`_PlanMemory(&rx[0], used));
+	if (result == CYRET_SUCCESS) {
+		/*
+		 * Age the measurements rather than clearing them, so that the layout
+		 * follows changes in the traffic without swinging on a single session.
+		 */
+		for(socket=0;socket<4;++socket) {
+			`$INSTANCE_NAME`_MemProfile[socket].RxHighWater >>= 1;
+			`$INSTANCE_NAME`_MemProfile[socket].TxHighWater >>= 1;
+			`$INSTANCE_NAME`_MemProfile[socket].TxStalls = 0;
+		}
+	}
+	
+	return( result );
+}
+#endif
+/* ------------------------------------------------------------------------ */
 void
 `$INSTANCE_NAME`_Init(uint8* mac, uint32 ip, uint32 subnet, uint32 gateway)
 {
@@ -1090,13 +2731,24 @@ void
 	
 	/* Close all of the socket, and clear the memory to make them available. */
 	for(index=0;index<4;++index) {
+		`$INSTANCE_NAME`_SocketConfig[index].ServerFlag = `$INSTANCE_NAME`_LISTENER_NONE;
 		`$INSTANCE_NAME`_SocketClose( index );
 	}
 	/* Write the default configruation for memory size to the device */
-	`$INSTANCE_NAME`_SetTxMemSize(0x55); /* 2K each */
-	`$INSTANCE_NAME`_SetRxMemSize(0x55); /* 2K Each */
+	/* V1.3: configurable, defaults to 2K each */
+	`$INSTANCE_NAME`_SetMemoryLayout(`$INSTANCE_NAME`_TX_MEMORY, `$INSTANCE_NAME`_RX_MEMORY);
 	/* Set device gateway address */
 	`$INSTANCE_NAME`_SetGatewayAddress(gateway);
+	/* V1.3: retransmission settings, when not using the device defaults */
+#if (`$INSTANCE_NAME`_RETRY_TIME)
+	`$INSTANCE_NAME`_SetRetryTime( `$INSTANCE_NAME`_RETRY_TIME );
+#endif
+#if (`$INSTANCE_NAME`_RETRY_COUNT)
+	`$INSTANCE_NAME`_SetRetryCount( `$INSTANCE_NAME`_RETRY_COUNT );
+#endif
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+	`$INSTANCE_NAME`_RetryTime = `$INSTANCE_NAME`_GetRetryTime();
+#endif
 	`$INSTANCE_NAME`_SetSubnetMask( subnet );
 	/* Store the subnet mask for later use, for ERRATA fix */
 	`$INSTANCE_NAME`_SubnetMask = subnet;
@@ -1108,6 +2760,13 @@ void
 	`$INSTANCE_NAME`_SetIR(0xFF);
 	/* clear the subnet mask register (W5100 Errata Fix) */
 	`$INSTANCE_NAME`_SetSubnetMask( 0 );
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+	/* V1.3: the reset cleared the interrupt mask, so restore it */
+	if (`$INSTANCE_NAME`_IntEnabled != 0) {
+		`$INSTANCE_NAME`_IntPending = 1;
+		`$INSTANCE_NAME`_SetIMR(0x0F);
+	}
+#endif
 }
 /* ------------------------------------------------------------------------ */
 void
@@ -1141,6 +2800,10 @@ void
 	ip = `$INSTANCE_NAME`_ParseIP("`$IP`");
 	sub = `$INSTANCE_NAME`_ParseIP("`$SUBNET_MASK`");
 	gateway = `$INSTANCE_NAME`_ParseIP("`$GATEWAY`");
+#if (`$INSTANCE_NAME`_SPI_ASYNC)
+	/* V1.3: attach the asynchronous job handler to the SPI interrupt */
+	`$INSTANCE_NAME`_SpiAsyncStart();
+#endif
 	/* Initialize the device with the default data */
 	`$INSTANCE_NAME`_Init( &`$INSTANCE_NAME`_MAC[0], ip, sub, gateway  );
 }
@@ -1216,10 +2879,13 @@ cystatus `$INSTANCE_NAME`_ParseMAC(const char *macString, uint8 *mac)
 	for(digit = 0;(digit<6) && (result == CYRET_SUCCESS)&&(macString[index] != 0);++digit) {
 		// process the first nibble
 		if (`$INSTANCE_NAME`_ISXDIGIT(macString[index]) ) {
-			mac[digit] = `$INSTANCE_NAME`_HEX2BIN(macString[index++]);
+			/* V1.3: HEX2BIN evaluates its argument more than once */
+			mac[digit] = `$INSTANCE_NAME`_HEX2BIN(macString[index]);
+			++index;
 			mac[digit] <<= 4;
 			if (`$INSTANCE_NAME`_ISXDIGIT(macString[index])) {
-				mac[digit] += `$INSTANCE_NAME`_HEX2BIN(macString[index++]);
+				mac[digit] += `$INSTANCE_NAME`_HEX2BIN(macString[index]);
+				++index;
 				/*
 				 * now for digits other than digit 5 (the last one) look for
 				 * the dash seperator.  If there is no dash, return bad data
@@ -1312,33 +2978,143 @@ uint8
 		ok = 0xFF;
 	}
 	
-	return ok;
+	return ok;
+}
+/* ------------------------------------------------------------------------ */
+uint32
+`$INSTANCE_NAME`_GetIP( void )
+{
+	return `$INSTANCE_NAME`_GetSourceIP();
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_SetMAC( uint8* mac )
+{
+	`$INSTANCE_NAME`_SetSourceMAC( mac );
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_GetMAC( uint8* mac )
+{
+	`$INSTANCE_NAME`_GetSourceMAC( mac );
+}
+#endif
+/* ======================================================================== */
+/* Socket Controls */
+#if (1)
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Clear the subnet mask after a SEND or CONNECT : ERRATA FIX
+ *
+ * When asynchronous SENDs or CONNECTs are in progress, the subnet mask is
+ * left set until the last one has completed.
+ */
+static void `$INSTANCE_NAME`_ReleaseSubnetMask( void )
+{
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	if (`$INSTANCE_NAME`_SendPending != 0) {
+		return;
+	}
+#endif
+	if (`$INSTANCE_NAME`_ConnectPending != 0) {
+		return;
+	}
+	`$INSTANCE_NAME`_SetSubnetMask( 0 );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Record the result of a CONNECT, and release the subnet mask
+ * \param socket the socket which was connecting
+ * \param state the result of the connect (_CONNECT_xxx)
+ */
+static void `$INSTANCE_NAME`_ConnectFinish( uint8 socket, uint8 state )
+{
+	`$INSTANCE_NAME`_ConnectState[socket] = state;
+	if ( (`$INSTANCE_NAME`_ConnectPending & (1<<socket)) != 0) {
+		`$INSTANCE_NAME`_ConnectPending &= ~(1<<socket);
+		`$INSTANCE_NAME`_ReleaseSubnetMask();
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Open a closed listener socket and place it in LISTEN
+ * \param socket the socket number
+ * \param port the port on which to listen
+ */
+static void `$INSTANCE_NAME`_ListenArm( uint8 socket, uint16 port )
+{
+	`$INSTANCE_NAME`_SocketConfig[socket].Protocol = `$INSTANCE_NAME`_PROTO_TCP;
+	`$INSTANCE_NAME`_SocketConfig[socket].SocketFlags = 0;
+	`$INSTANCE_NAME`_SocketConfig[socket].SourcePort = port;
+	`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag = `$INSTANCE_NAME`_LISTENER_WAITING;
+	`$INSTANCE_NAME`_SetSocketSourcePort( socket, port );
+	`$INSTANCE_NAME`_SetSocketMode( socket, `$INSTANCE_NAME`_PROTO_TCP );
+	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_OPEN );
+	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_LISTEN );
+}
+/* ------------------------------------------------------------------------ */
+cystatus
+`$INSTANCE_NAME`_SocketSetMSS( uint8 socket, uint16 mss )
+{
+	uint16 limit;
+	
+	if (socket >= 4) {
+		return CYRET_BAD_PARAM;
+	}
+	/* the largest segment which fits an ethernet frame, and the buffer */
+	limit = (`$INSTANCE_NAME`_SocketConfig[socket].Protocol == `$INSTANCE_NAME`_PROTO_TCP) ? 1460 : 1472;
+	limit = (`$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) < limit) ? `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) : limit;
+	if ( (mss == 0) || (mss > limit) ) {
+		return CYRET_BAD_PARAM;
+	}
+	`$INSTANCE_NAME`_SetSocketMaxSegSize( socket, mss );
+	`$INSTANCE_NAME`_SocketConfig[socket].OptionsSet = 1;
+	
+	return CYRET_SUCCESS;
 }
 /* ------------------------------------------------------------------------ */
-uint32
-`$INSTANCE_NAME`_GetIP( void )
+cystatus
+`$INSTANCE_NAME`_SocketSetTOS( uint8 socket, uint8 tos )
 {
-	return `$INSTANCE_NAME`_GetSourceIP();
+	if (socket >= 4) {
+		return CYRET_BAD_PARAM;
+	}
+	`$INSTANCE_NAME`_SetSocketTOS( socket, tos );
+	`$INSTANCE_NAME`_SocketConfig[socket].OptionsSet = 1;
+	
+	return CYRET_SUCCESS;
 }
 /* ------------------------------------------------------------------------ */
-void
-`$INSTANCE_NAME`_SetMAC( uint8* mac )
+cystatus
+`$INSTANCE_NAME`_SocketSetTTL( uint8 socket, uint8 ttl )
 {
-	`$INSTANCE_NAME`_SetSourceMAC( mac );
+	if ( (socket >= 4) || (ttl == 0) ) {
+		return CYRET_BAD_PARAM;
+	}
+	`$INSTANCE_NAME`_SetSocketTTL( socket, ttl );
+	`$INSTANCE_NAME`_SocketConfig[socket].OptionsSet = 1;
+	
+	return CYRET_SUCCESS;
 }
 /* ------------------------------------------------------------------------ */
 void
-`$INSTANCE_NAME`_GetMAC( uint8* mac )
+`$INSTANCE_NAME`_SocketGetOptions( uint8 socket, `$INSTANCE_NAME`_SOCKET_OPTIONS* options )
 {
-	`$INSTANCE_NAME`_GetSourceMAC( mac );
+	if ( (socket < 4) && (options != NULL) ) {
+		options->MaxSegSize = `$INSTANCE_NAME`_GetSocketMaxSegSize( socket );
+		options->TypeOfService = `$INSTANCE_NAME`_GetSocketTOS( socket );
+		options->TimeToLive = `$INSTANCE_NAME`_GetSocketTTL( socket );
+	}
 }
-#endif
-/* ======================================================================== */
-/* Socket Controls */
-#if (1)
 /* ------------------------------------------------------------------------ */
 uint8
 `$INSTANCE_NAME`_SocketOpen( uint8 Protocol, uint16 port, uint8 flags )
+{
+	return `$INSTANCE_NAME`_SocketOpenOptions( Protocol, port, flags, NULL );
+}
+/* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_SocketOpenOptions( uint8 Protocol, uint16 port, uint8 flags, const `$INSTANCE_NAME`_SOCKET_OPTIONS* options )
 {
 	uint8 socket;
 	int index;
@@ -1352,7 +3128,9 @@ uint8
 	socket = 0xFF;
 	/* find the first available socket to open, and how much memory is available */
 	for( index = 0;index<4;++index) {
-		if ( (socket == 0xFF) && (`$INSTANCE_NAME`_SocketConfig[index].Protocol == 0) ) {
+		/* V1.3: sockets which have not been assigned buffer memory can not be used */
+		if ( (socket == 0xFF) && (`$INSTANCE_NAME`_SocketConfig[index].Protocol == 0) &&
+			(`$INSTANCE_NAME`_SOCKET_TX_SIZE(index) != 0) && (`$INSTANCE_NAME`_SOCKET_RX_SIZE(index) != 0) ) {
 			/*
 			 * Since the W5100 does not support MAC mode commucications, check to see
 			 * if the socket that is free was socket 0.  If the mac protocol was
@@ -1370,10 +3148,26 @@ uint8
 		`$INSTANCE_NAME`_SocketConfig[socket].SocketFlags = flags;
 		`$INSTANCE_NAME`_SocketConfig[socket].SourcePort = port;
 		`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag = 0;
+		/*
+		 * V1.3: apply the socket options before the socket is opened, zero
+		 * fields leave the device setting unchanged.
+		 */
+		if (options != NULL) {
+			if ( (options->MaxSegSize != 0) && (`$INSTANCE_NAME`_SocketSetMSS( socket, options->MaxSegSize ) != CYRET_SUCCESS) ) {
+				`$INSTANCE_NAME`_SocketConfig[socket].Protocol = 0;
+				return 0xFF;
+			}
+			if (options->TypeOfService != 0) {
+				`$INSTANCE_NAME`_SocketSetTOS( socket, options->TypeOfService );
+			}
+			if (options->TimeToLive != 0) {
+				`$INSTANCE_NAME`_SocketSetTTL( socket, options->TimeToLive );
+			}
+		}
 		/* Send the socket open with the correct protocol information */
 		`$INSTANCE_NAME`_SetSocketSourcePort( socket, port );
 		`$INSTANCE_NAME`_SetSocketMode( socket, Protocol | flags );
-		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 1 );
+		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_OPEN );
 	}
 	return socket;
 }
@@ -1390,9 +3184,48 @@ void
 		`$INSTANCE_NAME`_SocketConfig[socket].Protocol = 0;
 		`$INSTANCE_NAME`_SocketConfig[socket].SocketFlags = 0;
 		/* close the socket */
-		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 0x10 );
+		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_CLOSE );
 		/* Clear pending Interrupts */
 		`$INSTANCE_NAME`_SetSocketIR( socket, 0xFF);
+#if (`$INSTANCE_NAME`_COALESCE)
+		/* V1.3: data staged but not sent is discarded */
+		`$INSTANCE_NAME`_Staged[socket] = 0;
+		`$INSTANCE_NAME`_StagedAge[socket] = 0;
+#endif
+		/* V1.3: restore the device defaults of options set on this socket */
+		if (`$INSTANCE_NAME`_SocketConfig[socket].OptionsSet != 0) {
+			`$INSTANCE_NAME`_SocketConfig[socket].OptionsSet = 0;
+			`$INSTANCE_NAME`_SetSocketMaxSegSize( socket, 0 );
+			`$INSTANCE_NAME`_SetSocketTOS( socket, 0 );
+			`$INSTANCE_NAME`_SetSocketTTL( socket, 0x80 );
+		}
+#if (`$INSTANCE_NAME`_RECV_THRESHOLD)
+		`$INSTANCE_NAME`_RecvPending[socket] = 0;
+#endif
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+		`$INSTANCE_NAME`_SocketEvents[socket] = 0;
+#endif
+#if (`$INSTANCE_NAME`_POLL_ENABLE) && !(`$INSTANCE_NAME`_ASYNC_SEND)
+		`$INSTANCE_NAME`_SendReported &= ~(1<<socket);
+#endif
+#if (`$INSTANCE_NAME`_IDLE_MANAGER)
+		`$INSTANCE_NAME`_Managed &= ~(1<<socket);
+		`$INSTANCE_NAME`_Activity(socket);
+#endif
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+		`$INSTANCE_NAME`_SmoothRtt[socket] = 0;
+		`$INSTANCE_NAME`_SocketRto[socket] = 0;
+#endif
+		/* V1.3: abandon a CONNECT in progress */
+		`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_IDLE );
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+		`$INSTANCE_NAME`_SendComplete( socket, 1 );
+		`$INSTANCE_NAME`_TxCopied[socket] = 0;
+#endif
+		/* V1.3: sockets belonging to a listener go back to LISTEN */
+		if (`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag != `$INSTANCE_NAME`_LISTENER_NONE) {
+			`$INSTANCE_NAME`_ListenArm( socket, `$INSTANCE_NAME`_SocketConfig[socket].SourcePort );
+		}
 	}
 }
 /* ------------------------------------------------------------------------ */
@@ -1403,73 +3236,228 @@ uint8
 	
 	status = `$INSTANCE_NAME`_GetSocketStatus(socket);
 	/* has a connection termination been requested by remote system */
-	if (status == 0x1C) {
+	if (status == `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) {
 		/* Close the socket on this end */
 		`$INSTANCE_NAME`_SocketClose(socket);
+		/* V1.3: a listener socket is back in LISTEN, but the connection was closed */
+		if (`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag != `$INSTANCE_NAME`_LISTENER_NONE) {
+			return 1;
+		}
+		/* V1.3: only re-read the status when it was changed by the close */
+		status = `$INSTANCE_NAME`_GetSocketStatus(socket);
 	}
-	return (`$INSTANCE_NAME`_GetSocketStatus(socket) == 0x00);
+	return (status == `$INSTANCE_NAME`_SOCK_CLOSED);
 }
 /* ------------------------------------------------------------------------ */
 uint8
 `$INSTANCE_NAME`_SocketEstablished( uint8 socket )
 {
-	return (`$INSTANCE_NAME`_GetSocketStatus( socket ) == 0x17);
+	return (`$INSTANCE_NAME`_GetSocketStatus( socket ) == `$INSTANCE_NAME`_SOCK_ESTABLISHED);
 }
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
 /* ------------------------------------------------------------------------ */
 /**
- * \brief Transmit a SEND operation over a socket
- * \param socket the socket to which the send command will be sent
+ * \brief Update the round trip estimate of a socket, and the retry time
+ * \param socket the socket on which the time was measured
+ * \param rtt the time from SEND to SEND_OK (100us units)
+ *
+ * The estimate uses the smoothed round trip time and variation of RFC 6298
+ * (gains of 1/8 and 1/4), and the timeout is SRTT + 4*RTTVAR, limited to
+ * _RTO_MIN and _RTO_MAX.  The retry time register is shared by all of the
+ * sockets, so it is set to the largest timeout of the open sockets which
+ * have been sampled, and is only written when that changes.
+ *
+ * Only TCP sockets are sampled: their SEND_OK waits for the acknowledgement
+ * of the peer, while the SEND_OK of a UDP (or raw) SEND only means that the
+ * frame left the device.  The TCP send functions have read the socket status
+ * before issuing the SEND, so it is not read again here.
+ */
+static void `$INSTANCE_NAME`_RttSample( uint8 socket, uint16 rtt )
+{
+	int32 err;
+	int32 value;
+	uint32 rto;
+	uint16 retry;
+	uint8 index;
+	
+	if (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) {
+		return;
+	}
+	/* samples are limited so that the scaled estimates fit in 16 bits */
+	rtt = (rtt > 0x1FFF) ? 0x1FFF : rtt;
+	if (`$INSTANCE_NAME`_SmoothRtt[socket] == 0) {
+		/* the first sample, the estimate is kept non-zero */
+		`$INSTANCE_NAME`_SmoothRtt[socket] = (rtt << 3) | 1;
+		`$INSTANCE_NAME`_RttVar[socket] = rtt << 1;
+	}
+	else {
+		err = (int32)rtt - (`$INSTANCE_NAME`_SmoothRtt[socket] >> 3);
+		value = (int32)`$INSTANCE_NAME`_SmoothRtt[socket] + err;
+		`$INSTANCE_NAME`_SmoothRtt[socket] = (value < 1) ? 1 : (uint16)value;
+		err = (err < 0) ? -err : err;
+		value = (int32)`$INSTANCE_NAME`_RttVar[socket] + err - (`$INSTANCE_NAME`_RttVar[socket] >> 2);
+		`$INSTANCE_NAME`_RttVar[socket] = (value > 0xFFFF) ? 0xFFFF : (uint16)value;
+	}
+	rto = (uint32)(`$INSTANCE_NAME`_SmoothRtt[socket] >> 3) + `$INSTANCE_NAME`_RttVar[socket];
+	rto = (rto < `$INSTANCE_NAME`_RTO_MIN) ? `$INSTANCE_NAME`_RTO_MIN : rto;
+	rto = (rto > `$INSTANCE_NAME`_RTO_MAX) ? `$INSTANCE_NAME`_RTO_MAX : rto;
+	`$INSTANCE_NAME`_SocketRto[socket] = (uint16)rto;
+	
+	/* sockets which have not been sampled (SocketRto of 0) are skipped */
+	retry = 0;
+	for(index=0;index<4;++index) {
+		if ( (`$INSTANCE_NAME`_SocketConfig[index].Protocol != 0) && (`$INSTANCE_NAME`_SocketRto[index] > retry) ) {
+			retry = `$INSTANCE_NAME`_SocketRto[index];
+		}
+	}
+	if ( (retry != 0) && (retry != `$INSTANCE_NAME`_RetryTime) ) {
+		`$INSTANCE_NAME`_RetryTime = retry;
+		`$INSTANCE_NAME`_SetRetryTime( retry );
+	}
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_GetRoundTrip( uint8 socket )
+{
+	return (socket < 4) ? (`$INSTANCE_NAME`_SmoothRtt[socket] >> 3) : 0;
+}
+#endif
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Issue a SEND command, and wait for the completion
+ * \param socket the socket to which the command will be sent
+ * \param cmd the SEND command (SEND or SEND_MAC)
+ *
+ * V1.3: When the asynchronous send is enabled, this waits for the previous
+ * SEND of the socket to complete (the data for this SEND has already been
+ * copied while it was in progress), then returns as soon as the command has
+ * been accepted.
  */
 static void
-`$INSTANCE_NAME`_SocketSend(uint8 socket )
+`$INSTANCE_NAME`_SocketSendCommand( uint8 socket, uint8 cmd )
 {
+#if (`$INSTANCE_NAME`_COALESCE)
+	/* V1.3: the SEND transmits all of the data staged in the buffer */
+	`$INSTANCE_NAME`_Staged[socket] = 0;
+	`$INSTANCE_NAME`_StagedAge[socket] = 0;
+#endif
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	`$INSTANCE_NAME`_Activity(socket);
+	/* only one SEND may be in progress on a socket */
+	`$INSTANCE_NAME`_SendWait(socket);
+	/* initialize the subnet mask register : ERRATA FIX */
+	`$INSTANCE_NAME`_SetSubnetMask( `$INSTANCE_NAME`_SubnetMask );
+	/* Issue the SEND command */
+	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, cmd );
+	`$INSTANCE_NAME`_SendPending |= (1<<socket);
+#else
 	uint8 ir;
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+	uint16 rtt;
+#endif
 	
+	`$INSTANCE_NAME`_Activity(socket);
 	/* initialize the subnet mask register : ERRATA FIX */
 	`$INSTANCE_NAME`_SetSubnetMask( `$INSTANCE_NAME`_SubnetMask );
 	/* Issue the SEND command */
-	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 0x20 );
+	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, cmd );
 	/* wait for the SEND to complete, or for a timeout */
-	ir = `$INSTANCE_NAME`_GetSocketIR( socket );
+	ir = `$INSTANCE_NAME`_SocketFlags( socket );
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+	/*
+	 * V1.3: wait in 100us steps, so that the number of steps measures the
+	 * time from SEND to SEND_OK in the units of the retry time register.
+	 */
+	rtt = 0;
+	while ( ((ir & `$INSTANCE_NAME`_IR_SEND_OK) == 0) && (!(ir&(`$INSTANCE_NAME`_IR_TIMEOUT|`$INSTANCE_NAME`_IR_DISCON))) ) {
+		CyDelayUs(100);
+		rtt = (rtt < 0xFFFF) ? (rtt + 1) : rtt;
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+		/*
+		 * With the handler attached, the steps are counted until the device
+		 * signals an event, and the sample is taken from the SEND_OK event
+		 * without reading the interrupt registers in between.
+		 */
+		while ( (`$INSTANCE_NAME`_IntEnabled != 0) && (`$INSTANCE_NAME`_IntPending == 0) ) {
+			CyDelayUs(100);
+			rtt = (rtt < 0xFFFF) ? (rtt + 1) : rtt;
+		}
+#endif
+		ir = `$INSTANCE_NAME`_SocketFlags( socket );
+	}
+	/* only completed sends are sampled, a timeout includes retransmissions */
+	if ( (ir & `$INSTANCE_NAME`_IR_SEND_OK) != 0) {
+		`$INSTANCE_NAME`_RttSample( socket, rtt );
+	}
+#else
 	/* while SEND is not done, and the socket hasnot timed out or been dsconnected */
-	while ( ((ir & 0x10) == 0) && (!(ir&0x0A)) ) {
-		CyDelay(1);
-		ir = `$INSTANCE_NAME`_GetSocketIR( socket );
+	while ( ((ir & `$INSTANCE_NAME`_IR_SEND_OK) == 0) && (!(ir&(`$INSTANCE_NAME`_IR_TIMEOUT|`$INSTANCE_NAME`_IR_DISCON))) ) {
+		`$INSTANCE_NAME`_SocketIdle();
+		ir = `$INSTANCE_NAME`_SocketFlags( socket );
 		
 	}
+#endif
+#if (`$INSTANCE_NAME`_POLL_ENABLE)
+	if ( (ir & `$INSTANCE_NAME`_IR_SEND_OK) != 0) {
+		`$INSTANCE_NAME`_SendReported |= (1<<socket);
+	}
+#endif
 	/* clear the SEND_OK flag from the register */
-	`$INSTANCE_NAME`_SetSocketIR( socket, 0x10 );
-	/* reset the subnet mask : ERRATA FIX */
-	`$INSTANCE_NAME`_SetSubnetMask( 0 );
+	`$INSTANCE_NAME`_ClearSocketFlags( socket, `$INSTANCE_NAME`_IR_SEND_OK );
+	/* reset the subnet mask : ERRATA FIX (V1.3: unless a CONNECT needs it) */
+	`$INSTANCE_NAME`_ReleaseSubnetMask();
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Transmit a SEND operation over a socket
+ * \param socket the socket to which the send command will be sent
+ */
+static void
+`$INSTANCE_NAME`_SocketSend(uint8 socket )
+{
+	`$INSTANCE_NAME`_SocketSendCommand( socket, `$INSTANCE_NAME`_CMD_SEND );
 }
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Execute a SEND without an ARP.
  * \param socket the socket to which the SEND will be executed.
  */
-static void
+static CY_INLINE void
 `$INSTANCE_NAME`_SocketSendMac(uint8 socket )
 {
-	uint8 ir;
-	
-	/* initialize the subnet mask register : ERRATA FIX */
-	`$INSTANCE_NAME`_SetSubnetMask( `$INSTANCE_NAME`_SubnetMask );
-	/* Issue the SEND command */
-	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 0x21 );
-	/* wait for the SEND to complete, or for a timeout */
-	ir = `$INSTANCE_NAME`_GetSocketIR( socket );
-	/* while SEND is not done, and the socket hasnot timed out or been dsconnected */
-	while ( ((ir & 0x10) == 0) && (!(ir&0x0A)) ) {
-		CyDelay(1);
-		ir = `$INSTANCE_NAME`_GetSocketIR( socket );
-		
+	`$INSTANCE_NAME`_SocketSendCommand( socket, `$INSTANCE_NAME`_CMD_SEND_MAC );
+}
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Send the data copied by _TcpWrite() behind a completed SEND
+ * \param socket the socket number
+ */
+static void
+`$INSTANCE_NAME`_SocketSendCopied(uint8 socket )
+{
+	if (`$INSTANCE_NAME`_TxCopied[socket] != 0) {
+		`$INSTANCE_NAME`_CommitTxData( socket, `$INSTANCE_NAME`_GetTxAppendPtr(socket) );
+		`$INSTANCE_NAME`_SocketSend( socket );
 	}
-	/* clear the SEND_OK flag from the register */
-	`$INSTANCE_NAME`_SetSocketIR( socket, 0x10 );
-	/* reset the subnet mask : ERRATA FIX */
-	`$INSTANCE_NAME`_SetSubnetMask( 0 );
 }
 /* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_SocketSendDone( uint8 socket )
+{
+	if (socket >= 4) {
+		return( 1 );
+	}
+	if (`$INSTANCE_NAME`_SendCheck( socket, 1 ) == 0) {
+		return( 0 );
+	}
+	/* V1.3: data copied while the SEND was in progress is sent now */
+	`$INSTANCE_NAME`_SocketSendCopied( socket );
+	return( (`$INSTANCE_NAME`_SendPending & (1<<socket)) == 0 );
+}
+#endif
+/* ------------------------------------------------------------------------ */
 uint16
 `$INSTANCE_NAME`_SocketRxDataWaiting( uint8 socket )
 {
@@ -1477,25 +3465,379 @@ uint16
 }
 #endif
 /* ======================================================================== */
+/* Receive Cursor */
+#if (1)
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_RxBegin( uint8 socket, `$INSTANCE_NAME`_RX_CURSOR* cursor )
+{
+	cursor->Socket = socket;
+	cursor->Offset = 0;
+	cursor->Length = 0;
+	cursor->Base = 0;
+	if (socket < 4) {
+		cursor->Length = `$INSTANCE_NAME`_GetRxSize( socket );
+		cursor->Base = `$INSTANCE_NAME`_GetSocketRxReadPtr( socket );
+	}
+	return( cursor->Length );
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_RxPeek( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint16 offset, uint8* buffer, uint16 length )
+{
+	uint16 remain;
+	
+	remain = cursor->Length - cursor->Offset;
+	if (offset >= remain) {
+		return( 0 );
+	}
+	length = (length > (remain - offset)) ? (remain - offset) : length;
+	if (length > 0) {
+		`$INSTANCE_NAME`_ReadRxBuffer( cursor->Socket, cursor->Base + cursor->Offset + offset, buffer, length );
+	}
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_RxFind( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint8 delimiter )
+{
+	uint8 chunk[16];
+	uint16 position;
+	uint16 count;
+	uint16 index;
+	
+	/* scan the receive buffer memory in small pieces */
+	position = 0;
+	count = `$INSTANCE_NAME`_RxPeek( cursor, position, &chunk[0], sizeof(chunk) );
+	while (count > 0) {
+		for(index=0;index<count;++index) {
+			if (chunk[index] == delimiter) {
+				return( position + index );
+			}
+		}
+		position += count;
+		count = `$INSTANCE_NAME`_RxPeek( cursor, position, &chunk[0], sizeof(chunk) );
+	}
+	return( 0xFFFF );
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_RxSkip( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint16 length )
+{
+	uint16 remain;
+	
+	remain = cursor->Length - cursor->Offset;
+	length = (length > remain) ? remain : length;
+	cursor->Offset += length;
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_RxRead( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint8* buffer, uint16 length )
+{
+	length = `$INSTANCE_NAME`_RxPeek( cursor, 0, buffer, length );
+	cursor->Offset += length;
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_RxCommit( `$INSTANCE_NAME`_RX_CURSOR* cursor )
+{
+	if ( (cursor->Socket < 4) && (cursor->Offset > 0) ) {
+		/* release the consumed data with a single pointer update and RECV */
+		`$INSTANCE_NAME`_SetSocketRxReadPtr( cursor->Socket, cursor->Base + cursor->Offset );
+		`$INSTANCE_NAME`_SocketRecv( cursor->Socket, cursor->Offset );
+		cursor->Base += cursor->Offset;
+		cursor->Length -= cursor->Offset;
+		cursor->Offset = 0;
+	}
+}
+#endif
+/* ======================================================================== */
+/* Connection Manager */
+#if (`$INSTANCE_NAME`_IDLE_MANAGER)
+/* V1.3: keep-alive interval and idle timeout (ms), 0 when disabled */
+static uint16 `$INSTANCE_NAME`_KeepAliveTime = `$INSTANCE_NAME`_KEEPALIVE_TIME;
+static uint16 `$INSTANCE_NAME`_IdleTimeout = `$INSTANCE_NAME`_IDLE_TIMEOUT;
+static `$INSTANCE_NAME`_CONNECTION_STATS `$INSTANCE_NAME`_ConnectionStats;
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Add the elapsed time to a socket timer
+ * \param *timer the timer
+ * \param elapsed the time to add (ms)
+ */
+static void `$INSTANCE_NAME`_TimerAdd( uint16* timer, uint16 elapsed )
+{
+	*timer = ( (uint32)*timer + elapsed > 0xFFFF ) ? 0xFFFF : (*timer + elapsed);
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_SetIdleTimeout( uint16 keepAlive, uint16 timeout )
+{
+	`$INSTANCE_NAME`_KeepAliveTime = keepAlive;
+	`$INSTANCE_NAME`_IdleTimeout = timeout;
+}
+/* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_ManageConnections( uint16 elapsed )
+{
+	uint8 socket;
+	uint8 status;
+	uint8 reclaimed;
+	
+	reclaimed = 0;
+	for(socket=0;socket<4;++socket) {
+		if (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) {
+			continue;
+		}
+		status = `$INSTANCE_NAME`_GetSocketStatus( socket );
+		if (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) {
+			`$INSTANCE_NAME`_Managed |= (1<<socket);
+			`$INSTANCE_NAME`_TimerAdd( &`$INSTANCE_NAME`_IdleTime[socket], elapsed );
+			`$INSTANCE_NAME`_TimerAdd( &`$INSTANCE_NAME`_KeepTime[socket], elapsed );
+			if ( (`$INSTANCE_NAME`_IdleTimeout != 0) && (`$INSTANCE_NAME`_IdleTime[socket] >= `$INSTANCE_NAME`_IdleTimeout) ) {
+				/* the connection has been idle too long, free the socket */
+				`$INSTANCE_NAME`_SocketClose( socket );
+				++`$INSTANCE_NAME`_ConnectionStats.IdleReclaims;
+				++reclaimed;
+			}
+			else if ( (`$INSTANCE_NAME`_KeepAliveTime != 0) && (`$INSTANCE_NAME`_KeepTime[socket] >= `$INSTANCE_NAME`_KeepAliveTime) ) {
+				/*
+				 * Probe the remote host.  When the host does not answer, the
+				 * device times out and closes the socket, which is reclaimed
+				 * on a later call.
+				 */
+				`$INSTANCE_NAME`_KeepTime[socket] = 0;
+				`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_SEND_KEEP );
+				++`$INSTANCE_NAME`_ConnectionStats.KeepAlives;
+			}
+		}
+		else if ( (`$INSTANCE_NAME`_Managed & (1<<socket)) != 0) {
+			/*
+			 * A connection which was established has been closed by the remote
+			 * host, reset, or timed out: close the socket on this end.
+			 */
+			if ( (status == `$INSTANCE_NAME`_SOCK_CLOSED) || (status == `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) ) {
+				`$INSTANCE_NAME`_SocketClose( socket );
+				++`$INSTANCE_NAME`_ConnectionStats.DeadReclaims;
+				++reclaimed;
+			}
+		}
+	}
+	return reclaimed;
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_GetConnectionStats( `$INSTANCE_NAME`_CONNECTION_STATS* stats )
+{
+	if (stats != NULL) {
+		*stats = `$INSTANCE_NAME`_ConnectionStats;
+	}
+}
+#endif
+/* ======================================================================== */
+/* Socket Event Reactor */
+#if (`$INSTANCE_NAME`_POLL_ENABLE)
+/* V1.3: event handlers registered for each socket (NULL when not registered) */
+static const `$INSTANCE_NAME`_SOCKET_HANDLERS* `$INSTANCE_NAME`_Handlers[4];
+/* V1.3: sockets with receive data that has not yet been fully read */
+static uint8 `$INSTANCE_NAME`_RxPending;
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_SetSocketHandlers( uint8 socket, const `$INSTANCE_NAME`_SOCKET_HANDLERS* handlers )
+{
+	if (socket < 4) {
+		`$INSTANCE_NAME`_Handlers[socket] = handlers;
+		`$INSTANCE_NAME`_RxPending &= ~(1<<socket);
+	}
+}
+/* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_Poll( void )
+{
+	const `$INSTANCE_NAME`_SOCKET_HANDLERS* handlers;
+	uint8 socket;
+	uint8 events;
+	uint8 count;
+	uint16 size;
+#if !(`$INSTANCE_NAME`_INT_ENABLE)
+	uint8 pending;
+#endif
+
+	count = 0;
+	/*
+	 * Take a snapshot of the socket interrupts.  The common interrupt register
+	 * flags the sockets with events, so only the interrupt registers of those
+	 * sockets are read (or, with the interrupt engine, nothing is read until
+	 * the device signals an interrupt).
+	 */
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+	`$INSTANCE_NAME`_ServiceInterrupt();
+#else
+	pending = `$INSTANCE_NAME`_GetIR() & 0x0F;
+#endif
+	for(socket=0;socket<4;++socket) {
+		handlers = `$INSTANCE_NAME`_Handlers[socket];
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+		events = `$INSTANCE_NAME`_SocketEvents[socket];
+		`$INSTANCE_NAME`_SocketEvents[socket] = 0;
+#else
+		events = 0;
+		if ( (pending & (1<<socket)) != 0) {
+			events = `$INSTANCE_NAME`_GetSocketIR(socket);
+			`$INSTANCE_NAME`_SetSocketIR(socket, events);
+		}
+#endif
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+		if ( (events & (`$INSTANCE_NAME`_IR_SEND_OK|`$INSTANCE_NAME`_IR_TIMEOUT|`$INSTANCE_NAME`_IR_DISCON)) != 0) {
+			`$INSTANCE_NAME`_SendComplete( socket, 1 );
+		}
+#else
+		/* V1.3: a blocking SEND has already consumed its SEND_OK flag */
+		if ( (`$INSTANCE_NAME`_SendReported & (1<<socket)) != 0) {
+			`$INSTANCE_NAME`_SendReported &= ~(1<<socket);
+			events |= `$INSTANCE_NAME`_IR_SEND_OK;
+		}
+#endif
+		/* a non-blocking CONNECT completes with the CON, TIMEOUT or DISCON event */
+		if ( (`$INSTANCE_NAME`_ConnectPending & (1<<socket)) != 0) {
+			if ( (events & `$INSTANCE_NAME`_IR_CON) != 0) {
+				`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_ESTABLISHED );
+			}
+			else if ( (events & `$INSTANCE_NAME`_IR_TIMEOUT) != 0) {
+				`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_TIMEOUT );
+			}
+			else if ( (events & `$INSTANCE_NAME`_IR_DISCON) != 0) {
+				`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_REFUSED );
+			}
+		}
+		if (handlers == NULL) {
+			continue;
+		}
+		if ( ((events & `$INSTANCE_NAME`_IR_CON) != 0) && (handlers->Accept != NULL) ) {
+			handlers->Accept(socket, 0);
+			++count;
+		}
+		/*
+		 * The device only flags RECV when new data arrives, so the data handler
+		 * is called on each poll until the receive buffer has been emptied.
+		 */
+		if ( ((events & `$INSTANCE_NAME`_IR_RECV) != 0) && (handlers->Data != NULL) ) {
+			`$INSTANCE_NAME`_RxPending |= (1<<socket);
+		}
+		if ( (`$INSTANCE_NAME`_RxPending & (1<<socket)) != 0) {
+			size = `$INSTANCE_NAME`_GetRxSize(socket);
+			if (size == 0) {
+				`$INSTANCE_NAME`_RxPending &= ~(1<<socket);
+			}
+			else {
+				handlers->Data(socket, size);
+				++count;
+			}
+		}
+		if ( ((events & `$INSTANCE_NAME`_IR_SEND_OK) != 0) && (handlers->Writable != NULL) ) {
+			handlers->Writable(socket, `$INSTANCE_NAME`_GetTxFreeSize(socket));
+			++count;
+		}
+		if ( ((events & `$INSTANCE_NAME`_IR_TIMEOUT) != 0) && (handlers->Timeout != NULL) ) {
+			handlers->Timeout(socket, 0);
+			++count;
+		}
+		if ( ((events & `$INSTANCE_NAME`_IR_DISCON) != 0) && (handlers->Closed != NULL) ) {
+			handlers->Closed(socket, 0);
+			++count;
+		}
+	}
+
+	return( count );
+}
+#endif
+/* ======================================================================== */
 /* TCP/IP */
 #if (`$INCLUDE_TCP`)
 /* ------------------------------------------------------------------------ */
 uint8
-`$INSTANCE_NAME`_TcpOpen(uint16 port)
+`$INSTANCE_NAME`_TcpOpen(uint16 port)
+{
+	return `$INSTANCE_NAME`_SocketOpen(`$INSTANCE_NAME`_PROTO_TCP, port, 0);
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_TcpStartServer( uint8 socket )
+{
+	/*
+	 * Start a open socket listening for a connection
+	 */
+	/* was this a valid socket? */
+	if (socket < 4) {
+		/* Execute the listen command */
+		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_LISTEN );
+	}
+}
+/* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_TcpListen( uint16 port, uint8 count )
 {
-	return `$INSTANCE_NAME`_SocketOpen(`$INSTANCE_NAME`_PROTO_TCP, port, 0);
+	uint8 socket;
+	uint8 listening;
+	
+	listening = 0;
+	while (listening < count) {
+		socket = `$INSTANCE_NAME`_TcpOpen( port );
+		if (socket >= 4) {
+			break;
+		}
+		`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag = `$INSTANCE_NAME`_LISTENER_WAITING;
+		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_LISTEN );
+		++listening;
+	}
+	return listening;
 }
 /* ------------------------------------------------------------------------ */
-void
-`$INSTANCE_NAME`_TcpStartServer( uint8 socket )
+uint8
+`$INSTANCE_NAME`_TcpAccept( void )
 {
+	static uint8 next = 0;
+	uint8 index;
+	uint8 socket;
+	uint8 status;
+	
 	/*
-	 * Start a open socket listening for a connection
+	 * Scan the listener sockets starting after the last one accepted, so
+	 * that waiting connections are handed out in turn.
 	 */
-	/* was this a valid socket? */
-	if (socket < 4) {
-		/* Execute the listen command */
-		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 0x02 );
+	for(index=0;index<4;++index) {
+		socket = (next + index) & 0x03;
+		if (`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag == `$INSTANCE_NAME`_LISTENER_WAITING) {
+			status = `$INSTANCE_NAME`_GetSocketStatus( socket );
+			if ( (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) || (status == `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) ) {
+				/* hand out the connection, even if the client already sent FIN */
+				`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag = `$INSTANCE_NAME`_LISTENER_ACCEPTED;
+				next = (socket + 1) & 0x03;
+				return socket;
+			}
+			else if (status == `$INSTANCE_NAME`_SOCK_CLOSED) {
+				/* the connection failed before it was accepted */
+				`$INSTANCE_NAME`_SocketClose( socket );
+			}
+		}
+	}
+	return 0xFF;
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_TcpListenStop( void )
+{
+	uint8 socket;
+	uint8 flag;
+	
+	for(socket=0;socket<4;++socket) {
+		flag = `$INSTANCE_NAME`_SocketConfig[socket].ServerFlag;
+		`$INSTANCE_NAME`_SocketConfig[socket].ServerFlag = `$INSTANCE_NAME`_LISTENER_NONE;
+		/* accepted connections are left open, and are closed by the application */
+		if (flag == `$INSTANCE_NAME`_LISTENER_WAITING) {
+			`$INSTANCE_NAME`_SocketClose( socket );
+		}
 	}
 }
 /* ------------------------------------------------------------------------ */
@@ -1505,35 +3847,86 @@ void
 	`$INSTANCE_NAME`_TcpStartServer(socket);
 	/* wait for socket establishment */
 	while ( !`$INSTANCE_NAME`_SocketEstablished(socket) ) {
-		CyDelay(1);
+		`$INSTANCE_NAME`_SocketIdle();
 	}
 }
 /* ------------------------------------------------------------------------ */
-void
+uint8
 `$INSTANCE_NAME`_TcpConnect( uint8 socket, uint32 ip, uint16 port )
 {
 	uint32 timeout;
-	uint8 ir;
+	uint8 state;
+	
+	/*
+	 * V1.3: The wait was not initialized, and the result was not returned.
+	 * The connect is now started using the non-blocking connect, and the
+	 * state is polled once per millisecond.
+	 */
+	if (`$INSTANCE_NAME`_TcpConnectStart( socket, ip, port ) != CYRET_STARTED) {
+		return `$INSTANCE_NAME`_CONNECT_IDLE;
+	}
+	timeout = 0;
+	state = `$INSTANCE_NAME`_TcpConnectStatus( socket );
+	while ( (state == `$INSTANCE_NAME`_CONNECT_IN_PROGRESS) && (timeout < `$TIMEOUT`) ) {
+		CyDelay(1);
+		++timeout;
+		state = `$INSTANCE_NAME`_TcpConnectStatus( socket );
+	}
+	if (state == `$INSTANCE_NAME`_CONNECT_IN_PROGRESS) {
+		/* stop waiting, and clear the Subnet mask register */
+		`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_TIMEOUT );
+		state = `$INSTANCE_NAME`_CONNECT_TIMEOUT;
+	}
+	return state;
+}
+/* ------------------------------------------------------------------------ */
+cystatus
+`$INSTANCE_NAME`_TcpConnectStart( uint8 socket, uint32 ip, uint16 port )
+{
+	if ( (socket >= 4) || (ip == 0xFFFFFFFF) || (ip == 0) ||
+		(`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) ) {
+		return CYRET_BAD_PARAM;
+	}
+	/* the socket must be open, and not connected or listening */
+	if (`$INSTANCE_NAME`_GetSocketStatus( socket ) != `$INSTANCE_NAME`_SOCK_INIT) {
+		return CYRET_INVALID_STATE;
+	}
+	`$INSTANCE_NAME`_SetSocketDestIP( socket, ip );
+	`$INSTANCE_NAME`_SetSocketDestPort( socket, port );
+	/* set socket subnet mask, it is released when the connect completes */
+	`$INSTANCE_NAME`_SetSubnetMask( `$INSTANCE_NAME`_SubnetMask );
+	`$INSTANCE_NAME`_ConnectPending |= (1<<socket);
+	`$INSTANCE_NAME`_ConnectState[socket] = `$INSTANCE_NAME`_CONNECT_IN_PROGRESS;
+	`$INSTANCE_NAME`_ExecuteSocketCommand( socket, `$INSTANCE_NAME`_CMD_CONNECT);
 	
-	if ( (ip != 0xFFFFFFFF) && (ip != 0) ) {
-		`$INSTANCE_NAME`_SetSocketDestIP( socket, ip );
-		`$INSTANCE_NAME`_SetSocketDestPort( socket, port );
-		/* set socket subnet mask */
-		`$INSTANCE_NAME`_SetSubnetMask( `$INSTANCE_NAME`_SubnetMask );
-		`$INSTANCE_NAME`_ExecuteSocketCommand( socket, 0x04);
-		/* wait for the socket connection to the remote host is established */
-		while ( (!`$INSTANCE_NAME`_SocketEstablished(socket))  && (timeout < `$TIMEOUT`) ) {
-			CyDelay(1);
-			++timeout;
-			ir = `$INSTANCE_NAME`_GetSocketIR( socket );
-			if ( (ir & 0x08) != 0 ) {
-				/* internal chip timeout occured */
-				timeout = `$TIMEOUT`;
+	return CYRET_STARTED;
+}
+/* ------------------------------------------------------------------------ */
+uint8
+`$INSTANCE_NAME`_TcpConnectStatus( uint8 socket )
+{
+	uint8 status;
+	
+	if (socket >= 4) {
+		return `$INSTANCE_NAME`_CONNECT_IDLE;
+	}
+	if ( (`$INSTANCE_NAME`_ConnectPending & (1<<socket)) != 0) {
+		status = `$INSTANCE_NAME`_GetSocketStatus( socket );
+		if ( (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) || (status == `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) ) {
+			`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_ESTABLISHED );
+		}
+		else if (status == `$INSTANCE_NAME`_SOCK_CLOSED) {
+			/* the device closes the socket on a timeout, or when the connect is reset */
+			if ( (`$INSTANCE_NAME`_SocketFlags( socket ) & `$INSTANCE_NAME`_IR_TIMEOUT) != 0) {
+				`$INSTANCE_NAME`_ClearSocketFlags( socket, `$INSTANCE_NAME`_IR_TIMEOUT );
+				`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_TIMEOUT );
+			}
+			else {
+				`$INSTANCE_NAME`_ConnectFinish( socket, `$INSTANCE_NAME`_CONNECT_REFUSED );
 			}
 		}
-		/* clear the Subnet mask register */
-		`$INSTANCE_NAME`_SetSubnetMask(0);
 	}
+	return `$INSTANCE_NAME`_ConnectState[socket];
 }
 /* ------------------------------------------------------------------------ */
 uint8
@@ -1543,7 +3936,15 @@ uint8
 void
 `$INSTANCE_NAME`_TcpDisconnect( uint8 socket )
 {
-	`$INSTANCE_NAME`_ExecuteSocketCommand(socket, 0x08);
+#if (`$INSTANCE_NAME`_COALESCE)
+	/* V1.3: send the staged data ahead of the FIN */
+	`$INSTANCE_NAME`_TcpFlush(socket);
+#endif
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	/* V1.3: and the data copied by _TcpWrite() */
+	`$INSTANCE_NAME`_SocketSendCopied(socket);
+#endif
+	`$INSTANCE_NAME`_ExecuteSocketCommand(socket, `$INSTANCE_NAME`_CMD_DISCON);
 }
 /* ------------------------------------------------------------------------ */
 uint16
@@ -1553,19 +3954,27 @@ uint16
 	uint16 FreeSpace;
 	uint8 status;
 	
-	TxSize =  (len > 0x0800) ? 0x0800 : len;
 	/* check the connection status, and protocol of the socket */
 	status = `$INSTANCE_NAME`_GetSocketStatus(socket);
-	if ( ( status == 0x17) && (`$INSTANCE_NAME`_SocketConfig[socket].Protocol == `$INSTANCE_NAME`_PROTO_TCP) ) {
+	if ( ( status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) && (`$INSTANCE_NAME`_SocketConfig[socket].Protocol == `$INSTANCE_NAME`_PROTO_TCP) ) {
+		/* V1.3: limit the length to the size of the socket transmit buffer */
+		TxSize = (len > `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket)) ? `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) : len;
 		/* 
 		 * The socket was open with the correct protocol and is connected to
 		 * a valid remote system. In order to send the requested packet data,
 		 * first, we must wait for the available buffer memory to be free
 		 * in the transmit buffer fifo.
 		 */
-		FreeSpace = 0;
-		status = 0x17;
-		while ( (FreeSpace < TxSize) && ( (status == 0x17) && (status != 0x1C) ) ) {
+		FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+		`$INSTANCE_NAME`_ProfileTx(socket, FreeSpace, len);
+#if (`$INSTANCE_NAME`_COALESCE)
+		/* V1.3: the staged data only frees its memory once it is sent */
+		if ( (FreeSpace < TxSize) && (`$INSTANCE_NAME`_Staged[socket] != 0) ) {
+			`$INSTANCE_NAME`_SocketSend( socket );
+		}
+#endif
+		status = `$INSTANCE_NAME`_SOCK_ESTABLISHED;
+		while ( (FreeSpace < TxSize) && ( (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) && (status != `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) ) ) {
 			FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
 			status = `$INSTANCE_NAME`_GetSocketStatus( socket );
 		}
@@ -1587,6 +3996,110 @@ uint16
 }
 /* ------------------------------------------------------------------------ */
 uint16
+`$INSTANCE_NAME`_TcpSendv(uint8 socket, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count)
+{
+	uint16 TxSize;
+	uint16 FreeSpace;
+	uint8 status;
+	
+	TxSize = `$INSTANCE_NAME`_IovLength(socket, iov, count);
+	/* check the connection status, and protocol of the socket */
+	status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+	if ( ( status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) && (`$INSTANCE_NAME`_SocketConfig[socket].Protocol == `$INSTANCE_NAME`_PROTO_TCP) ) {
+		/* wait for room in the transmit buffer for all of the segments */
+		FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+		`$INSTANCE_NAME`_ProfileTx(socket, FreeSpace, TxSize);
+#if (`$INSTANCE_NAME`_COALESCE)
+		/* V1.3: the staged data only frees its memory once it is sent */
+		if ( (FreeSpace < TxSize) && (`$INSTANCE_NAME`_Staged[socket] != 0) ) {
+			`$INSTANCE_NAME`_SocketSend( socket );
+		}
+#endif
+		while ( (FreeSpace < TxSize) && (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+			FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+			status = `$INSTANCE_NAME`_GetSocketStatus( socket );
+		}
+		/* write the segments, then send them with a single SEND command */
+		`$INSTANCE_NAME`_ProcessTxVector(socket, iov, count, TxSize);
+		`$INSTANCE_NAME`_SocketSend( socket );
+	}
+	else {
+		TxSize = 0;
+	}
+	return TxSize;
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_TcpWrite(uint8 socket, uint8* buffer, uint16 len)
+{
+	uint16 TxSize;
+	
+	if ( (socket >= 4) || (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) ||
+		(`$INSTANCE_NAME`_GetSocketStatus(socket) != `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+		return 0;
+	}
+	/* write as much of the data as will fit in the free transmit memory */
+	TxSize = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+	`$INSTANCE_NAME`_ProfileTx(socket, TxSize, len);
+	TxSize = (TxSize > len) ? len : TxSize;
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	if (`$INSTANCE_NAME`_SendCheck( socket, 1 ) == 0) {
+		/*
+		 * V1.3: The write pointer may not be moved while the previous SEND
+		 * is in progress, so the data is copied behind it, and is sent by
+		 * the next send once that SEND has completed.
+		 */
+		if (TxSize > 0) {
+			`$INSTANCE_NAME`_WriteTxBuffer(socket, `$INSTANCE_NAME`_GetTxAppendPtr(socket), buffer, TxSize);
+			`$INSTANCE_NAME`_TxCopied[socket] += TxSize;
+		}
+		return TxSize;
+	}
+#endif
+	if (TxSize > 0) {
+		`$INSTANCE_NAME`_ProcessTxData(socket, 0, buffer, TxSize);
+		`$INSTANCE_NAME`_SocketSend( socket );
+	}
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	else {
+		`$INSTANCE_NAME`_SocketSendCopied( socket );
+	}
+#endif
+	return TxSize;
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_TcpSendStream(uint8 socket, uint8* buffer, uint16 len)
+{
+	uint16 sent;
+	uint16 TxSize;
+	uint8 status;
+	
+	sent = 0;
+	if ( (socket >= 4) || (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) ) {
+		return 0;
+	}
+	status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+	/*
+	 * Rather than waiting for enough memory for the whole buffer, send the
+	 * data in pieces as the transmit memory becomes free, so that the
+	 * transmit buffer of the device is kept full.
+	 */
+	while ( (sent < len) && (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+		TxSize = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+		`$INSTANCE_NAME`_ProfileTx(socket, TxSize, len - sent);
+		TxSize = (TxSize > (len - sent)) ? (len - sent) : TxSize;
+		if (TxSize > 0) {
+			`$INSTANCE_NAME`_ProcessTxData(socket, 0, &buffer[sent], TxSize);
+			`$INSTANCE_NAME`_SocketSend( socket );
+			sent += TxSize;
+		}
+		status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+	}
+	return sent;
+}
+/* ------------------------------------------------------------------------ */
+uint16
 `$INSTANCE_NAME`_TcpReceive( uint8 socket, uint8* buffer, uint16 length )
 {
 	uint16 RxSize;
@@ -1597,7 +4110,7 @@ uint16
 	 */
 //	RxSize = 0;
 
-//	if ( `$INSTANCE_NAME`_GetSocketStatus( socket ) == 0x17) {
+//	if ( `$INSTANCE_NAME`_GetSocketStatus( socket ) == `$INSTANCE_NAME`_SOCK_ESTABLISHED) {
 		/*
 		 * read the number of waiting bytes in the buffer memory
 		 * but, clip the length of data read to the requested
@@ -1612,7 +4125,7 @@ uint16
 			 * after reading the buffer data, send the receive command
 			 * to the socket so that the W5100 completes the read
 			 */
-			`$INSTANCE_NAME`_ExecuteSocketCommand(socket, 0x40);
+			`$INSTANCE_NAME`_SocketRecv(socket, RxSize);
 		}
 //	}
 	
@@ -1620,10 +4133,390 @@ uint16
 	return RxSize;
 }
 /* ------------------------------------------------------------------------ */
+#if (`$INSTANCE_NAME`_COALESCE)
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_TcpQueue(uint8 socket, const uint8* buffer, uint16 len)
+{
+	uint16 queued;
+	uint16 TxSize;
+	uint16 threshold;
+	uint8 status;
+	
+	queued = 0;
+	if ( (socket >= 4) || (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) ) {
+		return 0;
+	}
+	threshold = (`$INSTANCE_NAME`_COALESCE_SIZE > `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket)) ?
+		`$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) : `$INSTANCE_NAME`_COALESCE_SIZE;
+	status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+	while ( (queued < len) && (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+		/*
+		 * The data is written to the transmit buffer, and the write pointer
+		 * is moved, but the SEND is deferred.  The free size reported by the
+		 * device already accounts for the staged data.
+		 */
+		TxSize = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+		TxSize = (TxSize > (len - queued)) ? (len - queued) : TxSize;
+		if (TxSize > 0) {
+			`$INSTANCE_NAME`_ProcessTxData(socket, 0, (uint8*)&buffer[queued], TxSize);
+			`$INSTANCE_NAME`_Staged[socket] += TxSize;
+			queued += TxSize;
+		}
+		/* send once a segment worth has been staged, or when the buffer is full */
+		if ( (`$INSTANCE_NAME`_Staged[socket] >= threshold) || ((TxSize == 0) && (`$INSTANCE_NAME`_Staged[socket] != 0)) ) {
+			`$INSTANCE_NAME`_SocketSend( socket );
+		}
+		else if (TxSize == 0) {
+			status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+		}
+	}
+	return queued;
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_TcpFlush( uint8 socket )
+{
+	uint8 status;
+	
+	if ( (socket < 4) && (`$INSTANCE_NAME`_Staged[socket] != 0) ) {
+		status = `$INSTANCE_NAME`_GetSocketStatus(socket);
+		if ( (status == `$INSTANCE_NAME`_SOCK_ESTABLISHED) || (status == `$INSTANCE_NAME`_SOCK_CLOSE_WAIT) ) {
+			`$INSTANCE_NAME`_SocketSend( socket );
+		}
+		else {
+			/* the connection was lost, so the staged data can not be sent */
+			`$INSTANCE_NAME`_Staged[socket] = 0;
+			`$INSTANCE_NAME`_StagedAge[socket] = 0;
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+void
+`$INSTANCE_NAME`_TcpFlushTimer( uint16 elapsed )
+{
+	uint8 socket;
+	
+	for(socket=0;socket<4;++socket) {
+		if (`$INSTANCE_NAME`_Staged[socket] != 0) {
+			`$INSTANCE_NAME`_StagedAge[socket] = ( (uint32)`$INSTANCE_NAME`_StagedAge[socket] + elapsed > 0xFFFF ) ?
+				0xFFFF : (`$INSTANCE_NAME`_StagedAge[socket] + elapsed);
+			if (`$INSTANCE_NAME`_StagedAge[socket] >= `$INSTANCE_NAME`_COALESCE_TIME) {
+				`$INSTANCE_NAME`_TcpFlush( socket );
+			}
+		}
+	}
+}
+#endif
+/* ------------------------------------------------------------------------ */
 void
 `$INSTANCE_NAME`_TcpPrint( uint8 socket, const char* str )
 {
+#if (`$INSTANCE_NAME`_COALESCE)
+	/* V1.3: stage the string, it is sent with the following output */
+	`$INSTANCE_NAME`_TcpQueue(socket, (const uint8*)str, strlen(str));
+#else
 	`$INSTANCE_NAME`_TcpSend(socket, (uint8*)str, strlen(str));
+#endif
+}
+/* ------------------------------------------------------------------------ */
+/* V1.3: size of the block of formatted characters written to the device at once */
+#define `$INSTANCE_NAME`_PRINTF_CHUNK    ( 16 )
+/**
+ * \brief State of the formatted output of _TcpPrintf()
+ */
+typedef struct
+{
+	uint8  Socket;
+	uint8  Error;     /* set when the connection was lost */
+	uint16 Ptr;       /* local copy of the transmit write pointer */
+	uint16 Free;      /* free transmit memory after the write pointer */
+	uint16 Unsent;    /* bytes written since the last SEND */
+	uint16 Count;     /* total number of characters written */
+	uint8  Length;    /* characters waiting in Chunk */
+	uint8  Chunk[`$INSTANCE_NAME`_PRINTF_CHUNK];
+} `$INSTANCE_NAME`_PRINTF_STATE;
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write the waiting formatted characters in to the transmit buffer
+ * \param *state the output state
+ *
+ * When the transmit buffer is full, the data written so far is sent, and
+ * the output waits for the device to free the memory.
+ */
+static void `$INSTANCE_NAME`_PrintfFlush( `$INSTANCE_NAME`_PRINTF_STATE* state )
+{
+	uint8 offset;
+	uint16 size;
+	
+	offset = 0;
+	while ( (offset < state->Length) && (state->Error == 0) ) {
+		if (state->Free == 0) {
+			if (state->Unsent != 0) {
+				`$INSTANCE_NAME`_CommitTxData( state->Socket, state->Ptr );
+				`$INSTANCE_NAME`_SocketSend( state->Socket );
+				state->Unsent = 0;
+			}
+			state->Free = `$INSTANCE_NAME`_GetTxFreeSize( state->Socket );
+			if ( (state->Free == 0) && (`$INSTANCE_NAME`_GetSocketStatus( state->Socket ) != `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+				state->Error = 1;
+			}
+		}
+		else {
+			size = state->Length - offset;
+			size = (size > state->Free) ? state->Free : size;
+			`$INSTANCE_NAME`_WriteTxBuffer( state->Socket, state->Ptr, &state->Chunk[offset], size );
+			state->Ptr += size;
+			state->Free -= size;
+			state->Unsent += size;
+			state->Count += size;
+			offset += (uint8)size;
+		}
+	}
+	state->Length = 0;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Output a character
+ * \param *state the output state
+ * \param c the character
+ */
+static void `$INSTANCE_NAME`_PrintfChar( `$INSTANCE_NAME`_PRINTF_STATE* state, char c )
+{
+	state->Chunk[state->Length++] = (uint8)c;
+	if (state->Length >= `$INSTANCE_NAME`_PRINTF_CHUNK) {
+		`$INSTANCE_NAME`_PrintfFlush( state );
+	}
+}
+/* ------------------------------------------------------------------------ */
+/* V1.3: _TcpPrintf() conversion flags */
+#define `$INSTANCE_NAME`_PF_LEFT    ( 0x01 )
+#define `$INSTANCE_NAME`_PF_ZERO    ( 0x02 )
+#define `$INSTANCE_NAME`_PF_LONG    ( 0x04 )
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Output a padded field
+ * \param *state the output state
+ * \param *str the characters of the field
+ * \param length the number of characters
+ * \param width the minimum width of the field
+ * \param flags _PF_LEFT to pad on the right, _PF_ZERO to pad with zeros
+ *
+ * With zero padding, a leading sign is placed ahead of the zeros.
+ */
+static void `$INSTANCE_NAME`_PrintfField( `$INSTANCE_NAME`_PRINTF_STATE* state, const char* str, uint16 length, uint16 width, uint8 flags )
+{
+	uint16 pad;
+	
+	pad = (width > length) ? (width - length) : 0;
+	if ( (flags & `$INSTANCE_NAME`_PF_ZERO) != 0) {
+		if ( (length > 0) && (*str == '-') ) {
+			`$INSTANCE_NAME`_PrintfChar( state, *str++ );
+			--length;
+		}
+		while (pad > 0) {
+			`$INSTANCE_NAME`_PrintfChar( state, '0' );
+			--pad;
+		}
+	}
+	else if ( (flags & `$INSTANCE_NAME`_PF_LEFT) == 0) {
+		while (pad > 0) {
+			`$INSTANCE_NAME`_PrintfChar( state, ' ' );
+			--pad;
+		}
+	}
+	while (length > 0) {
+		`$INSTANCE_NAME`_PrintfChar( state, *str++ );
+		--length;
+	}
+	while (pad > 0) {
+		`$INSTANCE_NAME`_PrintfChar( state, ' ' );
+		--pad;
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Convert a number to text
+ * \param *text buffer to hold the text (at least 24 characters)
+ * \param value the magnitude of the number
+ * \param negative non-zero to place a minus sign ahead of the number
+ * \param radix 10 or 16
+ * \param upper non-zero for upper case hexadecimal digits
+ * \param minimum the minimum number of digits (the precision), padded with
+ *  leading zeros.  A value of 0 with a minimum of 0 has no digits.
+ * \returns the number of characters
+ */
+static uint8 `$INSTANCE_NAME`_PrintfNumber( char* text, uint32 value, uint8 negative, uint8 radix, uint8 upper, uint8 minimum )
+{
+	char digits[24];
+	uint8 count;
+	uint8 length;
+	uint8 d;
+	
+	/* generate the digits, least significant first */
+	count = 0;
+	while ( (value != 0) || (count < minimum) ) {
+		d = (uint8)(value % radix);
+		value /= radix;
+		digits[count++] = (d < 10) ? ('0' + d) : ( (upper ? 'A' : 'a') + d - 10 );
+	}
+	
+	length = 0;
+	if (negative) {
+		text[length++] = '-';
+	}
+	while (count > 0) {
+		text[length++] = digits[--count];
+	}
+	return length;
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_TcpPrintf( uint8 socket, const char* format, ... )
+{
+	`$INSTANCE_NAME`_PRINTF_STATE state;
+	va_list args;
+	char text[24];
+	const char* str;
+	uint32 value;
+	int32 svalue;
+	uint16 length;
+	uint16 width;
+	uint16 precision;
+	uint8 digits;
+	uint8 flags;
+	uint8 negative;
+#if (`$INSTANCE_NAME`_COALESCE)
+	uint16 threshold;
+#endif
+	
+	if ( (socket >= 4) || (`$INSTANCE_NAME`_SocketConfig[socket].Protocol != `$INSTANCE_NAME`_PROTO_TCP) ||
+		(`$INSTANCE_NAME`_GetSocketStatus(socket) != `$INSTANCE_NAME`_SOCK_ESTABLISHED) ) {
+		return 0;
+	}
+	state.Socket = socket;
+	state.Error = 0;
+	state.Ptr = `$INSTANCE_NAME`_GetTxAppendPtr( socket );
+	state.Free = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+	state.Unsent = 0;
+	state.Count = 0;
+	state.Length = 0;
+	
+	va_start(args, format);
+	while ( (*format != 0) && (state.Error == 0) ) {
+		if (*format != '%') {
+			`$INSTANCE_NAME`_PrintfChar( &state, *format++ );
+			continue;
+		}
+		++format;
+		/* flags, width, precision and length */
+		flags = 0;
+		while ( (*format == '-') || (*format == '0') ) {
+			flags |= (*format == '-') ? `$INSTANCE_NAME`_PF_LEFT : `$INSTANCE_NAME`_PF_ZERO;
+			++format;
+		}
+		if ( (flags & `$INSTANCE_NAME`_PF_LEFT) != 0) {
+			flags &= ~`$INSTANCE_NAME`_PF_ZERO;
+		}
+		width = 0;
+		while ( (*format >= '0') && (*format <= '9') ) {
+			width = (width * 10) + (*format++ - '0');
+		}
+		precision = 0xFFFF;
+		if (*format == '.') {
+			++format;
+			precision = 0;
+			while ( (*format >= '0') && (*format <= '9') ) {
+				precision = (precision * 10) + (*format++ - '0');
+			}
+		}
+		/* V1.3: integers have at least one digit, and at most 20 zero padded digits */
+		digits = 1;
+		if (precision != 0xFFFF) {
+			/* as in the C library, the 0 flag is ignored when there is a precision */
+			digits = (precision > 20) ? 20 : (uint8)precision;
+			flags &= ~`$INSTANCE_NAME`_PF_ZERO;
+		}
+		if (*format == 'l') {
+			flags |= `$INSTANCE_NAME`_PF_LONG;
+			++format;
+		}
+		/* conversion */
+		length = 0;
+		str = text;
+		switch (*format) {
+		case 'd':
+		case 'i':
+			if ( (flags & `$INSTANCE_NAME`_PF_LONG) != 0) {
+				svalue = va_arg(args, long);
+			}
+			else {
+				svalue = va_arg(args, int);
+			}
+			negative = (svalue < 0);
+			value = negative ? (uint32)(-(svalue + 1)) + 1 : (uint32)svalue;
+			length = `$INSTANCE_NAME`_PrintfNumber( text, value, negative, 10, 0, digits );
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			if ( (flags & `$INSTANCE_NAME`_PF_LONG) != 0) {
+				value = va_arg(args, unsigned long);
+			}
+			else {
+				value = va_arg(args, unsigned int);
+			}
+			if (*format == 'u') {
+				length = `$INSTANCE_NAME`_PrintfNumber( text, value, 0, 10, 0, digits );
+			}
+			else {
+				length = `$INSTANCE_NAME`_PrintfNumber( text, value, 0, 16, (*format == 'X'), digits );
+			}
+			break;
+		case 'c':
+			text[0] = (char)va_arg(args, int);
+			length = 1;
+			break;
+		case 's':
+			str = va_arg(args, const char*);
+			str = (str == NULL) ? "(null)" : str;
+			/* V1.3: strings are not limited, other than by the precision */
+			while ( (length < precision) && (str[length] != 0) ) {
+				++length;
+			}
+			flags &= ~`$INSTANCE_NAME`_PF_ZERO;
+			break;
+		case '%':
+			text[0] = '%';
+			length = 1;
+			break;
+		default:
+			/* unknown conversion, or the end of the format string */
+			--format;
+			break;
+		}
+		`$INSTANCE_NAME`_PrintfField( &state, str, length, width, flags );
+		++format;
+	}
+	va_end(args);
+	
+	/* write the remaining characters, then send all of the unsent data */
+	`$INSTANCE_NAME`_PrintfFlush( &state );
+	if (state.Unsent != 0) {
+		`$INSTANCE_NAME`_CommitTxData( socket, state.Ptr );
+#if (`$INSTANCE_NAME`_COALESCE)
+		/* stage the output, as for _TcpPrint(), with the threshold of _TcpQueue() */
+		threshold = (`$INSTANCE_NAME`_COALESCE_SIZE > `$INSTANCE_NAME`_SOCKET_TX_SIZE(socket)) ?
+			`$INSTANCE_NAME`_SOCKET_TX_SIZE(socket) : `$INSTANCE_NAME`_COALESCE_SIZE;
+		`$INSTANCE_NAME`_Staged[socket] += state.Unsent;
+		if (`$INSTANCE_NAME`_Staged[socket] >= threshold) {
+			`$INSTANCE_NAME`_SocketSend( socket );
+		}
+#else
+		`$INSTANCE_NAME`_SocketSend( socket );
+#endif
+	}
+	return state.Count;
 }
 #endif
 /* ======================================================================== */
@@ -1638,21 +4531,53 @@ uint8
 /* ------------------------------------------------------------------------ */	
 uint16
 `$INSTANCE_NAME`_UdpSend(uint8 socket, uint32 ip, uint16 port, uint8* buffer, uint16 length)
+{
+	`$INSTANCE_NAME`_IOVEC iov;
+	
+	/* V1.3: send the buffer as a single segment */
+	iov.Buffer = buffer;
+	iov.Length = length;
+	return `$INSTANCE_NAME`_UdpSendv(socket, ip, port, &iov, 1);
+}
+/* ------------------------------------------------------------------------ */
+uint16
+`$INSTANCE_NAME`_UdpSendv(uint8 socket, uint32 ip, uint16 port, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count)
 {
 	uint16 TxSize;
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+	uint16 FreeSpace;
+	uint8 status;
+#endif
 	
 	/*
 	 * Transmit a buffer of data to a specified remote system using UDP.
+	 * V1.3: UDP sockets report the SOCK_UDP status, not ESTABLISHED
 	 */
-	if (`$INSTANCE_NAME`_GetSocketStatus(socket) == 0x17) {
+	TxSize = 0;
+	if (`$INSTANCE_NAME`_GetSocketStatus(socket) == `$INSTANCE_NAME`_SOCK_UDP) {
 		/*
 		 * The socket has been established, so wait for available
 		 * room in the transmit buffer of the socket, but, trim the
 		 * transmitted data length to no more than the available
 		 * buffer size in the device. (2K)
 		 */
-		TxSize = (length > 0x0800) ? 0x0800 : length;
+		TxSize = `$INSTANCE_NAME`_IovLength(socket, iov, count);
 		if ( (ip != 0) && (ip != 0xFFFFFFFF) ) {
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+			/*
+			 * V1.3: The previous packet may still be in the transmit buffer,
+			 * so wait for room for this one before it is copied in.  The
+			 * destination of the SEND in progress may not be changed, so
+			 * the registers are written once that SEND has completed.
+			 */
+			FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+			status = `$INSTANCE_NAME`_SOCK_UDP;
+			while ( (FreeSpace < TxSize) && (status == `$INSTANCE_NAME`_SOCK_UDP) ) {
+				FreeSpace = `$INSTANCE_NAME`_GetTxFreeSize( socket );
+				status = `$INSTANCE_NAME`_GetSocketStatus( socket );
+			}
+			`$INSTANCE_NAME`_SendWait(socket);
+#endif
 			/*
 			 * Store the destination IP and port in the chip
 			 * socket registers.
@@ -1663,7 +4588,7 @@ uint16
 			 * process the transmission buffer, and write it in to
 			 * the chip buffer memory.
 			 */
-			`$INSTANCE_NAME`_ProcessTxData(socket,0,buffer,TxSize);
+			`$INSTANCE_NAME`_ProcessTxVector(socket, iov, count, TxSize);
 			/*
 			 * Issue the send command to transmit the buffer.
 			 */
@@ -1689,21 +4614,22 @@ uint16
 	 * and that there is data waiting
 	 */
 	RxSize = 0;
-	if (`$INSTANCE_NAME`_GetSocketStatus( socket ) == 0x17) {
+	if (`$INSTANCE_NAME`_GetSocketStatus( socket ) == `$INSTANCE_NAME`_SOCK_UDP) {
 		/*
 		 * read the number of waiting bytes in the buffer memory
 		 * but, clip the length of data read to the requested
 		 * length of data.
 		 */
 		RxSize = `$INSTANCE_NAME`_GetRxSize( socket );
-		RxSize = (RxSize > length+8) ? length : RxSize;
 		/* If there was waiting data, read it from the buffer */
-		if (RxSize > 0) {
+		if (RxSize >= 8) {
 			/*
 			 * the UDP packet is stored in the buffer memory as an 8-byte
 			 * packet header followed by the packet data.
+			 * V1.3: The header is read using the lookahead, so that the
+			 * read pointer is only moved once the whole packet is read.
 			*/
-			`$INSTANCE_NAME`_ProcessRxData( socket, 0, &PacketHeader[0], 8, 0);
+			`$INSTANCE_NAME`_ProcessRxData( socket, 0, &PacketHeader[0], 8, 0x01);
 			/*
 			 * The packet header contains the 4-byte IP address followed by the
 			 * 2-byte port number and the 2-byte packet data length
@@ -1715,19 +4641,27 @@ uint16
 			 * Check to make sure that the packet data has been received completely
 			 */
 			if (RxSize >= (PacketSize+8) ) {
-			
-				`$INSTANCE_NAME`_ProcessRxData( socket, 8, buffer, PacketSize, 0);
+				/*
+				 * V1.3: copy no more than the length of the buffer, the rest
+				 * of the packet data is discarded.
+				 */
+				RxSize = (PacketSize > length) ? length : PacketSize;
+				`$INSTANCE_NAME`_ProcessRxData( socket, 8, buffer, RxSize, 0x01);
+				/* move the read pointer past the whole packet */
+				`$INSTANCE_NAME`_SetSocketRxReadPtr( socket, `$INSTANCE_NAME`_GetSocketRxReadPtr(socket) + 8 + PacketSize );
 				/* 
 				 * after reading the buffer data, send the receive command
 				 * to the socket so that the W5100 completes the read
 				 */
-				`$INSTANCE_NAME`_ExecuteSocketCommand(socket, 0x40);
-				RxSize = PacketSize;
+				`$INSTANCE_NAME`_SocketRecv(socket, PacketSize + 8);
 			}
 			else {
-				RxSize = 8;
+				RxSize = 0;
 			}
 		}
+		else {
+			RxSize = 0;
+		}
 	}
 	
 	/* return the number of read bytes from the buffer memory */
@@ -128,27 +128,77 @@
  * \subsection api_func_subsec API Functions
  * \li W5100_Start() : Startup and initialize the device using the creator defaults
  * \li W5100_Init() : initialize device parameters and memory setup
+ * \li W5100_SetSocketMemory() : Re-assign the socket transmit and receive buffer sizes
+ * \li W5100_SetRetryTime() : Set the TCP retransmission timeout
+ * \li W5100_GetRetryTime() : Read the TCP retransmission timeout
+ * \li W5100_SetRetryCount() : Set the number of retransmissions before a timeout
+ * \li W5100_GetRetryCount() : Read the number of retransmissions before a timeout
+ * \li W5100_GetRoundTrip() : Retrieve the measured round trip time of a socket
+ * \li W5100_GetMemoryProfile() : Retrieve the measured buffer occupancy of a socket
+ * \li W5100_ClearMemoryProfile() : Reset the measured buffer occupancy of all sockets
+ * \li W5100_RebalanceMemory() : Re-assign the socket buffer memory from the measured occupancy
  * \li W5100_ParseIP() : Parse a ASCII Text IPv4 address to an IPv4 Address.
  * \li W5100_SetIP() : re-assign the local IP address of the device
  * \li W5100_GetIP() : Read the current IP address of the device
  * \li W5100_SetMAC() : Re-assign the hardware address (MAC) of the device
  * \li W5100_GetMAC() : Retrieve the assigned Source hardware (MAC) address of the device
  * \li W5100_SocketOpen() : Open a socket using the specified protocol on the specified port
+ * \li W5100_SocketOpenOptions() : Open a socket with MSS, TOS and TTL options
+ * \li W5100_SocketSetMSS() : Set the maximum segment size of a socket
+ * \li W5100_SocketSetTOS() : Set the IP type of service (DSCP) of a socket
+ * \li W5100_SocketSetTTL() : Set the IP time to live of a socket
+ * \li W5100_SocketGetOptions() : Read the MSS, TOS and TTL of a socket
  * \li W5100_SocketClose() : Close a previously opened socket
  * \li W5100_SocketProcessConnections() : Process the socket connection to check for errors and remote closure
  * \li W5100_SocketEstablished() : Check the connection establishment status of the socket
  * \li W5100_SocketRxDataWaiting() : Retrieve the length of waiting Receive data
+ * \li W5100_RxBegin() : Start a receive transaction to parse data in place in the receive buffer
+ * \li W5100_RxPeek() : Read receive data at the cursor without consuming it
+ * \li W5100_RxFind() : Search the receive data for a delimiter
+ * \li W5100_RxRead() : Read and consume receive data at the cursor
+ * \li W5100_RxSkip() : Consume receive data without reading it
+ * \li W5100_RxCommit() : Release the consumed receive data to the device
+ * \li W5100_SocketSendDone() : Check for completion of an asynchronous SEND
+ * \li W5100_SocketRecvFlush() : Issue a deferred RECV command for a socket
+ * \li W5100_SocketCommandStart() : Issue a socket command without waiting for completion
+ * \li W5100_SocketCommandDone() : Check for completion of a socket command
+ * \li W5100_SpiSubmit() : Queue an asynchronous SPI block transfer job
+ * \li W5100_SpiBusy() : Check for active asynchronous SPI jobs
+ * \li W5100_DmaStart() : Register the DMA channels used for block transfers (PSoC 5LP)
+ * \li W5100_DmaStop() : Stop using the DMA for block transfers
+ * \li W5100_SetSocketHandlers() : Register the event handlers of a socket
+ * \li W5100_Poll() : Service the events of all sockets and call the registered handlers
+ * \li W5100_IntStart() : Attach the driver to the W5100 /INT output
+ * \li W5100_GetSocketEvents() : Retrieve and clear the interrupt events of a socket
+ * \li W5100_SetIdleTimeout() : Set the keep-alive interval and idle timeout of the connection manager
+ * \li W5100_ManageConnections() : Probe idle connections and reclaim idle and dead sockets
+ * \li W5100_GetConnectionStats() : Retrieve the keep-alive and reclaim counters
+ * \li W5100_GetBusStats() : Retrieve the SPI frame and socket command counters
+ * \li W5100_ClearBusStats() : Reset the SPI frame and socket command counters
  * \li W5100_TcpOpen() : Open an port using the TCP protocol
  * \li W5100_TcpStartServer() : Start a server listening for connection on an open socket
  * \li W5100_TcpStartServerWait() : Start a TCP server listening for connections on the specified socket
+ * \li W5100_TcpListen() : Place several sockets listening for connections on a port
+ * \li W5100_TcpAccept() : Retrieve the next connection established on a listening socket
+ * \li W5100_TcpListenStop() : Stop the sockets listening for connections
  * \li W5100_TcpConnect() : Open a client connection to a specified IP and port
+ * \li W5100_TcpConnectStart() : Start a client connection without waiting for it
+ * \li W5100_TcpConnectStatus() : Check the progress of a client connection
  * \li W5100_TcpConnected() : Return the connection status of the TCP socket
  * \li W5100_TcpDisconnect() : Terminate a connection with a remote client/server
  * \li W5100_TcpSend() : Transmit a byte packet using the built-in TCP
+ * \li W5100_TcpSendv() : Transmit a list of data segments with a single TCP send
+ * \li W5100_TcpWrite() : Send as much data as fits in the free transmit memory without waiting
+ * \li W5100_TcpSendStream() : Send a buffer of any length, as the transmit memory becomes free
  * \li W5100_TcpReceive() : Receive a packet of data using the built-in TCP handler
  * \li W5100_TcpPrint() : Send a zero-terminated ASCII string using TCP
+ * \li W5100_TcpPrintf() : Send formatted text using TCP, formatted directly in to the transmit buffer
+ * \li W5100_TcpQueue() : Stage data in the transmit buffer, to be sent with the following data
+ * \li W5100_TcpFlush() : Send the data staged on a socket
+ * \li W5100_TcpFlushTimer() : Send staged data which has waited for the coalescing time
  * \li W5100_UdpOpen() : Open a Socket Port using the UDP protocol
  * \li W5100_UdpSend() : Transmit a byte packet using the built-in UDP
+ * \li W5100_UdpSendv() : Transmit a list of data segments as one UDP packet
  * \li W5100_UdpReceive() : Receive a packet of data using the built-in p handler
  */
 /**
@@ -181,6 +231,453 @@
 #define `$INSTANCE_NAME`_PROTO_IP         ( 3 )
 #define `$INSTANCE_NAME`_PROTO_MAC        ( 4 )
 
+/* V1.3: Socket commands (Sn_CR), per the W5100 datasheet p.28 */
+#define `$INSTANCE_NAME`_CMD_OPEN         ( 0x01 )
+#define `$INSTANCE_NAME`_CMD_LISTEN       ( 0x02 )
+#define `$INSTANCE_NAME`_CMD_CONNECT      ( 0x04 )
+#define `$INSTANCE_NAME`_CMD_DISCON       ( 0x08 )
+#define `$INSTANCE_NAME`_CMD_CLOSE        ( 0x10 )
+#define `$INSTANCE_NAME`_CMD_SEND         ( 0x20 )
+#define `$INSTANCE_NAME`_CMD_SEND_MAC     ( 0x21 )
+#define `$INSTANCE_NAME`_CMD_SEND_KEEP    ( 0x22 )
+#define `$INSTANCE_NAME`_CMD_RECV         ( 0x40 )
+
+/* V1.3: Socket interrupt flags (Sn_IR) */
+#define `$INSTANCE_NAME`_IR_CON           ( 0x01 )
+#define `$INSTANCE_NAME`_IR_DISCON        ( 0x02 )
+#define `$INSTANCE_NAME`_IR_RECV          ( 0x04 )
+#define `$INSTANCE_NAME`_IR_TIMEOUT       ( 0x08 )
+#define `$INSTANCE_NAME`_IR_SEND_OK       ( 0x10 )
+
+/* V1.3: Socket status values (Sn_SR) */
+#define `$INSTANCE_NAME`_SOCK_CLOSED      ( 0x00 )
+#define `$INSTANCE_NAME`_SOCK_INIT        ( 0x13 )
+#define `$INSTANCE_NAME`_SOCK_LISTEN      ( 0x14 )
+#define `$INSTANCE_NAME`_SOCK_SYNSENT     ( 0x15 )
+#define `$INSTANCE_NAME`_SOCK_SYNRECV     ( 0x16 )
+#define `$INSTANCE_NAME`_SOCK_ESTABLISHED ( 0x17 )
+#define `$INSTANCE_NAME`_SOCK_FIN_WAIT    ( 0x18 )
+#define `$INSTANCE_NAME`_SOCK_CLOSING     ( 0x1A )
+#define `$INSTANCE_NAME`_SOCK_TIME_WAIT   ( 0x1B )
+#define `$INSTANCE_NAME`_SOCK_CLOSE_WAIT  ( 0x1C )
+#define `$INSTANCE_NAME`_SOCK_LAST_ACK    ( 0x1D )
+#define `$INSTANCE_NAME`_SOCK_UDP         ( 0x22 )
+#define `$INSTANCE_NAME`_SOCK_IPRAW       ( 0x32 )
+#define `$INSTANCE_NAME`_SOCK_MACRAW      ( 0x42 )
+
+/* ------------------------------------------------------------------------ */
+/*
+ * V1.3: Driver build options.  These options are not part of the customizer
+ * parameters, and may be overridden by adding the definition to the compiler
+ * preprocessor definitions of the project build settings.
+ */
+/**
+ * \def `$INSTANCE_NAME`_DMA_ENABLE
+ * \brief Set to 1 to move block transfers through the DMA controller
+ *
+ * When enabled on a PSoC 5LP using the SPIM, the block read and write
+ * operations of the driver will build the W5100 SPI frames in a table and
+ * transfer them to/from the SPIM FIFOs using two DMA channels, one frame per
+ * Tx burst.  The channels must be registered using `$INSTANCE_NAME`_DmaStart()
+ * before they are used.
+ */
+#if !defined(`$INSTANCE_NAME`_DMA_ENABLE)
+#define `$INSTANCE_NAME`_DMA_ENABLE       ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_DMA_CHUNK
+ * \brief The number of W5100 frames transferred by one DMA transaction
+ */
+#if !defined(`$INSTANCE_NAME`_DMA_CHUNK)
+#define `$INSTANCE_NAME`_DMA_CHUNK        ( 32 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_SPI_PIPELINE
+ * \brief Set to 1 to stream block transfer frames from a tight loop
+ *
+ * When enabled, the block read and write operations load each frame in to
+ * the SPI Tx FIFO directly, and while the frame shifts, build the next frame
+ * and drain the received bytes, so the next frame is loaded as soon as the
+ * SPI releases the chip select.  This replaces the byte-wise read and write
+ * functions with their delay polling for each frame, and works with both the
+ * SPIM and the SCB.
+ * \note The W5100 has no burst mode, so streamed, DMA and job frames are
+ * never queued back to back: the chip select is raised after every frame.
+ */
+#if !defined(`$INSTANCE_NAME`_SPI_PIPELINE)
+#define `$INSTANCE_NAME`_SPI_PIPELINE     ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_SPI_ASYNC
+ * \brief Set to 1 to include the interrupt driven asynchronous SPI job queue
+ *
+ * When enabled, `$INSTANCE_NAME`_Start() attaches the driver interrupt handler
+ * to the SPI interrupt, and block transfers may be submitted as jobs which
+ * complete in the background, one frame for each end of frame interrupt.
+ * The SPIM must have the internal Tx interrupt enabled with 4-byte buffers,
+ * or the SCB must have the internal interrupt enabled.
+ */
+#if !defined(`$INSTANCE_NAME`_SPI_ASYNC)
+#define `$INSTANCE_NAME`_SPI_ASYNC        ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_REG_CACHE
+ * \brief Set to 1 to keep a shadow copy of the device registers in RAM
+ *
+ * When enabled, the driver keeps a copy of the common registers and the
+ * socket registers.  Reads of registers which are only changed by the driver
+ * (modes, addresses, ports, buffer pointers) are served from RAM, and writes
+ * which would not change a register are skipped.  Registers changed by the
+ * device (status, interrupts, free/received sizes) are always read from the
+ * device.  This uses about 270 bytes of RAM.
+ */
+#if !defined(`$INSTANCE_NAME`_REG_CACHE)
+#define `$INSTANCE_NAME`_REG_CACHE        ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_INT_ENABLE
+ * \brief Set to 1 to use the W5100 /INT output for socket events
+ *
+ * When enabled, the driver waits for the device interrupt rather than
+ * polling the socket registers every millisecond while waiting for SEND
+ * completion and connections.  Connect the /INT output of the W5100 through
+ * an inverter to an isr component configured for a rising edge, and pass the
+ * interrupt number to `$INSTANCE_NAME`_IntStart() after the driver is started.
+ */
+#if !defined(`$INSTANCE_NAME`_INT_ENABLE)
+#define `$INSTANCE_NAME`_INT_ENABLE       ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_ASYNC_SEND
+ * \brief Set to 1 to return from the send functions without waiting for SEND_OK
+ *
+ * When enabled, the send functions copy the data to the socket transmit
+ * buffer and issue the SEND command, then return without waiting for the
+ * data to be transmitted.  The next send copies its data in to the free
+ * transmit memory while the previous SEND is in progress, and only waits for
+ * the previous SEND to complete before moving the write pointer and issuing
+ * its own SEND command.
+ * \sa `$INSTANCE_NAME`_SocketSendDone()
+ */
+#if !defined(`$INSTANCE_NAME`_ASYNC_SEND)
+#define `$INSTANCE_NAME`_ASYNC_SEND       ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RECV_THRESHOLD
+ * \brief Number of bytes read from a socket before the RECV command is issued
+ *
+ * When 0, the RECV command is issued by every receive that reads data.  When
+ * set, the RECV command (which releases the read memory to the device and
+ * updates the receive window) is only issued once this number of bytes has
+ * been read, or when `$INSTANCE_NAME`_SocketRecvFlush() is called.  This saves
+ * a command for each small read.  A threshold larger than the receive buffer
+ * of a socket is reduced to the buffer size; a quarter of the buffer is a
+ * good starting point.
+ */
+#if !defined(`$INSTANCE_NAME`_RECV_THRESHOLD)
+#define `$INSTANCE_NAME`_RECV_THRESHOLD   ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_TX_MEMORY
+ * \brief Transmit buffer memory assignment (TMSR value) written by `$INSTANCE_NAME`_Init()
+ *
+ * The device has 8K of transmit memory and 8K of receive memory, which is
+ * shared by the four sockets.  Each socket is assigned 1K, 2K, 4K or 8K using
+ * two bits of the value (socket 0 in bits 0-1), which may be built using
+ * `$INSTANCE_NAME`_MEMORY().  The default assigns 2K to each socket.  Giving
+ * the busy socket a larger buffer allows larger sends and a larger receive
+ * window.  Memory is assigned to the sockets in order; a socket which does
+ * not fit within the 8K is assigned no memory, and can not be opened.
+ */
+#if !defined(`$INSTANCE_NAME`_TX_MEMORY)
+#define `$INSTANCE_NAME`_TX_MEMORY        ( 0x55 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RX_MEMORY
+ * \brief Receive buffer memory assignment (RMSR value) written by `$INSTANCE_NAME`_Init()
+ * \sa `$INSTANCE_NAME`_TX_MEMORY
+ */
+#if !defined(`$INSTANCE_NAME`_RX_MEMORY)
+#define `$INSTANCE_NAME`_RX_MEMORY        ( 0x55 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_MEM_PROFILE
+ * \brief Set to 1 to measure the buffer occupancy of each socket
+ *
+ * When enabled, the driver records the largest amount of receive data
+ * waiting and the largest transmit memory needed by a send for each socket,
+ * and `$INSTANCE_NAME`_RebalanceMemory() may be used (while the sockets are
+ * closed) to re-assign the buffer memory to match the measured traffic.
+ */
+#if !defined(`$INSTANCE_NAME`_MEM_PROFILE)
+#define `$INSTANCE_NAME`_MEM_PROFILE      ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_COALESCE
+ * \brief Set to 1 to coalesce small TCP writes in to larger segments
+ *
+ * When enabled, `$INSTANCE_NAME`_TcpPrint() and `$INSTANCE_NAME`_TcpQueue()
+ * write the data in to the socket transmit buffer without issuing a SEND.
+ * The staged data is sent once _COALESCE_SIZE bytes are waiting, by
+ * `$INSTANCE_NAME`_TcpFlush(), by `$INSTANCE_NAME`_TcpFlushTimer() once it
+ * has waited _COALESCE_TIME, or with the data of the next send.  A shell
+ * printing a line per field then sends a few full segments, rather than a
+ * segment (and a SEND command) for every print.
+ */
+#if !defined(`$INSTANCE_NAME`_COALESCE)
+#define `$INSTANCE_NAME`_COALESCE         ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_COALESCE_SIZE
+ * \brief Number of staged bytes which causes a SEND (limited to the socket transmit buffer)
+ */
+#if !defined(`$INSTANCE_NAME`_COALESCE_SIZE)
+#define `$INSTANCE_NAME`_COALESCE_SIZE    ( 1460 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_COALESCE_TIME
+ * \brief Time (ms) staged data may wait before `$INSTANCE_NAME`_TcpFlushTimer() sends it
+ */
+#if !defined(`$INSTANCE_NAME`_COALESCE_TIME)
+#define `$INSTANCE_NAME`_COALESCE_TIME    ( 20 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_POLL_ENABLE
+ * \brief Set to 1 to include the socket event reactor, `$INSTANCE_NAME`_Poll()
+ */
+#if !defined(`$INSTANCE_NAME`_POLL_ENABLE)
+#define `$INSTANCE_NAME`_POLL_ENABLE      ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RETRY_TIME
+ * \brief Retransmission timeout (100us units) set by `$INSTANCE_NAME`_Init()
+ *
+ * When 0, the device default of 200ms (2000) is used.  A LAN needs a much
+ * shorter time to recover quickly from a lost packet, while a slow WAN link
+ * needs a longer one to avoid needless retransmissions.
+ */
+#if !defined(`$INSTANCE_NAME`_RETRY_TIME)
+#define `$INSTANCE_NAME`_RETRY_TIME       ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RETRY_COUNT
+ * \brief Number of retransmissions before a timeout, set by `$INSTANCE_NAME`_Init()
+ *
+ * When 0, the device default of 8 is used.
+ */
+#if !defined(`$INSTANCE_NAME`_RETRY_COUNT)
+#define `$INSTANCE_NAME`_RETRY_COUNT      ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_ADAPTIVE_RTO
+ * \brief Set to 1 to set the retransmission timeout from the measured round trip time
+ *
+ * The time from each SEND to SEND_OK is measured (polling in 100us steps),
+ * and the retry time register is set from the smoothed round trip time and
+ * its variation, limited to _RTO_MIN and _RTO_MAX.  The measurement
+ * requires the synchronous SEND, so this can not be used with
+ * `$INSTANCE_NAME`_ASYNC_SEND.
+ */
+#if !defined(`$INSTANCE_NAME`_ADAPTIVE_RTO)
+#define `$INSTANCE_NAME`_ADAPTIVE_RTO     ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RTO_MIN
+ * \brief Smallest retransmission timeout (100us units) set by the adaptive timeout
+ */
+#if !defined(`$INSTANCE_NAME`_RTO_MIN)
+#define `$INSTANCE_NAME`_RTO_MIN          ( 20 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_RTO_MAX
+ * \brief Largest retransmission timeout (100us units) set by the adaptive timeout
+ */
+#if !defined(`$INSTANCE_NAME`_RTO_MAX)
+#define `$INSTANCE_NAME`_RTO_MAX          ( 10000 )
+#endif
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO) && (`$INSTANCE_NAME`_ASYNC_SEND)
+#error "`$INSTANCE_NAME`_ADAPTIVE_RTO requires the synchronous SEND (`$INSTANCE_NAME`_ASYNC_SEND = 0)"
+#endif
+/**
+ * \def `$INSTANCE_NAME`_IDLE_MANAGER
+ * \brief Set to 1 to include the connection manager, `$INSTANCE_NAME`_ManageConnections()
+ */
+#if !defined(`$INSTANCE_NAME`_IDLE_MANAGER)
+#define `$INSTANCE_NAME`_IDLE_MANAGER     ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_KEEPALIVE_TIME
+ * \brief Default time (ms) without data before an idle connection is probed, 0 to disable
+ */
+#if !defined(`$INSTANCE_NAME`_KEEPALIVE_TIME)
+#define `$INSTANCE_NAME`_KEEPALIVE_TIME   ( 10000 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_IDLE_TIMEOUT
+ * \brief Default time (ms) without data before a connection is closed, 0 to disable
+ */
+#if !defined(`$INSTANCE_NAME`_IDLE_TIMEOUT)
+#define `$INSTANCE_NAME`_IDLE_TIMEOUT     ( 60000 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_STATS_ENABLE
+ * \brief Set to 1 to count the SPI frames and socket commands issued by the driver
+ *
+ * When enabled, every W5100 SPI frame (one register or memory byte) and every
+ * socket command is counted, so that the bus cost of each API call can be
+ * measured using `$INSTANCE_NAME`_GetBusStats().
+ */
+#if !defined(`$INSTANCE_NAME`_STATS_ENABLE)
+#define `$INSTANCE_NAME`_STATS_ENABLE     ( 0 )
+#endif
+/**
+ * \def `$INSTANCE_NAME`_SPI_CLOCK_KHZ
+ * \brief SPI bit clock (kHz) used to model the bus time of the counted frames
+ */
+#if !defined(`$INSTANCE_NAME`_SPI_CLOCK_KHZ)
+#define `$INSTANCE_NAME`_SPI_CLOCK_KHZ    ( 4000 )
+#endif
+
+/* Client connection results, see `$INSTANCE_NAME`_TcpConnectStatus() */
+#define `$INSTANCE_NAME`_CONNECT_IDLE         ( 0 )
+#define `$INSTANCE_NAME`_CONNECT_IN_PROGRESS  ( 1 )
+#define `$INSTANCE_NAME`_CONNECT_ESTABLISHED  ( 2 )
+#define `$INSTANCE_NAME`_CONNECT_TIMEOUT      ( 3 )
+#define `$INSTANCE_NAME`_CONNECT_REFUSED      ( 4 )
+
+/* Socket buffer sizes, for building the TX/RX memory assignment */
+#define `$INSTANCE_NAME`_MEM_1K           ( 0 )
+#define `$INSTANCE_NAME`_MEM_2K           ( 1 )
+#define `$INSTANCE_NAME`_MEM_4K           ( 2 )
+#define `$INSTANCE_NAME`_MEM_8K           ( 3 )
+#define `$INSTANCE_NAME`_MEMORY(s0,s1,s2,s3)  ( (s0) | ((s1)<<2) | ((s2)<<4) | ((s3)<<6) )
+
+#if (`$INSTANCE_NAME`_SPI_ASYNC)
+#define `$INSTANCE_NAME`_JOB_DONE         ( 0 )
+#define `$INSTANCE_NAME`_JOB_PENDING      ( 1 )
+#define `$INSTANCE_NAME`_JOB_ACTIVE       ( 2 )
+
+/**
+ * \brief Asynchronous SPI job descriptor
+ *
+ * A job reads or writes a block of consecutive W5100 addresses.  The job
+ * memory is owned by the application, and must remain valid until the
+ * job Status returns to `$INSTANCE_NAME`_JOB_DONE.
+ */
+typedef struct `$INSTANCE_NAME`_SPI_JOB_STRUCT
+{
+	uint16 Address;   /**< W5100 starting address of the transfer */
+	uint8* Buffer;    /**< data to write, or buffer to hold the read data */
+	uint16 Length;    /**< number of bytes to transfer */
+	uint8  Op;        /**< `$INSTANCE_NAME`_READ_OP or `$INSTANCE_NAME`_WRITE_OP */
+	volatile uint8 Status; /**< job status (DONE/PENDING/ACTIVE) */
+	/** called from the SPI interrupt when the job completes (may be NULL) */
+	void (*Callback)( struct `$INSTANCE_NAME`_SPI_JOB_STRUCT* job );
+	struct `$INSTANCE_NAME`_SPI_JOB_STRUCT* Next; /**< queue link (used by the driver) */
+} `$INSTANCE_NAME`_SPI_JOB;
+#endif
+
+/**
+ * \brief Data segment for the vectored send functions
+ * \sa `$INSTANCE_NAME`_TcpSendv()
+ */
+typedef struct
+{
+	const uint8* Buffer; /**< segment data */
+	uint16 Length;       /**< segment length */
+} `$INSTANCE_NAME`_IOVEC;
+
+/**
+ * \brief Socket options applied by `$INSTANCE_NAME`_SocketOpenOptions()
+ *
+ * A field of 0 leaves the device default.  Options set on a socket are
+ * restored to the device defaults when the socket is closed.
+ */
+typedef struct
+{
+	uint16 MaxSegSize;    /**< maximum segment size (Sn_MSSR) */
+	uint8 TypeOfService;  /**< IP type of service, DSCP in the upper 6 bits (Sn_TOS) */
+	uint8 TimeToLive;     /**< IP time to live (Sn_TTL) */
+} `$INSTANCE_NAME`_SOCKET_OPTIONS;
+
+/**
+ * \brief Receive cursor, used to parse data in place in the socket receive buffer
+ * \sa `$INSTANCE_NAME`_RxBegin()
+ */
+typedef struct
+{
+	uint8  Socket;  /**< socket being read */
+	uint16 Base;    /**< receive pointer (Sn_RX_RD) at the start of the transaction */
+	uint16 Offset;  /**< number of bytes consumed since the start of the transaction */
+	uint16 Length;  /**< number of bytes waiting when the transaction was started */
+} `$INSTANCE_NAME`_RX_CURSOR;
+
+#if (`$INSTANCE_NAME`_POLL_ENABLE)
+/**
+ * \brief Socket event handler
+ * \param socket the socket on which the event occurred
+ * \param length the receive data length (Data), the transmit free size
+ *  (Writable), or 0 for the other events
+ *
+ * Writable is called when a SEND has completed and freed transmit space.
+ * With the asynchronous send this is on the poll which sees the SEND_OK
+ * event; otherwise the send functions wait for the SEND themselves, and
+ * Writable is called on the first poll after the send function returned.
+ */
+typedef void (*`$INSTANCE_NAME`_EVENT_HANDLER)( uint8 socket, uint16 length );
+
+/**
+ * \brief Set of event handlers for a socket, any of which may be NULL
+ */
+typedef struct
+{
+	`$INSTANCE_NAME`_EVENT_HANDLER Accept;   /**< a connection was established */
+	`$INSTANCE_NAME`_EVENT_HANDLER Data;     /**< receive data is waiting */
+	`$INSTANCE_NAME`_EVENT_HANDLER Writable; /**< a SEND completed, freeing transmit space */
+	`$INSTANCE_NAME`_EVENT_HANDLER Closed;   /**< the remote host disconnected, or the connection closed */
+	`$INSTANCE_NAME`_EVENT_HANDLER Timeout;  /**< a connection or send timed out */
+} `$INSTANCE_NAME`_SOCKET_HANDLERS;
+#endif
+
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+/**
+ * \brief Measured buffer occupancy of a socket
+ */
+typedef struct
+{
+	uint16 RxHighWater;   /**< largest number of bytes waiting in the receive buffer */
+	uint16 TxHighWater;   /**< largest transmit memory in use plus the length of a send */
+	uint16 TxStalls;      /**< number of sends which found too little free transmit memory */
+} `$INSTANCE_NAME`_MEMORY_PROFILE;
+#endif
+
+#if (`$INSTANCE_NAME`_IDLE_MANAGER)
+/**
+ * \brief Connection manager counters
+ */
+typedef struct
+{
+	uint16 KeepAlives;    /**< number of keep-alive probes sent */
+	uint16 IdleReclaims;  /**< number of connections closed for exceeding the idle timeout */
+	uint16 DeadReclaims;  /**< number of sockets closed after the connection was lost */
+} `$INSTANCE_NAME`_CONNECTION_STATS;
+#endif
+
+#if (`$INSTANCE_NAME`_STATS_ENABLE)
+/**
+ * \brief SPI bus usage counters
+ */
+typedef struct
+{
+	uint32 ReadFrames;    /**< number of 4-byte read frames */
+	uint32 WriteFrames;   /**< number of 4-byte write frames */
+	uint32 Commands;      /**< number of socket commands executed */
+	uint32 CommandPolls;  /**< number of command register polls while waiting for completion */
+	uint32 Bytes;         /**< bytes shifted on the wire (4 per frame) */
+	uint32 BusTime;       /**< modeled bus time (us) at `$INSTANCE_NAME`_SPI_CLOCK_KHZ */
+} `$INSTANCE_NAME`_BUS_STATS;
+#endif
+
 /* ------------------------------------------------------------------------ */
 /**
  * \brief Startup and initialize the device using the creator defaults
@@ -215,6 +712,91 @@ void `$INSTANCE_NAME`_Start( void );
  */
 void `$INSTANCE_NAME`_Init(uint8* mac, uint32 ip, uint32 subnet, uint32 gateway);
 
+/**
+ * \brief Re-assign the socket transmit and receive buffer memory
+ * \param tmsr the transmit memory assignment (see `$INSTANCE_NAME`_TX_MEMORY)
+ * \param rmsr the receive memory assignment (see `$INSTANCE_NAME`_RX_MEMORY)
+ * \returns CYRET_SUCCESS when the memory was assigned
+ * \returns CYRET_INVALID_STATE when a socket is open
+ *
+ * For example, to give socket 0 4K, socket 1 2K and sockets 2-3 1K each:
+ * `$INSTANCE_NAME`_SetSocketMemory( `$INSTANCE_NAME`_MEMORY(`$INSTANCE_NAME`_MEM_4K,
+ *  `$INSTANCE_NAME`_MEM_2K, `$INSTANCE_NAME`_MEM_1K, `$INSTANCE_NAME`_MEM_1K), ... );
+ * As with `$INSTANCE_NAME`_TX_MEMORY, the sockets which do not fit in the 8K
+ * are assigned no memory, so MEM_8K for socket 0 leaves sockets 1-3 unusable.
+ * \note All sockets must be closed.
+ */
+cystatus `$INSTANCE_NAME`_SetSocketMemory( uint8 tmsr, uint8 rmsr );
+
+/**
+ * \brief Set the TCP retransmission timeout
+ * \param time the timeout in 100us units (the device default is 2000, 200ms)
+ *
+ * The timeout applies to all sockets.  Each retransmission doubles the
+ * timeout of the previous one.
+ * \note With `$INSTANCE_NAME`_ADAPTIVE_RTO, the driver replaces this value as
+ * round trip times are measured.
+ */
+void `$INSTANCE_NAME`_SetRetryTime( uint16 time );
+
+/**
+ * \brief Read the TCP retransmission timeout
+ * \returns the timeout in 100us units
+ */
+uint16 `$INSTANCE_NAME`_GetRetryTime( void );
+
+/**
+ * \brief Set the number of retransmissions before a socket times out
+ * \param count the number of retransmissions (the device default is 8)
+ */
+void `$INSTANCE_NAME`_SetRetryCount( uint8 count );
+
+/**
+ * \brief Read the number of retransmissions before a socket times out
+ * \returns the number of retransmissions
+ */
+uint8 `$INSTANCE_NAME`_GetRetryCount( void );
+
+#if (`$INSTANCE_NAME`_ADAPTIVE_RTO)
+/**
+ * \brief Retrieve the measured round trip time of a socket
+ * \param socket the socket number
+ * \returns the smoothed time from SEND to SEND_OK (100us units), 0 before
+ *  the first measurement
+ */
+uint16 `$INSTANCE_NAME`_GetRoundTrip( uint8 socket );
+#endif
+
+#if (`$INSTANCE_NAME`_MEM_PROFILE)
+/**
+ * \brief Retrieve the measured buffer occupancy of a socket
+ * \param socket the socket number
+ * \param *profile the structure to hold the measurements
+ * \returns CYRET_SUCCESS, or CYRET_BAD_PARAM for an invalid socket
+ */
+cystatus `$INSTANCE_NAME`_GetMemoryProfile( uint8 socket, `$INSTANCE_NAME`_MEMORY_PROFILE* profile );
+
+/**
+ * \brief Reset the measured buffer occupancy of all sockets
+ */
+void `$INSTANCE_NAME`_ClearMemoryProfile( void );
+
+/**
+ * \brief Re-assign the socket buffer memory from the measured occupancy
+ * \returns the result of `$INSTANCE_NAME`_SetSocketMemory()
+ *
+ * Sockets whose buffer filled are given larger buffers, taken from sockets
+ * which did not use theirs.  Sockets after the last one which carried any
+ * data are only given the memory left over, and may be left without memory
+ * until the next rebalance.  The measurements are halved after each
+ * rebalance, so that repeated calls (such as between sessions in a server
+ * accept loop) converge on the traffic of the application.
+ * \note All sockets must be closed, otherwise CYRET_INVALID_STATE is returned
+ * and the layout is unchanged.
+ */
+cystatus `$INSTANCE_NAME`_RebalanceMemory( void );
+#endif
+
 /**
  * \brief Parse a ASCII Text IPv4 address to an IPv4 Address.
  * \param ipString ASCII z-String containing the IP address to parse
@@ -280,7 +862,8 @@ void `$INSTANCE_NAME`_GetMAC( uint8* mac );
 /**
  * \brief Open a socket using the specified protocol on the specified port
  * \param Protocol the protocol identification for the socket
- * \param flags Socket flags (currently not used)
+ * \param port the local port number of the socket
+ * \param flags Socket mode register flags, combined with the protocol
  * \returns The socket number (0-3) or 0xFF when not available
  *
  * This function will allocate and initiailze a socket from the socket table
@@ -294,6 +877,56 @@ void `$INSTANCE_NAME`_GetMAC( uint8* mac );
  */
 uint8 `$INSTANCE_NAME`_SocketOpen( uint8 Protocol, uint16 port, uint8 flags );
 
+/**
+ * \brief Open a socket, setting the socket options before it is opened
+ * \param Protocol the protocol identification for the socket
+ * \param port the local port number of the socket
+ * \param flags Socket mode register flags, combined with the protocol
+ * \param *options the socket options, or NULL for the device defaults
+ * \returns The socket number (0-3) or 0xFF when not available, or when the
+ *  options are invalid
+ *
+ * For example, control traffic may be marked for low latency handling with
+ * TypeOfService = 0xB8 (DSCP EF), and a smaller MaxSegSize avoids IP
+ * fragmentation on links with a smaller MTU, such as VPN tunnels.
+ * \sa `$INSTANCE_NAME`_SocketOpen()
+ */
+uint8 `$INSTANCE_NAME`_SocketOpenOptions( uint8 Protocol, uint16 port, uint8 flags, const `$INSTANCE_NAME`_SOCKET_OPTIONS* options );
+
+/**
+ * \brief Set the maximum segment size of a socket
+ * \param socket the socket number
+ * \param mss the maximum segment size
+ * \returns CYRET_SUCCESS, or CYRET_BAD_PARAM when the size is zero, larger
+ *  than an ethernet frame allows (1460 for TCP, 1472 for UDP), or larger
+ *  than the socket transmit buffer
+ * \note For TCP, the MSS must be set before the connection is made.
+ */
+cystatus `$INSTANCE_NAME`_SocketSetMSS( uint8 socket, uint16 mss );
+
+/**
+ * \brief Set the IP type of service (DSCP/ECN byte) of a socket
+ * \param socket the socket number
+ * \param tos the type of service byte
+ * \returns CYRET_SUCCESS, or CYRET_BAD_PARAM for an invalid socket
+ */
+cystatus `$INSTANCE_NAME`_SocketSetTOS( uint8 socket, uint8 tos );
+
+/**
+ * \brief Set the IP time to live of a socket
+ * \param socket the socket number
+ * \param ttl the time to live (1-255)
+ * \returns CYRET_SUCCESS, or CYRET_BAD_PARAM for an invalid socket or a TTL of 0
+ */
+cystatus `$INSTANCE_NAME`_SocketSetTTL( uint8 socket, uint8 ttl );
+
+/**
+ * \brief Read the MSS, TOS and TTL of a socket
+ * \param socket the socket number
+ * \param *options the structure to hold the options
+ */
+void `$INSTANCE_NAME`_SocketGetOptions( uint8 socket, `$INSTANCE_NAME`_SOCKET_OPTIONS* options );
+
 /**
  * \brief Close a previously opened socket
  * \param socket the Socket number (0 - 3) to close
@@ -339,6 +972,306 @@ uint8 `$INSTANCE_NAME`_SocketEstablished( uint8 socket );
  */
 uint16 `$INSTANCE_NAME`_SocketRxDataWaiting( uint8 socket );
 
+#if (`$INSTANCE_NAME`_ASYNC_SEND)
+/**
+ * \brief Check for completion of the SEND in progress on a socket
+ * \param socket the socket to check
+ * \retval TRUE no SEND is in progress (the last SEND completed, timed out,
+ *  or the socket was disconnected)
+ * \retval FALSE the SEND is still in progress
+ *
+ * When the SEND has completed and `$INSTANCE_NAME`_TcpWrite() has copied data
+ * behind it, that data is sent, and FALSE is returned for the new SEND.
+ */
+uint8 `$INSTANCE_NAME`_SocketSendDone( uint8 socket );
+#endif
+
+/**
+ * \brief Start a receive transaction on a socket
+ * \param socket the socket from which data will be read
+ * \param *cursor pointer to the cursor used for the transaction
+ * \returns the number of bytes waiting in the receive buffer
+ *
+ * The receive cursor reads data directly from the receive buffer memory of
+ * the device, without first copying it to a local buffer.  Data may be
+ * examined using `$INSTANCE_NAME`_RxPeek() and `$INSTANCE_NAME`_RxFind(),
+ * consumed using `$INSTANCE_NAME`_RxRead() and `$INSTANCE_NAME`_RxSkip(), and
+ * the consumed data is released with `$INSTANCE_NAME`_RxCommit().  Data that
+ * was not committed is read again by the next transaction.
+ * \note The cursor only covers the data waiting when the transaction was
+ * started.  UDP data includes the 8-byte packet header.
+ */
+uint16 `$INSTANCE_NAME`_RxBegin( uint8 socket, `$INSTANCE_NAME`_RX_CURSOR* cursor );
+
+/**
+ * \brief Read data at the cursor without consuming it
+ * \param *cursor pointer to the receive cursor
+ * \param offset the position, relative to the cursor, of the first byte
+ * \param *buffer the buffer to hold the data
+ * \param length the maximum number of bytes to read
+ * \returns the number of bytes read
+ */
+uint16 `$INSTANCE_NAME`_RxPeek( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint16 offset, uint8* buffer, uint16 length );
+
+/**
+ * \brief Search the waiting data for a delimiter
+ * \param *cursor pointer to the receive cursor
+ * \param delimiter the byte value to find
+ * \returns the position of the delimiter relative to the cursor, or 0xFFFF
+ *  when the delimiter was not found
+ */
+uint16 `$INSTANCE_NAME`_RxFind( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint8 delimiter );
+
+/**
+ * \brief Read and consume data at the cursor
+ * \param *cursor pointer to the receive cursor
+ * \param *buffer the buffer to hold the data
+ * \param length the maximum number of bytes to read
+ * \returns the number of bytes read
+ */
+uint16 `$INSTANCE_NAME`_RxRead( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint8* buffer, uint16 length );
+
+/**
+ * \brief Consume data at the cursor without reading it
+ * \param *cursor pointer to the receive cursor
+ * \param length the number of bytes to consume
+ * \returns the number of bytes consumed
+ */
+uint16 `$INSTANCE_NAME`_RxSkip( `$INSTANCE_NAME`_RX_CURSOR* cursor, uint16 length );
+
+/**
+ * \brief Release the consumed data to the device
+ * \param *cursor pointer to the receive cursor
+ *
+ * The receive pointer is updated once, and a single RECV command is issued
+ * for all of the data consumed since the transaction was started (or since
+ * the last commit).  The cursor remains valid for the remaining data.
+ */
+void `$INSTANCE_NAME`_RxCommit( `$INSTANCE_NAME`_RX_CURSOR* cursor );
+
+/**
+ * \brief Issue any deferred RECV command for a socket
+ * \param socket the socket number
+ *
+ * When `$INSTANCE_NAME`_RECV_THRESHOLD is set, this releases the data read
+ * since the last RECV command to the device immediately.
+ */
+void `$INSTANCE_NAME`_SocketRecvFlush( uint8 socket );
+
+/**
+ * \brief Issue a socket command without waiting for completion
+ * \param socket the socket to which the command is issued
+ * \param cmd the command: `$INSTANCE_NAME`_CMD_SEND_KEEP, _CMD_DISCON or
+ *  _CMD_LISTEN
+ * \returns CYRET_STARTED when the command was written to the device
+ * \returns CYRET_BAD_PARAM when the socket number or the command is invalid
+ *
+ * The device accepts the command within a few microseconds, and the
+ * completion may be checked using `$INSTANCE_NAME`_SocketCommandDone().
+ * Completion of the command only means that the device has accepted it;
+ * the result of the operation (such as the DISCON event) is reported in the
+ * socket interrupt flags.
+ * \note Only the commands which leave no state in the driver are accepted.
+ * OPEN, CLOSE, RECV, SEND, SEND_MAC and CONNECT update the socket table, the
+ * buffer pointers or the W5100 subnet mask errata handling, so they return
+ * CYRET_BAD_PARAM, and must be issued using the socket, receive, send and
+ * connect functions.
+ */
+cystatus `$INSTANCE_NAME`_SocketCommandStart( uint8 socket, uint8 cmd );
+
+/**
+ * \brief Check for completion of a socket command
+ * \param socket the socket to check
+ * \retval TRUE the device has accepted the last command
+ * \retval FALSE the command is still being processed
+ */
+uint8 `$INSTANCE_NAME`_SocketCommandDone( uint8 socket );
+
+#if (`$INSTANCE_NAME`_SPI_ASYNC)
+/**
+ * \brief Submit an asynchronous SPI job
+ * \param *job pointer to the job descriptor to be queued
+ * \returns CYRET_STARTED when the job was queued
+ * \returns CYRET_BAD_PARAM when the job descriptor is invalid
+ *
+ * This function will add the job to the SPI job queue and return without
+ * waiting for the transfer.  The transfer is serviced from the SPI interrupt,
+ * and upon completion, the job Status is set to `$INSTANCE_NAME`_JOB_DONE and
+ * the Callback (when specified) is executed from the interrupt.  Synchronous
+ * driver functions wait for all queued jobs to complete before accessing the
+ * SPI, so they must not be called from the job callback: the wait would never
+ * end, since the queue is advanced by the interrupt which runs the callback.
+ * \sa `$INSTANCE_NAME`_SpiBusy()
+ */
+cystatus `$INSTANCE_NAME`_SpiSubmit( `$INSTANCE_NAME`_SPI_JOB* job );
+
+/**
+ * \brief Check for queued or active asynchronous SPI jobs
+ * \retval TRUE there are jobs waiting to complete
+ * \retval FALSE the job queue is idle
+ * \sa `$INSTANCE_NAME`_SpiSubmit()
+ */
+uint8 `$INSTANCE_NAME`_SpiBusy( void );
+#endif
+
+#if (`$INSTANCE_NAME`_DMA_ENABLE)
+/**
+ * \brief Register the DMA channels used for block transfers
+ * \param txChannel DMA channel handle which feeds the SPIM Tx FIFO
+ * \param rxChannel DMA channel handle which drains the SPIM Rx FIFO
+ * \param intNumber the interrupt number of the isr connected to the nrq
+ *  output of the Rx DMA
+ * \returns CYRET_SUCCESS when the DMA engine was started
+ * \returns CYRET_BAD_PARAM when a channel or the interrupt number was invalid,
+ *  or the DMA is not supported
+ * \returns CYRET_MEMORY when the transfer descriptors could not be allocated
+ *
+ * This function will allocate the transfer descriptors needed to move data
+ * between the driver and the SPIM FIFOs, and will enable the block transfer
+ * engine.  The channels are usually created by placing two DMA components
+ * in the schematic, with the DRQ inputs connected to the tx_interrupt and
+ * rx_interrupt terminals of the SPIM, and passing the values returned from
+ * their DmaInitialize() functions.  The Tx DMA must use a rising edge
+ * hardware request and be initialized with a burst count of 4 and one
+ * request per burst, so that each SPIM idle request moves exactly one frame.
+ * The Rx channel should be given a higher priority than the Tx channel so
+ * the Rx FIFO is never overrun.  An isr component connected to the nrq output
+ * of the Rx DMA reports the end of each transfer; the driver installs its
+ * handler on that interrupt, so the processor does not poll the DMA
+ * controller while the transfer runs.
+ *
+ * \note The DMA engine is only available on the PSoC 5LP using the SPIM.
+ * \sa `$INSTANCE_NAME`_DmaStop()
+ */
+cystatus `$INSTANCE_NAME`_DmaStart( uint8 txChannel, uint8 rxChannel, uint8 intNumber );
+
+/**
+ * \brief Stop using the DMA for block transfers
+ *
+ * This function will release the transfer descriptors allocated by
+ * `$INSTANCE_NAME`_DmaStart(), disable its interrupt, and return the driver to using the processor
+ * for the block read and write operations.  The DMA channels are not freed.
+ * \sa `$INSTANCE_NAME`_DmaStart()
+ */
+void `$INSTANCE_NAME`_DmaStop( void );
+#endif
+
+#if (`$INSTANCE_NAME`_POLL_ENABLE)
+/**
+ * \brief Register the event handlers of a socket
+ * \param socket the socket number
+ * \param *handlers pointer to the handler set, or NULL to remove the handlers.
+ *  The handler set is not copied, and must remain valid while registered.
+ * \sa `$INSTANCE_NAME`_Poll()
+ */
+void `$INSTANCE_NAME`_SetSocketHandlers( uint8 socket, const `$INSTANCE_NAME`_SOCKET_HANDLERS* handlers );
+
+/**
+ * \brief Service the events of all sockets
+ * \returns the number of handlers that were called
+ *
+ * This function should be called from the main loop of the application.  The
+ * interrupt state of all four sockets is read using a single register read
+ * (plus one read and write per socket with new events), and the registered
+ * handlers of the events which occurred are called, in the order Accept,
+ * Data, Writable, Timeout, Closed.  The Data handler is called on every poll
+ * until the receive buffer of the socket is empty.  The Closed handler should
+ * close the socket, or start it listening again.
+ *
+ * \note When the interrupt engine is enabled, the socket events are shared
+ * with `$INSTANCE_NAME`_GetSocketEvents(), so an application should use one
+ * or the other.
+ */
+uint8 `$INSTANCE_NAME`_Poll( void );
+#endif
+
+#if (`$INSTANCE_NAME`_INT_ENABLE)
+/**
+ * \brief Attach the driver to the W5100 interrupt output
+ * \param intNumber the interrupt number of the isr connected to /INT
+ * \returns CYRET_SUCCESS when the interrupt was attached
+ * \returns CYRET_BAD_PARAM when the interrupt number is invalid
+ *
+ * This function will install the driver interrupt handler, and enable the
+ * socket interrupts of the device.  The interrupt handler only flags the
+ * event; the device interrupt registers are read by the driver when it next
+ * waits for, or is asked for, socket events.  This must be called after
+ * `$INSTANCE_NAME`_Start().  Until it is called, the driver polls the
+ * interrupt registers, as when the interrupt engine is not enabled.
+ * \sa `$INSTANCE_NAME`_GetSocketEvents()
+ */
+cystatus `$INSTANCE_NAME`_IntStart( uint8 intNumber );
+
+/**
+ * \brief Retrieve and clear the events of a socket
+ * \param socket the socket to check for events
+ * \returns the socket events collected since the last call (a combination of
+ *  `$INSTANCE_NAME`_IR_CON, _IR_DISCON, _IR_RECV, _IR_TIMEOUT and _IR_SEND_OK)
+ *
+ * The SPI is only accessed when the device has signaled an interrupt, or,
+ * before `$INSTANCE_NAME`_IntStart() has been called, on every call.
+ */
+uint8 `$INSTANCE_NAME`_GetSocketEvents( uint8 socket );
+#endif
+
+#if (`$INSTANCE_NAME`_IDLE_MANAGER)
+/**
+ * \brief Set the keep-alive interval and idle timeout of the connection manager
+ * \param keepAlive time (ms) without data before a connection is probed, 0 to disable
+ * \param timeout time (ms) without data before a connection is closed, 0 to disable
+ */
+void `$INSTANCE_NAME`_SetIdleTimeout( uint16 keepAlive, uint16 timeout );
+
+/**
+ * \brief Probe idle connections and reclaim idle and dead sockets
+ * \param elapsed the time (ms) since the previous call
+ * \returns the number of sockets closed by this call
+ *
+ * This function is called periodically by the application (for example
+ * from the main loop, using a millisecond tick).  Data sent or read on a
+ * TCP connection resets its idle time.  When a connection has been idle for
+ * the keep-alive interval, a keep-alive probe (SEND_KEEP) is sent, so that a
+ * remote host which has gone away is detected by the device retry timeout.
+ * A connection idle for the idle timeout, or one that the remote host closed
+ * or that timed out, is closed to free the socket.  Sockets of a
+ * `$INSTANCE_NAME`_TcpListen() listener return to LISTEN.
+ * \note The device only sends keep-alive probes once data has been sent on
+ * the connection.
+ */
+uint8 `$INSTANCE_NAME`_ManageConnections( uint16 elapsed );
+
+/**
+ * \brief Retrieve the keep-alive and reclaim counters
+ * \param *stats pointer to the structure which will receive the counters
+ */
+void `$INSTANCE_NAME`_GetConnectionStats( `$INSTANCE_NAME`_CONNECTION_STATS* stats );
+#endif
+
+#if (`$INSTANCE_NAME`_STATS_ENABLE)
+/**
+ * \brief Retrieve the SPI bus usage counters
+ * \param *stats pointer to the structure which will receive the counters
+ *
+ * This function copies the counters accumulated since the driver was started
+ * (or since the last call to `$INSTANCE_NAME`_ClearBusStats()).  Frames queued
+ * using the asynchronous job queue are counted when the job is submitted.
+ * The Bytes and BusTime fields are calculated from the frame counts, where
+ * the bus time is the shift time of the frames at the configured SPI clock,
+ * and does not include the gaps between frames.
+ * \par
+ * To measure the cost of an API call, clear the counters, execute the call,
+ * then read the counters.
+ * \sa `$INSTANCE_NAME`_ClearBusStats()
+ */
+void `$INSTANCE_NAME`_GetBusStats( `$INSTANCE_NAME`_BUS_STATS* stats );
+
+/**
+ * \brief Reset the SPI bus usage counters to zero
+ * \sa `$INSTANCE_NAME`_GetBusStats()
+ */
+void `$INSTANCE_NAME`_ClearBusStats( void );
+#endif
+
 #if (`$INCLUDE_TCP`)
 	
 /**
@@ -385,18 +1318,56 @@ void `$INSTANCE_NAME`_TcpStartServer( uint8 socket );
  */
 void `$INSTANCE_NAME`_TcpStartServerWait( uint8 socket );
 
+/**
+ * \brief Place several sockets listening for connections on a port
+ * \param port the port on which to listen
+ * \param count the number of sockets to use (at most 4)
+ * \returns the number of sockets placed in LISTEN
+ *
+ * Each free socket (up to count) is opened and placed in LISTEN, so that
+ * clients connecting while another connection is being served are not
+ * refused.  Connections are retrieved using `$INSTANCE_NAME`_TcpAccept().
+ * When an accepted connection is closed using `$INSTANCE_NAME`_SocketClose()
+ * the socket is opened and placed back in LISTEN.
+ * \sa `$INSTANCE_NAME`_TcpAccept()
+ * \sa `$INSTANCE_NAME`_TcpListenStop()
+ */
+uint8 `$INSTANCE_NAME`_TcpListen( uint16 port, uint8 count );
+
+/**
+ * \brief Retrieve the next connection established on a listening socket
+ * \returns the connected socket, or 0xFF when no connection is waiting
+ *
+ * This function does not block.  Listening sockets whose connection failed
+ * before being accepted are placed back in LISTEN.
+ * \sa `$INSTANCE_NAME`_TcpListen()
+ */
+uint8 `$INSTANCE_NAME`_TcpAccept( void );
+
+/**
+ * \brief Stop the sockets listening for connections
+ *
+ * Sockets still waiting for a connection are closed.  Accepted connections
+ * are left open, and are no longer placed back in LISTEN when closed.
+ * \sa `$INSTANCE_NAME`_TcpListen()
+ */
+void `$INSTANCE_NAME`_TcpListenStop( void );
+
 /**
  * \brief Open a client connection to a specified IP and port
  * \param socket the socket used to open the connection
  * \param ip the IPv4 address of the server to which a connection will be made
  * \param port the port number of the server
  *
+ * \returns the result of the connection (`$INSTANCE_NAME`_CONNECT_xxx)
+ *
  * This function will attempt to open a connection between a W5100 device
  * socket, and a remote server using TCP.  This function will wait for the
  * timeout specified in the component paramters within Creator for the
  * connection to be made before terminating the wait.
  *
  * \note This function will block for a specified wait period
+ * \sa `$INSTANCE_NAME`_TcpConnectStart()
  * \sa `$INSTANCE_NAME`_SocketClose()
  * \sa `$INSTANCE_NAME`_TcpOpen()
  * \sa `$INSTANCE_NAME`_TcpStartServer()
@@ -404,7 +1375,39 @@ void `$INSTANCE_NAME`_TcpStartServerWait( uint8 socket );
  * \sa `$INSTANCE_NAME`_TcpConnected()
  * \sa `$INSTANCE_NAME`_TcpDisconnect()
  */
-void `$INSTANCE_NAME`_TcpConnect( uint8 socket, uint32 ip, uint16 port );
+uint8 `$INSTANCE_NAME`_TcpConnect( uint8 socket, uint32 ip, uint16 port );
+
+/**
+ * \brief Start a client connection without waiting for it
+ * \param socket the open TCP socket used for the connection
+ * \param ip the IPv4 address of the server
+ * \param port the port number of the server
+ * \returns CYRET_STARTED when the CONNECT command was issued
+ * \returns CYRET_BAD_PARAM for an invalid socket or address
+ * \returns CYRET_INVALID_STATE when the socket is already connected or listening
+ *
+ * The progress of the connection is checked using
+ * `$INSTANCE_NAME`_TcpConnectStatus(), or, with the event reactor, the
+ * Accept handler of the socket is called when the connection is established
+ * (or the Timeout/Closed handler when it fails).  Connections to several
+ * servers may be in progress at once.
+ * \sa `$INSTANCE_NAME`_TcpConnect()
+ */
+cystatus `$INSTANCE_NAME`_TcpConnectStart( uint8 socket, uint32 ip, uint16 port );
+
+/**
+ * \brief Check the progress of a client connection
+ * \param socket the socket number
+ * \returns `$INSTANCE_NAME`_CONNECT_IN_PROGRESS while the connect is in progress
+ * \returns `$INSTANCE_NAME`_CONNECT_ESTABLISHED once connected
+ * \returns `$INSTANCE_NAME`_CONNECT_TIMEOUT when the server did not answer
+ * \returns `$INSTANCE_NAME`_CONNECT_REFUSED when the server reset the connection
+ * \returns `$INSTANCE_NAME`_CONNECT_IDLE when no connect was started
+ *
+ * The subnet mask errata handling is completed when the connect completes.
+ * \sa `$INSTANCE_NAME`_TcpConnectStart()
+ */
+uint8 `$INSTANCE_NAME`_TcpConnectStatus( uint8 socket );
 
 /**
  * \brief Return the connection status of the TCP socket
@@ -456,6 +1459,59 @@ void `$INSTANCE_NAME`_TcpDisconnect( uint8 socket );
  */
 uint16 `$INSTANCE_NAME`_TcpSend(uint8 socket, uint8* buffer, uint16 len);
 
+/**
+ * \brief Transmit a list of data segments as one TCP send
+ * \param socket the socket on which the transmission will occur
+ * \param *iov the array of data segments
+ * \param count the number of segments in the array
+ * \returns the number of bytes transmitted via TCP
+ *
+ * The segments (for example a header, constant strings and dynamic data)
+ * are written consecutively in to the transmit buffer and sent using a
+ * single SEND command, without first assembling them in a local buffer.  As
+ * with `$INSTANCE_NAME`_TcpSend(), the total length is limited to 2K.
+ * \sa `$INSTANCE_NAME`_TcpSend()
+ */
+uint16 `$INSTANCE_NAME`_TcpSendv(uint8 socket, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count);
+
+/**
+ * \brief Send as much data as will fit in the free transmit memory
+ * \param socket the socket on which the transmission will occur
+ * \param *buffer the data to be transmitted
+ * \param len the length of the data
+ * \returns the number of bytes written and sent (0 when there is no free memory)
+ *
+ * Unlike `$INSTANCE_NAME`_TcpSend(), this function does not wait for transmit
+ * memory to become available.  The data which fits in the currently free
+ * memory is copied and sent, and the application should call again with the
+ * remaining data.
+ *
+ * Without `$INSTANCE_NAME`_ASYNC_SEND the SEND of the copied data is
+ * waited for before this returns.  With it, data written while the previous
+ * SEND is in progress is copied in to the free memory behind that SEND, and
+ * is sent by the next call (or the next send on the socket, or
+ * `$INSTANCE_NAME`_SocketSendDone()) once the SEND has completed.
+ * \sa `$INSTANCE_NAME`_TcpSendStream()
+ */
+uint16 `$INSTANCE_NAME`_TcpWrite(uint8 socket, uint8* buffer, uint16 len);
+
+/**
+ * \brief Send a buffer of any length using TCP
+ * \param socket the socket on which the transmission will occur
+ * \param *buffer the data to be transmitted
+ * \param len the length of the data (up to 64K)
+ * \returns the number of bytes sent, which is less than len when the
+ *  connection was closed during the transfer
+ *
+ * This function will send the data in pieces as transmit memory becomes
+ * free, keeping the transmit buffer of the device full, and returns once
+ * all of the data has been sent.  Without `$INSTANCE_NAME`_ASYNC_SEND
+ * every piece waits for its SEND to complete, so the buffer is only kept
+ * full when the asynchronous send is enabled.
+ * \sa `$INSTANCE_NAME`_TcpWrite()
+ */
+uint16 `$INSTANCE_NAME`_TcpSendStream(uint8 socket, uint8* buffer, uint16 len);
+
 /**
  * \brief Receive a packet of data using the built-in TCP handler
  * \param socket The socket on which the receive will occur
@@ -491,6 +1547,8 @@ uint16 `$INSTANCE_NAME`_TcpReceive( uint8 socket, uint8* buffer, uint16 length )
  * this function is a shortcut to using the `$INSTANCE_NAME`_TcpSend()
  * to transmit a zero-terminated ASCII (ASCII-Z) string to a remote
  * client/server.
+ * \note With `$INSTANCE_NAME`_COALESCE, the string is staged using
+ * `$INSTANCE_NAME`_TcpQueue(), and is sent with the following output.
  * \sa `$INSTANCE_NAME`_TcpOpen()
  * \sa `$INSTANCE_NAME`_TcpConnect()
  * \sa `$INSTANCE_NAME`_TcpStartServer()
@@ -500,6 +1558,68 @@ uint16 `$INSTANCE_NAME`_TcpReceive( uint8 socket, uint8* buffer, uint16 length )
  */
 void `$INSTANCE_NAME`_TcpPrint( uint8 socket, const char* str );
 
+/**
+ * \brief Send formatted text using TCP
+ * \param socket the connected TCP socket
+ * \param *format the format string
+ * \returns the number of characters sent
+ *
+ * The text is formatted directly in to the socket transmit buffer (through
+ * a 16 byte block), rather than in to a buffer the size of the output, and
+ * a single SEND is issued at the end (unless the output fills the transmit
+ * buffer, in which case it is sent in parts).  The supported conversions are:
+ * \li %d, %i : signed integer, %u : unsigned integer
+ * \li %x, %X : hexadecimal integer
+ * \li %c : character, %s : string (the precision limits the length)
+ * \li %% : a percent sign
+ * \par
+ * The l modifier selects long (32-bit) arguments, and the - (left justify)
+ * and 0 (zero pad) flags and a field width may be used.  A precision on the
+ * integer conversions is the minimum number of digits, as for the C library
+ * printf(), so %.3d of 7 prints 007 and %.0d of 0 prints nothing; it is
+ * limited to 20 digits.  (Floating point is not supported.)
+ * \note With `$INSTANCE_NAME`_COALESCE, the output is staged as for
+ * `$INSTANCE_NAME`_TcpPrint().
+ */
+uint16 `$INSTANCE_NAME`_TcpPrintf( uint8 socket, const char* format, ... );
+
+#if (`$INSTANCE_NAME`_COALESCE)
+/**
+ * \brief Stage data in the transmit buffer, to be sent with the following data
+ * \param socket the connected TCP socket
+ * \param *buffer the data to send
+ * \param len the number of bytes to send
+ * \returns the number of bytes staged (less than len when the connection closed)
+ *
+ * The data is copied in to the socket transmit buffer, but the SEND is only
+ * issued once `$INSTANCE_NAME`_COALESCE_SIZE bytes are staged, or when the
+ * buffer is full.  Data sent using the other TCP send functions is sent
+ * after, and together with, the staged data.
+ * \sa `$INSTANCE_NAME`_TcpFlush()
+ * \sa `$INSTANCE_NAME`_TcpFlushTimer()
+ */
+uint16 `$INSTANCE_NAME`_TcpQueue(uint8 socket, const uint8* buffer, uint16 len);
+
+/**
+ * \brief Send the data staged on a socket
+ * \param socket the socket number
+ *
+ * `$INSTANCE_NAME`_TcpDisconnect() flushes the staged data before the
+ * connection is closed.  Staged data is discarded by
+ * `$INSTANCE_NAME`_SocketClose().
+ */
+void `$INSTANCE_NAME`_TcpFlush( uint8 socket );
+
+/**
+ * \brief Send staged data which has waited for the coalescing time
+ * \param elapsed the time (ms) since the previous call
+ *
+ * This function is called periodically by the application, so that a
+ * partial line of output is not held indefinitely.
+ */
+void `$INSTANCE_NAME`_TcpFlushTimer( uint16 elapsed );
+#endif
+
 #endif
 
 #if (`$INCLUDE_UDP`)
@@ -538,6 +1658,21 @@ uint8 `$INSTANCE_NAME`_UdpOpen(uint16 port);
  */
 uint16 `$INSTANCE_NAME`_UdpSend(uint8 socket, uint32 ip, uint16 port, uint8* buffer, uint16 length);
 
+/**
+ * \brief Transmit a list of data segments as one UDP packet
+ * \param socket the socket on which the transmission will occur
+ * \param ip the IPv4 address of the destination
+ * \param port the destination port
+ * \param *iov the array of data segments
+ * \param count the number of segments in the array
+ * \returns the number of bytes transmitted
+ *
+ * The segments are written consecutively in to the transmit buffer and sent
+ * as one packet.  The total length is limited to 2K.
+ * \sa `$INSTANCE_NAME`_UdpSend()
+ */
+uint16 `$INSTANCE_NAME`_UdpSendv(uint8 socket, uint32 ip, uint16 port, const `$INSTANCE_NAME`_IOVEC* iov, uint8 count);
+
 /**
  * \brief Receive a packet of data using the built-in UDP handler
  * \param socket The socket on which the receive will occur
@@ -0,0 +1,351 @@
+/**
+ * \file SPI frame and bus time benchmarks of the W5100 driver API
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ *   bench [-k khz] [-b baseline] [-u baseline]
+ *
+ * Each benchmark starts the driver on a freshly reset model with the
+ * in-memory peer, sets up the socket it needs, and then measures one API
+ * call: the SPI frames and bytes on the bus, the bus time of those bytes at
+ * the SPI clock (-k, 4000 kHz by default), and the simulated time the call
+ * took, which includes the processor time of the SPI accesses and the
+ * waits for the network.
+ *
+ * With -b, each metric is compared with the baseline file, and the run
+ * fails when a metric exceeds its baseline by more than the threshold of
+ * the metric, given in percent in the file.  -u writes the results as a
+ * new baseline, keeping the thresholds of the existing file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <W5100.h>
+#include <SPIM.h>
+#include <SPI.h>
+#include "w51sim.h"
+#include "peer.h"
+
+#define BENCH_DEADLINE           ( 10000000000ull )
+#define BENCH_MAX                ( 32 )
+#define BENCH_METRICS            ( 3 )
+
+/**
+ * \brief Measured cost of one benchmark
+ */
+typedef struct {
+	char Name[32];
+	double Value[BENCH_METRICS];   /**< frames, bytes and call time (us) */
+} BENCH_RESULT;
+
+typedef struct {
+	const char* Name;
+	void (*Setup)( void );
+	void (*Run)( void );
+} BENCH;
+
+static const char* Bench_MetricName[BENCH_METRICS] = { "frames", "bytes", "call_us" };
+/* default thresholds, in percent: the bus traffic is exact, the time is not */
+static double Bench_Threshold[BENCH_METRICS] = { 0.0, 0.0, 2.0 };
+
+static const uint8 Bench_ClientIp[4] = { 192, 168, 1, 20 };
+static jmp_buf Bench_Escape;
+static uint8 Bench_Socket;
+static uint8 Bench_Data[1024];
+static uint8 Bench_Buffer[1024];
+static uint16 Bench_Length;
+/* ======================================================================== */
+/* Setup */
+/* ------------------------------------------------------------------------ */
+static void Bench_None( void )
+{
+}
+/* ------------------------------------------------------------------------ */
+static void Bench_TcpConnection( void )
+{
+	Bench_Socket = W5100_TcpOpen(23);
+	W5100_TcpStartServer(Bench_Socket);
+	Peer_Accept(Bench_Socket, Bench_ClientIp, 40000);
+	/* complete the status reads of the connection */
+	W5100_TcpConnected(Bench_Socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Bench_TcpData( void )
+{
+	Bench_TcpConnection();
+	Peer_Write(Bench_Socket, Bench_Data, Bench_Length);
+}
+/* ------------------------------------------------------------------------ */
+static void Bench_UdpSocket( void )
+{
+	Bench_Socket = W5100_UdpOpen(5000);
+}
+/* ------------------------------------------------------------------------ */
+static void Bench_UdpData( void )
+{
+	Bench_UdpSocket();
+	Peer_WriteUdp(Bench_Socket, Bench_ClientIp, 6000, Bench_Data, Bench_Length);
+}
+/* ======================================================================== */
+/* Measured calls */
+/* ------------------------------------------------------------------------ */
+static void Bench_Start( void ) { W5100_Start(); }
+static void Bench_TcpOpen( void ) { W5100_TcpOpen(80); }
+static void Bench_TcpSend( void ) { W5100_TcpSend(Bench_Socket, Bench_Data, Bench_Length); }
+static void Bench_TcpReceive( void ) { W5100_TcpReceive(Bench_Socket, Bench_Buffer, Bench_Length); }
+static void Bench_TcpPoll( void ) { W5100_TcpReceive(Bench_Socket, Bench_Buffer, sizeof(Bench_Buffer)); }
+static void Bench_ProcessConnections( void ) { W5100_SocketProcessConnections(Bench_Socket); }
+/* ------------------------------------------------------------------------ */
+static void Bench_UdpSend( void )
+{
+	W5100_UdpSend(Bench_Socket, W5100_IPADDRESS(192,168,1,20), 6000, Bench_Data, Bench_Length);
+}
+/* ------------------------------------------------------------------------ */
+static void Bench_UdpReceive( void )
+{
+	uint32 ip;
+	uint16 port;
+
+	W5100_UdpReceive(Bench_Socket, &ip, &port, Bench_Buffer, Bench_Length);
+}
+/* ======================================================================== */
+/* Runner */
+/* ------------------------------------------------------------------------ */
+static const BENCH Bench_List[] = {
+	{ "start", Bench_None, Bench_Start },
+	{ "tcp_open", Bench_None, Bench_TcpOpen },
+	{ "tcp_send_1", Bench_TcpConnection, Bench_TcpSend },
+	{ "tcp_send_64", Bench_TcpConnection, Bench_TcpSend },
+	{ "tcp_send_1024", Bench_TcpConnection, Bench_TcpSend },
+	{ "tcp_receive_1", Bench_TcpData, Bench_TcpReceive },
+	{ "tcp_receive_64", Bench_TcpData, Bench_TcpReceive },
+	{ "tcp_receive_1024", Bench_TcpData, Bench_TcpReceive },
+	{ "tcp_receive_empty", Bench_TcpConnection, Bench_TcpPoll },
+	{ "udp_send_64", Bench_UdpSocket, Bench_UdpSend },
+	{ "udp_receive_64", Bench_UdpData, Bench_UdpReceive },
+	{ "process_connections", Bench_TcpConnection, Bench_ProcessConnections },
+	{ NULL, NULL, NULL }
+};
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Data length of a benchmark, from the number at the end of its name
+ */
+static uint16 Bench_NameLength( const char* name )
+{
+	const char* end;
+
+	end = strrchr(name, '_');
+	if ( (end != NULL) && (end[1] >= '0') && (end[1] <= '9') ) {
+		return( atoi(&end[1]) );
+	}
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+static int Bench_Measure( const BENCH* bench, uint32 khz, BENCH_RESULT* result )
+{
+	W51SIM_STATS stats;
+	uint64_t start;
+	uint16 index;
+
+	for(index=0;index<sizeof(Bench_Data);++index) {
+		Bench_Data[index] = (uint8)(index * 13);
+	}
+	Bench_Length = Bench_NameLength(bench->Name);
+	W51Sim_Init(Peer_Init());
+	W51Sim_SetSpiClock(khz);
+	SPIM_initVar = 0;
+	SPI_initVar = 0;
+	if (setjmp(Bench_Escape) != 0) {
+		printf("%s did not return within the deadline\n", bench->Name);
+		return( 1 );
+	}
+	W51Sim_SetDeadline(BENCH_DEADLINE, &Bench_Escape);
+	if (bench->Run != Bench_Start) {
+		W5100_Start();
+	}
+	bench->Setup();
+	W51Sim_GetStats(&stats);
+	W51Sim_ClearStats();
+	start = W51Sim_Now();
+	bench->Run();
+	W51Sim_GetStats(&stats);
+	W51Sim_SetDeadline(0, NULL);
+
+	strncpy(result->Name, bench->Name, sizeof(result->Name) - 1);
+	result->Name[sizeof(result->Name) - 1] = 0;
+	result->Value[0] = stats.ReadFrames + stats.WriteFrames;
+	result->Value[1] = stats.Bytes;
+	result->Value[2] = (W51Sim_Now() - start) / 1000.0;
+	return( (stats.FrameErrors + stats.Overruns + stats.Hazards) != 0 );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a baseline file
+ * \returns the number of results read, or -1 when the file cannot be read
+ *
+ * Lines are "spi_khz <khz>", "threshold <frames> <bytes> <call_us>" and
+ * "<benchmark> <frames> <bytes> <call_us>", and # starts a comment.
+ */
+static int Bench_Load( const char* path, uint32* khz, BENCH_RESULT* baseline )
+{
+	char line[256];
+	FILE* file;
+	int count;
+	double value[BENCH_METRICS];
+	char name[32];
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		return( -1 );
+	}
+	count = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (line[0] == '#') {
+			continue;
+		}
+		if (sscanf(line, "spi_khz %u", khz) == 1) {
+			continue;
+		}
+		if (sscanf(line, "%31s %lf %lf %lf", name, &value[0], &value[1], &value[2]) != 4) {
+			continue;
+		}
+		if (strcmp(name, "threshold") == 0) {
+			memcpy(Bench_Threshold, value, sizeof(value));
+		}
+		else if (count < BENCH_MAX) {
+			strcpy(baseline[count].Name, name);
+			memcpy(baseline[count].Value, value, sizeof(value));
+			++count;
+		}
+	}
+	fclose(file);
+	return( count );
+}
+/* ------------------------------------------------------------------------ */
+static int Bench_Save( const char* path, uint32 khz, const BENCH_RESULT* result, int count )
+{
+	FILE* file;
+	int index;
+
+	file = fopen(path, "w");
+	if (file == NULL) {
+		return( 1 );
+	}
+	fprintf(file, "# W5100 API benchmark baseline, regenerate with \"make -C host bench-update\"\n");
+	fprintf(file, "# a metric fails when it exceeds the baseline by more than its threshold (percent)\n");
+	fprintf(file, "spi_khz %u\n", (unsigned)khz);
+	fprintf(file, "threshold %g %g %g\n", Bench_Threshold[0], Bench_Threshold[1], Bench_Threshold[2]);
+	fprintf(file, "# benchmark frames bytes call_us\n");
+	for(index=0;index<count;++index) {
+		fprintf(file, "%s %.0f %.0f %.1f\n", result[index].Name,
+			result[index].Value[0], result[index].Value[1], result[index].Value[2]);
+	}
+	fclose(file);
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Compare a result with its baseline
+ * \returns the number of metrics which regressed past their threshold
+ */
+static int Bench_Compare( const BENCH_RESULT* result, const BENCH_RESULT* baseline, int count, uint8 timed )
+{
+	const BENCH_RESULT* base;
+	double limit;
+	int failed;
+	int index;
+	int metric;
+
+	base = NULL;
+	for(index=0;index<count;++index) {
+		if (strcmp(baseline[index].Name, result->Name) == 0) {
+			base = &baseline[index];
+		}
+	}
+	if (base == NULL) {
+		printf("  %s has no baseline\n", result->Name);
+		return( 0 );
+	}
+	failed = 0;
+	for(metric=0;metric<BENCH_METRICS;++metric) {
+		if ( (metric == 2) && (timed == 0) ) {
+			/* the call time depends on the SPI clock of the baseline */
+			continue;
+		}
+		limit = base->Value[metric] * (1.0 + (Bench_Threshold[metric] / 100.0));
+		if (result->Value[metric] > (limit + 0.05)) {
+			printf("  REGRESSION %s %s: %.1f, baseline %.1f (+%g%%)\n", result->Name,
+				Bench_MetricName[metric], result->Value[metric], base->Value[metric], Bench_Threshold[metric]);
+			++failed;
+		}
+	}
+	return( failed );
+}
+/* ------------------------------------------------------------------------ */
+int main( int argc, char** argv )
+{
+	static BENCH_RESULT result[BENCH_MAX];
+	static BENCH_RESULT baseline[BENCH_MAX];
+	const char* compare;
+	const char* update;
+	uint32 khz;
+	uint32 baseKhz;
+	int baseCount;
+	int count;
+	int failed;
+	int index;
+
+	khz = 4000;
+	compare = NULL;
+	update = NULL;
+	for(index=1;index<argc;++index) {
+		if ( (strcmp(argv[index], "-k") == 0) && ((index+1) < argc) ) {
+			khz = strtoul(argv[++index], NULL, 0);
+		}
+		else if ( (strcmp(argv[index], "-b") == 0) && ((index+1) < argc) ) {
+			compare = argv[++index];
+		}
+		else if ( (strcmp(argv[index], "-u") == 0) && ((index+1) < argc) ) {
+			update = argv[++index];
+		}
+		else {
+			fprintf(stderr, "usage: bench [-k khz] [-b baseline] [-u baseline]\n");
+			return( 2 );
+		}
+	}
+	baseKhz = khz;
+	baseCount = 0;
+	if (compare != NULL) {
+		baseCount = Bench_Load(compare, &baseKhz, baseline);
+		if (baseCount < 0) {
+			fprintf(stderr, "bench: cannot read %s\n", compare);
+			return( 2 );
+		}
+	}
+	else if (update != NULL) {
+		/* keep the thresholds of the baseline being replaced */
+		Bench_Load(update, &baseKhz, baseline);
+	}
+
+	failed = 0;
+	printf("%-22s %8s %8s %10s %10s   (SPI %u kHz)\n", "benchmark", "frames", "bytes", "bus_us", "call_us", (unsigned)khz);
+	for(count=0;Bench_List[count].Name != NULL;++count) {
+		if (Bench_Measure(&Bench_List[count], khz, &result[count]) != 0) {
+			printf("  %s: framing errors, overruns or hazards on the bus\n", Bench_List[count].Name);
+			++failed;
+		}
+		printf("%-22s %8.0f %8.0f %10.1f %10.1f\n", result[count].Name, result[count].Value[0],
+			result[count].Value[1], (result[count].Value[1] * 8000.0) / khz, result[count].Value[2]);
+		if (compare != NULL) {
+			failed += Bench_Compare(&result[count], baseline, baseCount, (baseKhz == khz));
+		}
+	}
+	if (update != NULL) {
+		if (Bench_Save(update, khz, result, count) != 0) {
+			fprintf(stderr, "bench: cannot write %s\n", update);
+			return( 2 );
+		}
+		printf("baseline written to %s\n", update);
+	}
+	return( (failed == 0) ? 0 : 1 );
+}
@@ -0,0 +1,37 @@
+/**
+ * \file TCP echo server on the component API, for throughput measurements
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * Built like the example projects, so it runs on the emulator unchanged.
+ * Every byte received on port 7 is sent back, until the client closes.
+ */
+#include <project.h>
+
+#define ECHO_PORT                ( 7 )
+
+int main()
+{
+	uint8 buffer[512];
+	uint8 tcpSocket;
+	uint16 length;
+
+	SPIM_Start();
+	W5100_Start();
+	for(;;)
+	{
+		tcpSocket = W5100_TcpOpen( ECHO_PORT );
+		if (tcpSocket < 4) {
+			W5100_TcpStartServerWait( tcpSocket );
+			for(;;) {
+				length = W5100_TcpReceive( tcpSocket, buffer, sizeof(buffer) );
+				if (length != 0) {
+					W5100_TcpSend( tcpSocket, buffer, length );
+				}
+				else if (W5100_SocketProcessConnections( tcpSocket ) != 0) {
+					break;
+				}
+			}
+			W5100_SocketClose( tcpSocket );
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/**
+ * \file Run a W5100 application on the loopback backend of the host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The application is compiled unchanged, with its main() renamed to
+ * Emu_Main(), and linked with this file, the model and the loopback
+ * backend.  The emulator is configured from the environment:
+ *
+ *   W5100_PORT_OFFSET   added to the device ports listened on (10000)
+ *   W5100_SPI_KHZ       modeled SPI clock (4000)
+ *   W5100_REALTIME      0 to run as fast as the host allows, rather than
+ *                       holding the simulated time to real time
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "w51sim.h"
+#include "loopback.h"
+
+#define EMU_PORT_OFFSET          ( 10000 )
+
+int Emu_Main();
+
+/* ------------------------------------------------------------------------ */
+static unsigned long Emu_Option( const char* name, unsigned long value )
+{
+	const char* env;
+
+	env = getenv(name);
+	return( (env != NULL) ? strtoul(env, NULL, 0) : value );
+}
+/* ------------------------------------------------------------------------ */
+int main( void )
+{
+	uint16 offset;
+
+	offset = Emu_Option("W5100_PORT_OFFSET", EMU_PORT_OFFSET);
+	W51Sim_SetSpiClock(Emu_Option("W5100_SPI_KHZ", W51Sim_GetSpiClock()));
+	Loopback_SetRealTime(Emu_Option("W5100_REALTIME", 1) != 0);
+	W51Sim_Init(Loopback_Init(offset));
+	fprintf(stderr, "w5100 emulator: device ports are on 127.0.0.1 at port+%u, SPI at %u kHz\n",
+		offset, (unsigned)W51Sim_GetSpiClock());
+
+	return( Emu_Main() );
+}
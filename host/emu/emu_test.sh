@@ -0,0 +1,24 @@
+#!/bin/sh
+# End-to-end run of the emulator: the unchanged example telnet server and
+# the echo server are run on the loopback backend, and driven by loadgen.
+#
+#   emu_test.sh [build directory]
+set -e
+BUILD=${1:-build}/emu
+OFFSET=${W5100_PORT_OFFSET:-20000}
+export W5100_PORT_OFFSET=$OFFSET
+
+run() {
+	app=$1
+	shift
+	$BUILD/$app &
+	pid=$!
+	status=0
+	$BUILD/loadgen "$@" || status=$?
+	kill $pid
+	wait $pid 2>/dev/null || true
+	return $status
+}
+
+run emu_example connect $((OFFSET + 23)) 10 "Hello From E2ForLife.com"
+run emu_echo echo $((OFFSET + 7)) 32768
@@ -0,0 +1,216 @@
+/**
+ * \file Load generator for applications running on the W5100 emulator
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ *   loadgen connect PORT COUNT [TEXT]
+ *       connect COUNT times in turn, read each connection until the server
+ *       closes it, check that TEXT was received, and report connections/s
+ *   loadgen echo PORT BYTES
+ *       stream BYTES to an echo server while reading them back, check the
+ *       data, and report MB/s
+ *
+ * Connects are retried for LOADGEN_RETRY_MS, while the emulated device
+ * starts up, and the run fails when the server stops responding for
+ * LOADGEN_IDLE_S.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define LOADGEN_RETRY_MS         ( 5000 )
+#define LOADGEN_IDLE_S           ( 10 )
+#define LOADGEN_CHUNK            ( 4096 )
+
+typedef struct {
+	int Fd;
+	unsigned long Bytes;
+} LOADGEN_STREAM;
+
+/* ------------------------------------------------------------------------ */
+static double LoadGen_Now( void )
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( now.tv_sec + (now.tv_nsec / 1e9) );
+}
+/* ------------------------------------------------------------------------ */
+static unsigned char LoadGen_Pattern( unsigned long index )
+{
+	return( (unsigned char)((index * 31) + (index >> 8)) );
+}
+/* ------------------------------------------------------------------------ */
+static int LoadGen_Connect( unsigned short port )
+{
+	struct sockaddr_in addr;
+	struct timeval idle;
+	double until;
+	int fd;
+	int one;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	until = LoadGen_Now() + (LOADGEN_RETRY_MS / 1000.0);
+	for(;;) {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return( -1 );
+		}
+		if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+			break;
+		}
+		close(fd);
+		if ( (errno != ECONNREFUSED) || (LoadGen_Now() > until) ) {
+			fprintf(stderr, "loadgen: connect to port %u: %s\n", port, strerror(errno));
+			return( -1 );
+		}
+		usleep(20000);
+	}
+	one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	idle.tv_sec = LOADGEN_IDLE_S;
+	idle.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+	return( fd );
+}
+/* ------------------------------------------------------------------------ */
+static int LoadGen_ConnectRun( unsigned short port, unsigned long count, const char* text )
+{
+	char buffer[1024];
+	unsigned long index;
+	size_t length;
+	ssize_t got;
+	double start;
+	double elapsed;
+	int fd;
+
+	start = LoadGen_Now();
+	for(index=0;index<count;++index) {
+		fd = LoadGen_Connect(port);
+		if (fd < 0) {
+			return( 1 );
+		}
+		length = 0;
+		do {
+			got = recv(fd, &buffer[length], sizeof(buffer) - 1 - length, 0);
+			if (got > 0) {
+				length += got;
+			}
+		} while ( (got > 0) && (length < (sizeof(buffer) - 1)) );
+		close(fd);
+		buffer[length] = 0;
+		if (got < 0) {
+			fprintf(stderr, "loadgen: connection %lu: %s\n", index, strerror(errno));
+			return( 1 );
+		}
+		if ( (text != NULL) && (strstr(buffer, text) == NULL) ) {
+			fprintf(stderr, "loadgen: connection %lu: \"%s\" was not received\n", index, text);
+			return( 1 );
+		}
+	}
+	elapsed = LoadGen_Now() - start;
+	printf("connect: %lu connections in %.3f s, %.1f connections/s\n", count, elapsed, count / elapsed);
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+static void* LoadGen_Writer( void* arg )
+{
+	unsigned char buffer[LOADGEN_CHUNK];
+	LOADGEN_STREAM* stream;
+	unsigned long sent;
+	size_t length;
+	size_t index;
+	ssize_t put;
+
+	stream = (LOADGEN_STREAM*)arg;
+	sent = 0;
+	while (sent < stream->Bytes) {
+		length = ((stream->Bytes - sent) > sizeof(buffer)) ? sizeof(buffer) : (stream->Bytes - sent);
+		for(index=0;index<length;++index) {
+			buffer[index] = LoadGen_Pattern(sent + index);
+		}
+		put = send(stream->Fd, buffer, length, MSG_NOSIGNAL);
+		if (put <= 0) {
+			break;
+		}
+		sent += put;
+	}
+	return( NULL );
+}
+/* ------------------------------------------------------------------------ */
+static int LoadGen_EchoRun( unsigned short port, unsigned long bytes )
+{
+	unsigned char buffer[LOADGEN_CHUNK];
+	LOADGEN_STREAM stream;
+	pthread_t writer;
+	unsigned long received;
+	ssize_t got;
+	ssize_t index;
+	double start;
+	double elapsed;
+
+	stream.Fd = LoadGen_Connect(port);
+	if (stream.Fd < 0) {
+		return( 1 );
+	}
+	stream.Bytes = bytes;
+	start = LoadGen_Now();
+	pthread_create(&writer, NULL, LoadGen_Writer, &stream);
+	received = 0;
+	while (received < bytes) {
+		got = recv(stream.Fd, buffer, sizeof(buffer), 0);
+		if (got <= 0) {
+			fprintf(stderr, "loadgen: echo stopped after %lu of %lu bytes: %s\n", received, bytes,
+				(got == 0) ? "closed" : strerror(errno));
+			shutdown(stream.Fd, SHUT_RDWR);
+			pthread_join(writer, NULL);
+			close(stream.Fd);
+			return( 1 );
+		}
+		for(index=0;index<got;++index) {
+			if (buffer[index] != LoadGen_Pattern(received + index)) {
+				fprintf(stderr, "loadgen: echo differs at byte %lu\n", received + index);
+				shutdown(stream.Fd, SHUT_RDWR);
+				pthread_join(writer, NULL);
+				close(stream.Fd);
+				return( 1 );
+			}
+		}
+		received += got;
+	}
+	elapsed = LoadGen_Now() - start;
+	pthread_join(writer, NULL);
+	close(stream.Fd);
+	printf("echo: %lu bytes each way in %.3f s, %.3f MB/s\n", bytes, elapsed, (bytes / elapsed) / 1e6);
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+int main( int argc, char** argv )
+{
+	unsigned short port;
+
+	if ( (argc >= 4) && (strcmp(argv[1], "connect") == 0) ) {
+		port = strtoul(argv[2], NULL, 0);
+		return( LoadGen_ConnectRun(port, strtoul(argv[3], NULL, 0), (argc > 4) ? argv[4] : NULL) );
+	}
+	if ( (argc >= 4) && (strcmp(argv[1], "echo") == 0) ) {
+		port = strtoul(argv[2], NULL, 0);
+		return( LoadGen_EchoRun(port, strtoul(argv[3], NULL, 0)) );
+	}
+	fprintf(stderr, "usage: loadgen connect PORT COUNT [TEXT]\n"
+		"       loadgen echo PORT BYTES\n");
+	return( 2 );
+}
@@ -0,0 +1,51 @@
+/**
+ * \file Host implementation of the Cypress library functions used by the driver
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The delays advance the simulated time of the W5100 model.  Interrupts are
+ * not modeled, so the critical section and interrupt controller functions
+ * have no effect.
+ */
+#include <cylib.h>
+#include "w51sim.h"
+
+/* processor clock used to convert CyDelayCycles() to time */
+#define CYSIM_CPU_MHZ            ( 48 )
+
+/* ------------------------------------------------------------------------ */
+void CyDelay( uint32 milliseconds )
+{
+	W51Sim_Advance((uint64_t)milliseconds * 1000000ull);
+}
+/* ------------------------------------------------------------------------ */
+void CyDelayUs( uint16 microseconds )
+{
+	W51Sim_Advance((uint64_t)microseconds * 1000ull);
+}
+/* ------------------------------------------------------------------------ */
+void CyDelayCycles( uint32 cycles )
+{
+	W51Sim_Advance(((uint64_t)cycles * 1000ull) / CYSIM_CPU_MHZ);
+}
+/* ------------------------------------------------------------------------ */
+uint8 CyEnterCriticalSection( void )
+{
+	return( 0 );
+}
+/* ------------------------------------------------------------------------ */
+void CyExitCriticalSection( uint8 savedIntrStatus )
+{
+	(void)savedIntrStatus;
+}
+/* ------------------------------------------------------------------------ */
+cyisraddress CyIntSetVector( uint8 number, cyisraddress address )
+{
+	(void)number;
+	(void)address;
+	return( NULL );
+}
+/* ------------------------------------------------------------------------ */
+void CyIntEnable( uint8 number ) { (void)number; }
+void CyIntDisable( uint8 number ) { (void)number; }
+void CyIntSetPriority( uint8 number, uint8 priority ) { (void)number; (void)priority; }
+void CyIntClearPending( uint8 number ) { (void)number; }
@@ -0,0 +1,510 @@
+/**
+ * \file Loopback network backend of the W5100 host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * Each socket of the model is backed by a host socket on 127.0.0.1:
+ *
+ *   LISTEN    listens on the socket port plus the port offset, and the
+ *             socket is established when a client connection is accepted
+ *   CONNECT   connects to 127.0.0.1 at the destination port, whatever the
+ *             destination IP address
+ *   SEND      writes the data to the connection, or sends the datagram to
+ *             127.0.0.1 at the destination port, and completes once the
+ *             host has taken all of the data
+ *   RECV      the Rx buffer is refilled from the host socket as the driver
+ *             frees space in it
+ *   DISCON    shuts down the connection once the unsent data is written
+ *
+ * The offset moves the well known ports of the device (such as telnet) to
+ * ports that do not need privileges on the host.  The host listen socket of
+ * a port is kept open after the connection is accepted, so that clients are
+ * queued in its backlog while the application re-opens the device socket.
+ *
+ * The host sockets are polled each time the simulated time has advanced by
+ * LOOP_POLL_NS, and by default the simulated time is held to real time, so
+ * that delays of the application take as long as on the target, and the
+ * throughput seen by the clients is limited by the modeled SPI bus.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "loopback.h"
+
+/* simulated time between polls of the host sockets */
+#define LOOP_POLL_NS             ( 100000ull )
+/* the furthest the simulated time may fall behind real time */
+#define LOOP_SLIP_NS             ( 20000000ull )
+/* simulated time for which a disconnected connection is drained */
+#define LOOP_LINGER_NS           ( 1000000000ull )
+#define LOOP_LISTENERS           ( 8 )
+#define LOOP_ORPHANS             ( 16 )
+#define LOOP_BUFFER_SIZE         ( 0x2000 )
+
+/**
+ * \brief Host listen socket of a device port
+ */
+typedef struct {
+	int Fd;
+	uint16 Port;
+} LOOP_LISTENER;
+
+/**
+ * \brief Disconnected host connection which is drained until the client closes
+ */
+typedef struct {
+	int Fd;
+	uint64_t Until;
+} LOOP_ORPHAN;
+
+/**
+ * \brief Host side of one socket of the model
+ */
+typedef struct {
+	int Fd;              /**< connection or datagram socket, -1 when none */
+	uint8 Protocol;      /**< protocol of the socket mode register */
+	int Listener;        /**< listener of a socket in LISTEN, -1 when none */
+	uint8 Connecting;    /**< 1 while a connect is in progress, 2 when it failed */
+	uint8 ConnectIp[4];  /**< destination of the connect, as set on the device */
+	uint16 ConnectPort;
+	uint8 RemoteClosed;  /**< the client has closed its side of the connection */
+	uint8 Sending;       /**< a SEND is in progress */
+	uint16 OutHead;      /**< next byte of the SEND to be written */
+	uint16 OutCount;     /**< bytes of the SEND left to be written */
+	uint8 Out[LOOP_BUFFER_SIZE];
+} LOOP_SOCKET;
+
+static const uint8 Loop_LocalIp[4] = { 127, 0, 0, 1 };
+
+static LOOP_SOCKET Loop_Socket[4];
+static LOOP_LISTENER Loop_Listener[LOOP_LISTENERS];
+static LOOP_ORPHAN Loop_Orphan[LOOP_ORPHANS];
+static uint16 Loop_PortOffset;
+static uint8 Loop_RealTime = 1;
+static uint64_t Loop_Pending;
+static uint64_t Loop_SimBase;
+static uint64_t Loop_WallBase;
+static uint8 Loop_Buffer[LOOP_BUFFER_SIZE];
+/* ======================================================================== */
+/* Host socket helpers */
+/* ------------------------------------------------------------------------ */
+static void Loop_Address( struct sockaddr_in* addr, uint16 port )
+{
+	memset(addr, 0, sizeof(struct sockaddr_in));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr->sin_port = htons(port);
+}
+/* ------------------------------------------------------------------------ */
+static int Loop_Create( int type )
+{
+	int fd;
+	int one;
+
+	fd = socket(AF_INET, type, 0);
+	if (fd >= 0) {
+		one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (type == SOCK_STREAM) {
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+	return( fd );
+}
+/* ------------------------------------------------------------------------ */
+static uint64_t Loop_Wall( void )
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Close a disconnected connection once the client has closed it
+ *
+ * Closing a connection with unread data resets it, which can discard the
+ * data the client has not read yet, so the connection is drained first.
+ */
+static void Loop_Abandon( int fd )
+{
+	uint8 index;
+	uint8 oldest;
+
+	oldest = 0;
+	for(index=0;index<LOOP_ORPHANS;++index) {
+		if (Loop_Orphan[index].Fd < 0) {
+			break;
+		}
+		if (Loop_Orphan[index].Until < Loop_Orphan[oldest].Until) {
+			oldest = index;
+		}
+	}
+	if (index >= LOOP_ORPHANS) {
+		close(Loop_Orphan[oldest].Fd);
+		index = oldest;
+	}
+	Loop_Orphan[index].Fd = fd;
+	Loop_Orphan[index].Until = W51Sim_Now() + LOOP_LINGER_NS;
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Release( LOOP_SOCKET* loop )
+{
+	if (loop->Fd >= 0) {
+		close(loop->Fd);
+	}
+	loop->Fd = -1;
+	loop->Listener = -1;
+	loop->Connecting = 0;
+	loop->RemoteClosed = 0;
+	loop->Sending = 0;
+	loop->OutCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write the data of the SEND in progress, and complete it when done
+ */
+static void Loop_Flush( uint8 socket )
+{
+	LOOP_SOCKET* loop;
+	ssize_t count;
+
+	loop = &Loop_Socket[socket];
+	while ( (loop->OutCount != 0) && (loop->Fd >= 0) ) {
+		count = send(loop->Fd, &loop->Out[loop->OutHead], loop->OutCount, MSG_NOSIGNAL);
+		if (count > 0) {
+			loop->OutHead += count;
+			loop->OutCount -= count;
+		}
+		else if ( (count < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ) {
+			return;
+		}
+		else {
+			/* the connection is gone, and the data is lost */
+			loop->OutCount = 0;
+		}
+	}
+	if (loop->Sending != 0) {
+		loop->Sending = 0;
+		W51Sim_SendDone(socket);
+	}
+}
+/* ======================================================================== */
+/* Backend functions called by the model */
+/* ------------------------------------------------------------------------ */
+static void Loop_Open( uint8 socket, uint8 protocol, uint16 port )
+{
+	LOOP_SOCKET* loop;
+	struct sockaddr_in addr;
+
+	loop = &Loop_Socket[socket];
+	Loop_Release(loop);
+	loop->Protocol = protocol;
+	if (protocol == W51SIM_PROTO_UDP) {
+		loop->Fd = Loop_Create(SOCK_DGRAM);
+		Loop_Address(&addr, (port == 0) ? 0 : (uint16)(port + Loop_PortOffset));
+		if ( (loop->Fd >= 0) && (bind(loop->Fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) ) {
+			fprintf(stderr, "loopback: socket %d cannot bind UDP port %u: %s\n",
+				socket, ntohs(addr.sin_port), strerror(errno));
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Listen( uint8 socket, uint16 port )
+{
+	LOOP_LISTENER* listener;
+	struct sockaddr_in addr;
+	int index;
+	int fd;
+
+	for(index=0;index<LOOP_LISTENERS;++index) {
+		listener = &Loop_Listener[index];
+		if ( (listener->Fd >= 0) && (listener->Port == port) ) {
+			Loop_Socket[socket].Listener = index;
+			return;
+		}
+	}
+	for(index=0;(index<LOOP_LISTENERS) && (Loop_Listener[index].Fd >= 0);++index) {
+	}
+	fd = Loop_Create(SOCK_STREAM);
+	Loop_Address(&addr, port + Loop_PortOffset);
+	if ( (index >= LOOP_LISTENERS) || (fd < 0) ||
+		(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(fd, 16) != 0) ) {
+		fprintf(stderr, "loopback: socket %d cannot listen on TCP port %u: %s\n",
+			socket, ntohs(addr.sin_port), (index >= LOOP_LISTENERS) ? "too many ports" : strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return;
+	}
+	Loop_Listener[index].Fd = fd;
+	Loop_Listener[index].Port = port;
+	Loop_Socket[socket].Listener = index;
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Connect( uint8 socket, const uint8* ip, uint16 port )
+{
+	LOOP_SOCKET* loop;
+	struct sockaddr_in addr;
+
+	loop = &Loop_Socket[socket];
+	memcpy(loop->ConnectIp, ip, 4);
+	loop->ConnectPort = port;
+	loop->Connecting = 2;
+	loop->Fd = Loop_Create(SOCK_STREAM);
+	if (loop->Fd >= 0) {
+		Loop_Address(&addr, port);
+		if ( (connect(loop->Fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) || (errno == EINPROGRESS) ) {
+			loop->Connecting = 1;
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Send( uint8 socket, const uint8* data, uint16 length, const uint8* ip, uint16 port )
+{
+	LOOP_SOCKET* loop;
+	struct sockaddr_in addr;
+
+	(void)ip;
+	loop = &Loop_Socket[socket];
+	if ( (loop->Protocol == W51SIM_PROTO_UDP) && (loop->Fd >= 0) ) {
+		Loop_Address(&addr, port);
+		sendto(loop->Fd, data, length, 0, (struct sockaddr*)&addr, sizeof(addr));
+		W51Sim_SendDone(socket);
+	}
+	else if (loop->Protocol == W51SIM_PROTO_TCP) {
+		memcpy(loop->Out, data, length);
+		loop->OutHead = 0;
+		loop->OutCount = length;
+		loop->Sending = 1;
+		Loop_Flush(socket);
+	}
+	else {
+		/* raw sockets are not supported on the host, the data is dropped */
+		W51Sim_SendDone(socket);
+	}
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Discon( uint8 socket )
+{
+	LOOP_SOCKET* loop;
+	int fd;
+
+	loop = &Loop_Socket[socket];
+	if ( (loop->Fd >= 0) && (loop->Connecting == 0) ) {
+		/* write what is left of the data, the device sends it before the FIN */
+		loop->Sending = 0;
+		Loop_Flush(socket);
+		fd = loop->Fd;
+		loop->Fd = -1;
+		shutdown(fd, SHUT_WR);
+		Loop_Abandon(fd);
+	}
+	Loop_Release(loop);
+}
+/* ------------------------------------------------------------------------ */
+static void Loop_Close( uint8 socket )
+{
+	Loop_Release(&Loop_Socket[socket]);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Accept, connect, receive and send on the host sockets
+ */
+static void Loop_Service( void )
+{
+	LOOP_SOCKET* loop;
+	struct sockaddr_in addr;
+	socklen_t size;
+	ssize_t count;
+	uint16 space;
+	uint8 status;
+	uint8 ip[4];
+	uint8 socket;
+	uint8 index;
+	int error;
+	int fd;
+
+	for(socket=0;socket<4;++socket) {
+		loop = &Loop_Socket[socket];
+		status = W51Sim_Status(socket);
+		if ( (loop->Listener >= 0) && (status == W51SIM_SOCK_LISTEN) ) {
+			size = sizeof(addr);
+			fd = accept(Loop_Listener[loop->Listener].Fd, (struct sockaddr*)&addr, &size);
+			if (fd >= 0) {
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				error = 1;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &error, sizeof(error));
+				loop->Fd = fd;
+				loop->Listener = -1;
+				W51Sim_Established(socket, Loop_LocalIp, ntohs(addr.sin_port));
+			}
+		}
+		else if (loop->Connecting == 2) {
+			Loop_Release(loop);
+			W51Sim_Timeout(socket);
+		}
+		else if (loop->Connecting == 1) {
+			error = 0;
+			size = sizeof(error);
+			getsockopt(loop->Fd, SOL_SOCKET, SO_ERROR, &error, &size);
+			size = sizeof(addr);
+			if (error != 0) {
+				Loop_Release(loop);
+				W51Sim_Timeout(socket);
+			}
+			else if (getpeername(loop->Fd, (struct sockaddr*)&addr, &size) == 0) {
+				loop->Connecting = 0;
+				W51Sim_Established(socket, loop->ConnectIp, loop->ConnectPort);
+			}
+		}
+		else if ( (loop->Fd >= 0) && (loop->Protocol == W51SIM_PROTO_TCP) &&
+			((status == W51SIM_SOCK_ESTABLISHED) || (status == W51SIM_SOCK_CLOSE_WAIT)) ) {
+			Loop_Flush(socket);
+			space = W51Sim_RxFree(socket);
+			if ( (loop->RemoteClosed == 0) && (space != 0) ) {
+				count = recv(loop->Fd, Loop_Buffer, (space > LOOP_BUFFER_SIZE) ? LOOP_BUFFER_SIZE : space, 0);
+				if (count > 0) {
+					W51Sim_Deliver(socket, Loop_Buffer, count);
+				}
+				else if ( (count == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)) ) {
+					loop->RemoteClosed = 1;
+					W51Sim_RemoteClosed(socket);
+				}
+			}
+		}
+		else if ( (loop->Fd >= 0) && (status == W51SIM_SOCK_UDP) ) {
+			size = sizeof(addr);
+			count = recvfrom(loop->Fd, Loop_Buffer, LOOP_BUFFER_SIZE, 0, (struct sockaddr*)&addr, &size);
+			if (count >= 0) {
+				memcpy(ip, &addr.sin_addr.s_addr, 4);
+				W51Sim_DeliverUdp(socket, ip, ntohs(addr.sin_port), Loop_Buffer, count);
+			}
+		}
+	}
+	for(index=0;index<LOOP_ORPHANS;++index) {
+		if (Loop_Orphan[index].Fd >= 0) {
+			count = recv(Loop_Orphan[index].Fd, Loop_Buffer, LOOP_BUFFER_SIZE, 0);
+			if ( (count == 0) || ((count < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) ||
+				(W51Sim_Now() > Loop_Orphan[index].Until) ) {
+				close(Loop_Orphan[index].Fd);
+				Loop_Orphan[index].Fd = -1;
+			}
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Poll the host sockets, holding the simulated time to real time
+ *
+ * When the simulated time is ahead of real time, the host sockets are
+ * waited on for the difference.  When it is behind by more than
+ * LOOP_SLIP_NS, such as when the host is slower than the model, the
+ * difference is dropped, so that the delays which follow still wait.
+ */
+static void Loop_Poll( uint64_t elapsed )
+{
+	struct pollfd fds[4 + LOOP_ORPHANS];
+	struct timespec wait;
+	uint64_t sim;
+	uint64_t wall;
+	nfds_t count;
+	uint8 index;
+
+	Loop_Pending += elapsed;
+	if (Loop_Pending < LOOP_POLL_NS) {
+		return;
+	}
+	Loop_Pending = 0;
+	sim = W51Sim_Now() - Loop_SimBase;
+	wall = Loop_Wall() - Loop_WallBase;
+	if (Loop_RealTime == 0) {
+		sim = wall;
+	}
+	else if (wall > (sim + LOOP_SLIP_NS)) {
+		Loop_WallBase += wall - (sim + LOOP_SLIP_NS);
+		wall = sim + LOOP_SLIP_NS;
+	}
+	count = 0;
+	for(index=0;index<4;++index) {
+		if (Loop_Socket[index].Fd >= 0) {
+			fds[count].fd = Loop_Socket[index].Fd;
+			fds[count].events = POLLIN | ((Loop_Socket[index].OutCount != 0) ? POLLOUT : 0);
+			fds[count].revents = 0;
+			++count;
+		}
+		else if (Loop_Socket[index].Listener >= 0) {
+			fds[count].fd = Loop_Listener[Loop_Socket[index].Listener].Fd;
+			fds[count].events = POLLIN;
+			fds[count].revents = 0;
+			++count;
+		}
+	}
+	for(index=0;index<LOOP_ORPHANS;++index) {
+		if (Loop_Orphan[index].Fd >= 0) {
+			fds[count].fd = Loop_Orphan[index].Fd;
+			fds[count].events = POLLIN;
+			fds[count].revents = 0;
+			++count;
+		}
+	}
+	wait.tv_sec = 0;
+	wait.tv_nsec = 0;
+	if (sim > wall) {
+		wait.tv_sec = (sim - wall) / 1000000000ull;
+		wait.tv_nsec = (sim - wall) % 1000000000ull;
+	}
+	/* an event ends the wait early, and the rest is waited on the next poll */
+	ppoll(fds, count, &wait, NULL);
+	Loop_Service();
+}
+/* ------------------------------------------------------------------------ */
+static const W51SIM_NET Loop_Net = {
+	Loop_Open,
+	Loop_Listen,
+	Loop_Connect,
+	Loop_Send,
+	Loop_Discon,
+	Loop_Close,
+	Loop_Poll
+};
+/* ======================================================================== */
+/* Control */
+/* ------------------------------------------------------------------------ */
+const W51SIM_NET* Loopback_Init( uint16 portOffset )
+{
+	uint8 index;
+
+	for(index=0;index<4;++index) {
+		Loop_Socket[index].Fd = -1;
+		Loop_Release(&Loop_Socket[index]);
+	}
+	for(index=0;index<LOOP_LISTENERS;++index) {
+		Loop_Listener[index].Fd = -1;
+	}
+	for(index=0;index<LOOP_ORPHANS;++index) {
+		Loop_Orphan[index].Fd = -1;
+	}
+	Loop_PortOffset = portOffset;
+	Loop_Pending = 0;
+	Loop_SimBase = W51Sim_Now();
+	Loop_WallBase = Loop_Wall();
+	return( &Loop_Net );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Select whether the simulated time is held to real time
+ */
+void Loopback_SetRealTime( uint8 enable )
+{
+	Loop_RealTime = enable;
+}
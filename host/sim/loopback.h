@@ -0,0 +1,17 @@
+/**
+ * \file Loopback network backend of the W5100 host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The sockets of the model are mapped on to real host sockets on 127.0.0.1,
+ * so that an application built on the component API can be used with real
+ * clients and load generators.
+ */
+#if !defined(LOOPBACK_H)
+#define LOOPBACK_H
+
+#include "w51sim.h"
+
+const W51SIM_NET* Loopback_Init( uint16 portOffset );
+void Loopback_SetRealTime( uint8 enable );
+
+#endif
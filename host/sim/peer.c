@@ -0,0 +1,222 @@
+/**
+ * \file In-memory network peer for the W5100 host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ */
+#include <string.h>
+#include "peer.h"
+
+#define PEER_CAPTURE_SIZE        ( 0x10000 )
+/* per-SEND overhead and per-byte time on a 10 Mbit/s link */
+#define PEER_SEND_NS             ( 10000 )
+#define PEER_BYTE_NS             ( 800 )
+
+/**
+ * \brief Remote end of one socket
+ */
+typedef struct {
+	uint8 Connecting;
+	uint64_t ConnectAt;
+	uint8 ConnectIp[4];
+	uint16 ConnectPort;
+	uint8 Sending;
+	uint8 Hold;
+	uint64_t SendAt;
+	uint32 Sends;
+	uint8 LastIp[4];
+	uint16 LastPort;
+	uint32 Head;
+	uint32 Count;
+	uint8 Capture[PEER_CAPTURE_SIZE];
+} PEER_SOCKET;
+
+static PEER_SOCKET Peer_Socket[4];
+static uint64_t Peer_RoundTrip = 100000;
+static uint8 Peer_Refused;
+/* ======================================================================== */
+/* Backend functions called by the model */
+/* ------------------------------------------------------------------------ */
+static void Peer_Open( uint8 socket, uint8 protocol, uint16 port )
+{
+	PEER_SOCKET* peer;
+
+	(void)protocol;
+	(void)port;
+	peer = &Peer_Socket[socket];
+	peer->Connecting = 0;
+	peer->Sending = 0;
+	peer->Head = 0;
+	peer->Count = 0;
+}
+/* ------------------------------------------------------------------------ */
+static void Peer_Listen( uint8 socket, uint16 port )
+{
+	(void)socket;
+	(void)port;
+}
+/* ------------------------------------------------------------------------ */
+static void Peer_Connect( uint8 socket, const uint8* ip, uint16 port )
+{
+	PEER_SOCKET* peer;
+
+	peer = &Peer_Socket[socket];
+	peer->Connecting = 1;
+	peer->ConnectAt = W51Sim_Now() + Peer_RoundTrip;
+	memcpy(peer->ConnectIp, ip, 4);
+	peer->ConnectPort = port;
+}
+/* ------------------------------------------------------------------------ */
+static void Peer_Send( uint8 socket, const uint8* data, uint16 length, const uint8* ip, uint16 port )
+{
+	PEER_SOCKET* peer;
+	uint16 index;
+
+	peer = &Peer_Socket[socket];
+	++peer->Sends;
+	memcpy(peer->LastIp, ip, 4);
+	peer->LastPort = port;
+	for(index=0;(index<length) && (peer->Count < PEER_CAPTURE_SIZE);++index) {
+		peer->Capture[(peer->Head + peer->Count) % PEER_CAPTURE_SIZE] = data[index];
+		++peer->Count;
+	}
+	peer->Sending = 1;
+	peer->SendAt = W51Sim_Now() + PEER_SEND_NS + ((uint64_t)length * PEER_BYTE_NS);
+}
+/* ------------------------------------------------------------------------ */
+static void Peer_Discon( uint8 socket )
+{
+	Peer_Socket[socket].Connecting = 0;
+	Peer_Socket[socket].Sending = 0;
+}
+/* ------------------------------------------------------------------------ */
+static void Peer_CloseSocket( uint8 socket )
+{
+	Peer_Socket[socket].Connecting = 0;
+	Peer_Socket[socket].Sending = 0;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Complete the connections and SENDs which are due
+ */
+static void Peer_Poll( uint64_t elapsed )
+{
+	PEER_SOCKET* peer;
+	uint64_t now;
+	uint8 socket;
+
+	(void)elapsed;
+	now = W51Sim_Now();
+	for(socket=0;socket<4;++socket) {
+		peer = &Peer_Socket[socket];
+		if ( (peer->Connecting != 0) && (now >= peer->ConnectAt) ) {
+			peer->Connecting = 0;
+			if (Peer_Refused != 0) {
+				W51Sim_Timeout(socket);
+			}
+			else {
+				W51Sim_Established(socket, peer->ConnectIp, peer->ConnectPort);
+			}
+		}
+		if ( (peer->Sending != 0) && (peer->Hold == 0) && (now >= peer->SendAt) ) {
+			peer->Sending = 0;
+			W51Sim_SendDone(socket);
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+static const W51SIM_NET Peer_Net = {
+	Peer_Open,
+	Peer_Listen,
+	Peer_Connect,
+	Peer_Send,
+	Peer_Discon,
+	Peer_CloseSocket,
+	Peer_Poll
+};
+/* ======================================================================== */
+/* Test interface */
+/* ------------------------------------------------------------------------ */
+const W51SIM_NET* Peer_Init( void )
+{
+	memset(Peer_Socket, 0, sizeof(Peer_Socket));
+	Peer_RoundTrip = 100000;
+	Peer_Refused = 0;
+	return( &Peer_Net );
+}
+/* ------------------------------------------------------------------------ */
+void Peer_SetRoundTrip( uint64_t ns )
+{
+	Peer_RoundTrip = ns;
+}
+/* ------------------------------------------------------------------------ */
+void Peer_Refuse( uint8 refuse )
+{
+	Peer_Refused = refuse;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Hold the SEND of a socket in progress, as when the window is closed
+ */
+void Peer_HoldSend( uint8 socket, uint8 hold )
+{
+	Peer_Socket[socket].Hold = hold;
+}
+/* ------------------------------------------------------------------------ */
+uint8 Peer_Accept( uint8 socket, const uint8* ip, uint16 port )
+{
+	if (W51Sim_Status(socket) != W51SIM_SOCK_LISTEN) {
+		return( 0 );
+	}
+	W51Sim_Established(socket, ip, port);
+	return( 1 );
+}
+/* ------------------------------------------------------------------------ */
+uint16 Peer_Write( uint8 socket, const uint8* data, uint16 length )
+{
+	return( W51Sim_Deliver(socket, data, length) );
+}
+/* ------------------------------------------------------------------------ */
+uint16 Peer_WriteUdp( uint8 socket, const uint8* ip, uint16 port, const uint8* data, uint16 length )
+{
+	return( W51Sim_DeliverUdp(socket, ip, port, data, length) );
+}
+/* ------------------------------------------------------------------------ */
+void Peer_Close( uint8 socket )
+{
+	W51Sim_RemoteClosed(socket);
+}
+/* ------------------------------------------------------------------------ */
+void Peer_Reset( uint8 socket )
+{
+	W51Sim_RemoteReset(socket);
+}
+/* ------------------------------------------------------------------------ */
+uint32 Peer_Pending( uint8 socket )
+{
+	return( Peer_Socket[socket].Count );
+}
+/* ------------------------------------------------------------------------ */
+uint32 Peer_Read( uint8 socket, uint8* buffer, uint32 length )
+{
+	PEER_SOCKET* peer;
+	uint32 index;
+
+	peer = &Peer_Socket[socket];
+	length = (length > peer->Count) ? peer->Count : length;
+	for(index=0;index<length;++index) {
+		buffer[index] = peer->Capture[peer->Head];
+		peer->Head = (peer->Head + 1) % PEER_CAPTURE_SIZE;
+	}
+	peer->Count -= length;
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+uint32 Peer_Sends( uint8 socket )
+{
+	return( Peer_Socket[socket].Sends );
+}
+/* ------------------------------------------------------------------------ */
+void Peer_LastDestination( uint8 socket, uint8* ip, uint16* port )
+{
+	memcpy(ip, Peer_Socket[socket].LastIp, 4);
+	*port = Peer_Socket[socket].LastPort;
+}
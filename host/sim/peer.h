@@ -0,0 +1,31 @@
+/**
+ * \file In-memory network peer for the W5100 host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The peer is the remote end of all four sockets.  It accepts connections
+ * after a round trip, captures the data sent by the device, and lets the
+ * tests connect to listening sockets, send data and datagrams, and close
+ * connections.  A SEND completes after the frame time on a 10 Mbit/s link.
+ */
+#if !defined(PEER_H)
+#define PEER_H
+
+#include "w51sim.h"
+
+const W51SIM_NET* Peer_Init( void );
+void Peer_SetRoundTrip( uint64_t ns );
+void Peer_Refuse( uint8 refuse );
+void Peer_HoldSend( uint8 socket, uint8 hold );
+
+uint8 Peer_Accept( uint8 socket, const uint8* ip, uint16 port );
+uint16 Peer_Write( uint8 socket, const uint8* data, uint16 length );
+uint16 Peer_WriteUdp( uint8 socket, const uint8* ip, uint16 port, const uint8* data, uint16 length );
+void Peer_Close( uint8 socket );
+void Peer_Reset( uint8 socket );
+
+uint32 Peer_Pending( uint8 socket );
+uint32 Peer_Read( uint8 socket, uint8* buffer, uint32 length );
+uint32 Peer_Sends( uint8 socket );
+void Peer_LastDestination( uint8 socket, uint8* ip, uint16* port );
+
+#endif
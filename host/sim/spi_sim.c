@@ -0,0 +1,294 @@
+/**
+ * \file Host mocks of the PSoC SPIM and SCB SPI master APIs
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * Both masters share one shifter model.  A byte written to an idle master
+ * asserts the chip select and starts shifting at once, each byte takes 8 SPI
+ * clocks, the next byte in the Tx FIFO follows without a gap, and the chip
+ * select is released when a byte completes with the Tx FIFO empty.  Every
+ * call through the API costs the processor time of a peripheral access, so
+ * that polling loops advance the simulated time.
+ */
+#include <SPIM.h>
+#include <SPI.h>
+#include <SPI_SPI_UART.h>
+#include <SPI_ss1_m.h>
+#include "w51sim.h"
+
+/* processor time of a call to the SPI API */
+#define SPISIM_CPU_NS            ( 250 )
+#define SPISIM_FIFO_MAX          ( 8 )
+
+uint8 SPIM_initVar;
+uint8 SPI_initVar;
+
+static uint8 SpiSim_TxFifo[SPISIM_FIFO_MAX];
+static uint8 SpiSim_TxHead;
+static uint8 SpiSim_TxCount;
+static uint8 SpiSim_RxFifo[SPISIM_FIFO_MAX];
+static uint8 SpiSim_RxHead;
+static uint8 SpiSim_RxCount;
+static uint8 SpiSim_Depth = 4;
+static uint8 SpiSim_Shifting;
+static uint8 SpiSim_ShiftData;
+static uint64_t SpiSim_ShiftEnd;
+static uint8 SpiSim_Selected;
+static uint8 SpiSim_Done;
+/* ======================================================================== */
+/* Shifter */
+/* ------------------------------------------------------------------------ */
+static uint64_t SpiSim_ByteTime( void )
+{
+	return( 8000000ull / W51Sim_GetSpiClock() );
+}
+/* ------------------------------------------------------------------------ */
+static uint8 SpiSim_TxPop( void )
+{
+	uint8 dat;
+
+	dat = SpiSim_TxFifo[SpiSim_TxHead];
+	SpiSim_TxHead = (SpiSim_TxHead + 1) % SPISIM_FIFO_MAX;
+	--SpiSim_TxCount;
+	return( dat );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Complete the bytes which have finished shifting by the current time
+ */
+void SpiSim_Run( void )
+{
+	uint8 miso;
+
+	while ( (SpiSim_Shifting != 0) && (SpiSim_ShiftEnd <= W51Sim_Now()) ) {
+		miso = W51Sim_Shift(SpiSim_ShiftData);
+		if (SpiSim_RxCount < SpiSim_Depth) {
+			SpiSim_RxFifo[(SpiSim_RxHead + SpiSim_RxCount) % SPISIM_FIFO_MAX] = miso;
+			++SpiSim_RxCount;
+		}
+		else {
+			W51Sim_Overrun();
+		}
+		if (SpiSim_TxCount != 0) {
+			SpiSim_ShiftData = SpiSim_TxPop();
+			SpiSim_ShiftEnd += SpiSim_ByteTime();
+		}
+		else {
+			SpiSim_Shifting = 0;
+			SpiSim_Selected = 0;
+			SpiSim_Done = 1;
+			W51Sim_Select(0);
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Time until the bytes in the shifter and the Tx FIFO are shifted out
+ */
+uint64_t SpiSim_Remaining( void )
+{
+	if (SpiSim_Shifting == 0) {
+		return( 0 );
+	}
+	return( (SpiSim_ShiftEnd - W51Sim_Now()) + (SpiSim_TxCount * SpiSim_ByteTime()) );
+}
+/* ------------------------------------------------------------------------ */
+static void SpiSim_Access( void )
+{
+	W51Sim_Advance(SPISIM_CPU_NS);
+}
+/* ------------------------------------------------------------------------ */
+static void SpiSim_Put( uint8 dat )
+{
+	SpiSim_Access();
+	/* a full Tx FIFO blocks the writer until the current byte is done */
+	while (SpiSim_TxCount >= SpiSim_Depth) {
+		W51Sim_Advance(SpiSim_ShiftEnd - W51Sim_Now());
+	}
+	SpiSim_TxFifo[(SpiSim_TxHead + SpiSim_TxCount) % SPISIM_FIFO_MAX] = dat;
+	++SpiSim_TxCount;
+	if (SpiSim_Shifting == 0) {
+		if (SpiSim_Selected == 0) {
+			SpiSim_Selected = 1;
+			W51Sim_Select(1);
+		}
+		SpiSim_ShiftData = SpiSim_TxPop();
+		SpiSim_ShiftEnd = W51Sim_Now() + SpiSim_ByteTime();
+		SpiSim_Shifting = 1;
+	}
+}
+/* ------------------------------------------------------------------------ */
+static uint8 SpiSim_Get( void )
+{
+	uint8 dat;
+
+	SpiSim_Access();
+	dat = 0;
+	if (SpiSim_RxCount != 0) {
+		dat = SpiSim_RxFifo[SpiSim_RxHead];
+		SpiSim_RxHead = (SpiSim_RxHead + 1) % SPISIM_FIFO_MAX;
+		--SpiSim_RxCount;
+	}
+	return( dat );
+}
+/* ------------------------------------------------------------------------ */
+static void SpiSim_Start( uint8 depth )
+{
+	SpiSim_Depth = depth;
+	SpiSim_TxCount = 0;
+	SpiSim_RxCount = 0;
+	SpiSim_Shifting = 0;
+	SpiSim_Selected = 0;
+	SpiSim_Done = 0;
+}
+/* ======================================================================== */
+/* SPIM (UDB SPI Master) */
+/* ------------------------------------------------------------------------ */
+void SPIM_Start( void )
+{
+	SpiSim_Start(SPIM_FIFO_SIZE);
+	SPIM_initVar = 1;
+}
+/* ------------------------------------------------------------------------ */
+void SPIM_Stop( void )
+{
+}
+/* ------------------------------------------------------------------------ */
+uint8 SPIM_ReadTxStatus( void )
+{
+	uint8 status;
+
+	SpiSim_Access();
+	status = (SpiSim_Done != 0) ? SPIM_STS_SPI_DONE : 0;
+	status |= (SpiSim_TxCount == 0) ? SPIM_STS_TX_FIFO_EMPTY : 0;
+	status |= (SpiSim_TxCount < SpiSim_Depth) ? SPIM_STS_TX_FIFO_NOT_FULL : 0;
+	status |= (SpiSim_Shifting == 0) ? SPIM_STS_SPI_IDLE : 0;
+	/* the done flag is cleared by reading the status */
+	SpiSim_Done = 0;
+	return( status );
+}
+/* ------------------------------------------------------------------------ */
+uint8 SPIM_ReadRxStatus( void )
+{
+	uint8 status;
+
+	SpiSim_Access();
+	status = (SpiSim_RxCount != 0) ? SPIM_STS_RX_FIFO_NOT_EMPTY : 0;
+	status |= (SpiSim_RxCount >= SpiSim_Depth) ? SPIM_STS_RX_FIFO_FULL : 0;
+	return( status );
+}
+/* ------------------------------------------------------------------------ */
+void SPIM_WriteTxData( uint8 txData )
+{
+	SpiSim_Put(txData);
+}
+/* ------------------------------------------------------------------------ */
+uint8 SPIM_ReadRxData( void )
+{
+	return( SpiSim_Get() );
+}
+/* ------------------------------------------------------------------------ */
+uint8 SPIM_GetRxBufferSize( void )
+{
+	SpiSim_Access();
+	return( SpiSim_RxCount );
+}
+/* ------------------------------------------------------------------------ */
+uint8 SPIM_GetTxBufferSize( void )
+{
+	SpiSim_Access();
+	return( SpiSim_TxCount );
+}
+/* ------------------------------------------------------------------------ */
+void SPIM_ClearRxBuffer( void )
+{
+	SpiSim_Access();
+	SpiSim_RxCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+void SPIM_ClearTxBuffer( void )
+{
+	SpiSim_Access();
+	SpiSim_TxCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+void SPIM_ClearFIFO( void )
+{
+	SpiSim_Access();
+	SpiSim_TxCount = 0;
+	SpiSim_RxCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+/* The interrupt outputs are not modeled */
+void SPIM_SetTxInterruptMode( uint8 intSrc ) { (void)intSrc; }
+void SPIM_SetRxInterruptMode( uint8 intSrc ) { (void)intSrc; }
+void SPIM_EnableTxInt( void ) { }
+void SPIM_EnableRxInt( void ) { }
+void SPIM_DisableTxInt( void ) { }
+void SPIM_DisableRxInt( void ) { }
+/* ======================================================================== */
+/* SCB in SPI master mode */
+/* ------------------------------------------------------------------------ */
+void SPI_Start( void )
+{
+	SpiSim_Start(SPI_FIFO_SIZE);
+	SPI_initVar = 1;
+}
+/* ------------------------------------------------------------------------ */
+void SPI_Stop( void )
+{
+}
+/* ------------------------------------------------------------------------ */
+void SPI_SpiSetActiveSlaveSelect( uint32 slaveSelect )
+{
+	(void)slaveSelect;
+	SpiSim_Access();
+}
+/* ------------------------------------------------------------------------ */
+uint32 SPI_SpiIsBusBusy( void )
+{
+	SpiSim_Access();
+	return( SpiSim_Shifting );
+}
+/* ------------------------------------------------------------------------ */
+void SPI_SpiUartWriteTxData( uint32 txData )
+{
+	SpiSim_Put(txData&0xFF);
+}
+/* ------------------------------------------------------------------------ */
+uint32 SPI_SpiUartReadRxData( void )
+{
+	return( SpiSim_Get() );
+}
+/* ------------------------------------------------------------------------ */
+uint32 SPI_SpiUartGetRxBufferSize( void )
+{
+	SpiSim_Access();
+	return( SpiSim_RxCount );
+}
+/* ------------------------------------------------------------------------ */
+uint32 SPI_SpiUartGetTxBufferSize( void )
+{
+	SpiSim_Access();
+	return( SpiSim_TxCount );
+}
+/* ------------------------------------------------------------------------ */
+void SPI_SpiUartClearRxBuffer( void )
+{
+	SpiSim_Access();
+	SpiSim_RxCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+void SPI_SpiUartClearTxBuffer( void )
+{
+	SpiSim_Access();
+	SpiSim_TxCount = 0;
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read the slave select pin, which is high while the bus is idle
+ */
+uint8 SPI_ss1_m_Read( void )
+{
+	SpiSim_Access();
+	return( (SpiSim_Selected == 0) ? 1 : 0 );
+}
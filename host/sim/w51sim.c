@@ -0,0 +1,651 @@
+/**
+ * \file Host model of the W5100 register file, buffer memory and sockets
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The device is modeled at the SPI frame level.  Each frame is the opcode,
+ * the address and a data byte, latched on the fourth byte, and the chip
+ * select must be released after every frame (the W5100 has no burst mode).
+ * Frames which hold the chip select for more or fewer than four bytes are
+ * counted as frame errors and are not executed.
+ *
+ * Socket commands complete immediately, except for SEND, which is handed
+ * to the network backend and completes when the backend reports that the
+ * data has been sent.  Writes to Tx memory which hold data that has not been
+ * sent yet, and writes to the destination of a SEND in progress, are counted
+ * as hazards, since on the device they corrupt the data on the wire.
+ */
+#include <string.h>
+#include "w51sim.h"
+
+#define W51SIM_WRITE_OP          ( 0xF0 )
+#define W51SIM_READ_OP           ( 0x0F )
+
+/* Common registers */
+#define W51SIM_MR                ( 0x0000 )
+#define W51SIM_IR                ( 0x0015 )
+#define W51SIM_RTR               ( 0x0017 )
+#define W51SIM_RCR               ( 0x0019 )
+#define W51SIM_RMSR              ( 0x001A )
+#define W51SIM_TMSR              ( 0x001B )
+
+/* Socket registers, offset from the socket base */
+#define W51SIM_SOCKET_BASE(s)    ( 0x0400 + ((s)<<8) )
+#define W51SIM_Sn_MR             ( 0x00 )
+#define W51SIM_Sn_CR             ( 0x01 )
+#define W51SIM_Sn_IR             ( 0x02 )
+#define W51SIM_Sn_SR             ( 0x03 )
+#define W51SIM_Sn_PORT           ( 0x04 )
+#define W51SIM_Sn_DHAR           ( 0x06 )
+#define W51SIM_Sn_DIPR           ( 0x0C )
+#define W51SIM_Sn_DPORT          ( 0x10 )
+#define W51SIM_Sn_TTL            ( 0x16 )
+#define W51SIM_Sn_TX_FSR         ( 0x20 )
+#define W51SIM_Sn_TX_RD          ( 0x22 )
+#define W51SIM_Sn_TX_WR          ( 0x24 )
+#define W51SIM_Sn_RX_RSR         ( 0x26 )
+#define W51SIM_Sn_RX_RD          ( 0x28 )
+
+/* Buffer memory */
+#define W51SIM_TX_BASE           ( 0x4000 )
+#define W51SIM_RX_BASE           ( 0x6000 )
+#define W51SIM_MEM_SIZE          ( 0x2000 )
+
+/**
+ * \brief Device state of a socket which is not visible in the register file
+ */
+typedef struct {
+	uint16 RxWrite;   /**< pointer at which the next received byte is stored */
+	uint16 RxRead;    /**< read pointer latched by the last RECV command */
+	uint16 SendEnd;   /**< write pointer latched by the SEND in progress */
+	uint8 Sending;    /**< a SEND is in progress */
+} W51SIM_SOCKET;
+
+static uint8 W51Sim_Mem[0x8000];
+static W51SIM_SOCKET W51Sim_Socket[4];
+static const W51SIM_NET* W51Sim_Net;
+static W51SIM_STATS W51Sim_Stats;
+static uint64_t W51Sim_Time;
+static uint64_t W51Sim_Deadline;
+static jmp_buf* W51Sim_Escape;
+static uint32 W51Sim_SpiKhz = 4000;
+static uint8 W51Sim_Frame[4];
+static uint8 W51Sim_FrameIndex;
+static uint8 W51Sim_SendBuffer[W51SIM_MEM_SIZE];
+/* ======================================================================== */
+/* Register file */
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_Get16( uint16 addr )
+{
+	return( ((uint16)W51Sim_Mem[addr]<<8) | W51Sim_Mem[addr+1] );
+}
+/* ------------------------------------------------------------------------ */
+static void W51Sim_Set16( uint16 addr, uint16 val )
+{
+	W51Sim_Mem[addr] = val>>8;
+	W51Sim_Mem[addr+1] = val&0x00FF;
+}
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_SocketReg( uint8 socket, uint8 reg )
+{
+	return( W51SIM_SOCKET_BASE(socket) + reg );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Calculate the buffer base and size of a socket from a size register
+ *
+ * Sockets which do not fit in the 8K of buffer memory are given no memory.
+ */
+static void W51Sim_Layout( uint8 msr, uint8 socket, uint16* base, uint16* size )
+{
+	uint16 total;
+	uint16 length;
+	uint8 index;
+
+	total = 0;
+	for(index=0;index<=socket;++index) {
+		length = 0x0400 << ((msr>>(index<<1))&0x03);
+		*base = total;
+		*size = ((total+length) > W51SIM_MEM_SIZE) ? 0 : length;
+		total += length;
+	}
+}
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_TxSize( uint8 socket )
+{
+	uint16 base;
+	uint16 size;
+
+	W51Sim_Layout(W51Sim_Mem[W51SIM_TMSR], socket, &base, &size);
+	return( size );
+}
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_RxSize( uint8 socket )
+{
+	uint16 base;
+	uint16 size;
+
+	W51Sim_Layout(W51Sim_Mem[W51SIM_RMSR], socket, &base, &size);
+	return( size );
+}
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_TxUsed( uint8 socket )
+{
+	return( W51Sim_Get16(W51Sim_SocketReg(socket,W51SIM_Sn_TX_WR)) - W51Sim_Get16(W51Sim_SocketReg(socket,W51SIM_Sn_TX_RD)) );
+}
+/* ------------------------------------------------------------------------ */
+static uint16 W51Sim_RxUsed( uint8 socket )
+{
+	return( W51Sim_Socket[socket].RxWrite - W51Sim_Socket[socket].RxRead );
+}
+/* ------------------------------------------------------------------------ */
+static void W51Sim_Reset( void )
+{
+	uint8 socket;
+
+	memset(W51Sim_Mem, 0, sizeof(W51Sim_Mem));
+	memset(W51Sim_Socket, 0, sizeof(W51Sim_Socket));
+	W51Sim_Set16(W51SIM_RTR, 0x07D0);
+	W51Sim_Mem[W51SIM_RCR] = 0x08;
+	W51Sim_Mem[W51SIM_RMSR] = 0x55;
+	W51Sim_Mem[W51SIM_TMSR] = 0x55;
+	for(socket=0;socket<4;++socket) {
+		W51Sim_Mem[W51Sim_SocketReg(socket,W51SIM_Sn_TTL)] = 0x80;
+		if (W51Sim_Net != NULL) {
+			W51Sim_Net->Close(socket);
+		}
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Read a register or buffer memory location
+ *
+ * The free and received size registers and the interrupt register are
+ * calculated from the socket state, and the command register reads as 0
+ * since every command is accepted immediately.
+ */
+static uint8 W51Sim_Read( uint16 addr )
+{
+	uint8 socket;
+	uint8 reg;
+	uint16 val;
+	uint8 result;
+
+	if (addr >= 0x8000) {
+		return( 0 );
+	}
+	if (addr == W51SIM_IR) {
+		result = W51Sim_Mem[W51SIM_IR] & 0xF0;
+		for(socket=0;socket<4;++socket) {
+			if (W51Sim_Mem[W51Sim_SocketReg(socket,W51SIM_Sn_IR)] != 0) {
+				result |= 1<<socket;
+			}
+		}
+		return( result );
+	}
+	if ( (addr >= 0x0400) && (addr < 0x0800) ) {
+		socket = (addr>>8) - 4;
+		reg = addr&0xFF;
+		switch(reg) {
+			case W51SIM_Sn_CR:
+				return( 0 );
+			case W51SIM_Sn_TX_FSR:
+			case W51SIM_Sn_TX_FSR+1:
+				val = W51Sim_TxSize(socket) - W51Sim_TxUsed(socket);
+				return( (reg == W51SIM_Sn_TX_FSR) ? (val>>8) : (val&0x00FF) );
+			case W51SIM_Sn_RX_RSR:
+			case W51SIM_Sn_RX_RSR+1:
+				val = W51Sim_RxUsed(socket);
+				return( (reg == W51SIM_Sn_RX_RSR) ? (val>>8) : (val&0x00FF) );
+			default:
+				break;
+		}
+	}
+	return( W51Sim_Mem[addr] );
+}
+/* ======================================================================== */
+/* Socket commands */
+/* ------------------------------------------------------------------------ */
+static uint8 W51Sim_CanSend( uint8 status )
+{
+	return( (status == W51SIM_SOCK_ESTABLISHED) || (status == W51SIM_SOCK_CLOSE_WAIT) ||
+		(status == W51SIM_SOCK_UDP) || (status == W51SIM_SOCK_IPRAW) || (status == W51SIM_SOCK_MACRAW) );
+}
+/* ------------------------------------------------------------------------ */
+static void W51Sim_Send( uint8 socket )
+{
+	W51SIM_SOCKET* state;
+	uint16 base;
+	uint16 size;
+	uint16 length;
+	uint16 ptr;
+	uint16 index;
+	uint16 sr;
+
+	state = &W51Sim_Socket[socket];
+	sr = W51Sim_SocketReg(socket,0);
+	if ( (W51Sim_CanSend(W51Sim_Mem[sr+W51SIM_Sn_SR]) == 0) || (state->Sending != 0) ) {
+		/* the device ignores the command */
+		++W51Sim_Stats.Hazards;
+		return;
+	}
+	W51Sim_Layout(W51Sim_Mem[W51SIM_TMSR], socket, &base, &size);
+	length = W51Sim_TxUsed(socket);
+	if ( (size == 0) || (length > size) ) {
+		++W51Sim_Stats.Hazards;
+		return;
+	}
+	ptr = W51Sim_Get16(sr+W51SIM_Sn_TX_RD);
+	for(index=0;index<length;++index) {
+		W51Sim_SendBuffer[index] = W51Sim_Mem[W51SIM_TX_BASE + base + ((ptr+index)&(size-1))];
+	}
+	state->Sending = 1;
+	state->SendEnd = W51Sim_Get16(sr+W51SIM_Sn_TX_WR);
+	W51Sim_Net->Send(socket, W51Sim_SendBuffer, length, &W51Sim_Mem[sr+W51SIM_Sn_DIPR], W51Sim_Get16(sr+W51SIM_Sn_DPORT));
+}
+/* ------------------------------------------------------------------------ */
+static void W51Sim_Command( uint8 socket, uint8 cmd )
+{
+	W51SIM_SOCKET* state;
+	uint16 sr;
+	uint8 status;
+
+	++W51Sim_Stats.Commands;
+	state = &W51Sim_Socket[socket];
+	sr = W51Sim_SocketReg(socket,0);
+	status = W51Sim_Mem[sr+W51SIM_Sn_SR];
+	switch(cmd) {
+		case W51SIM_CMD_OPEN:
+			W51Sim_Net->Close(socket);
+			memset(state, 0, sizeof(W51SIM_SOCKET));
+			W51Sim_Set16(sr+W51SIM_Sn_TX_RD, 0);
+			W51Sim_Set16(sr+W51SIM_Sn_TX_WR, 0);
+			W51Sim_Set16(sr+W51SIM_Sn_RX_RD, 0);
+			switch(W51Sim_Mem[sr+W51SIM_Sn_MR]&0x0F) {
+				case W51SIM_PROTO_TCP:
+					status = W51SIM_SOCK_INIT;
+					break;
+				case W51SIM_PROTO_UDP:
+					status = W51SIM_SOCK_UDP;
+					break;
+				case 3:
+					status = W51SIM_SOCK_IPRAW;
+					break;
+				case 4:
+					status = (socket == 0) ? W51SIM_SOCK_MACRAW : W51SIM_SOCK_CLOSED;
+					break;
+				default:
+					status = W51SIM_SOCK_CLOSED;
+					break;
+			}
+			W51Sim_Mem[sr+W51SIM_Sn_SR] = status;
+			if (status != W51SIM_SOCK_CLOSED) {
+				W51Sim_Net->Open(socket, W51Sim_Mem[sr+W51SIM_Sn_MR]&0x0F, W51Sim_Get16(sr+W51SIM_Sn_PORT));
+			}
+			break;
+		case W51SIM_CMD_LISTEN:
+			if (status == W51SIM_SOCK_INIT) {
+				W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_LISTEN;
+				W51Sim_Net->Listen(socket, W51Sim_Get16(sr+W51SIM_Sn_PORT));
+			}
+			break;
+		case W51SIM_CMD_CONNECT:
+			if (status == W51SIM_SOCK_INIT) {
+				W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_SYNSENT;
+				W51Sim_Net->Connect(socket, &W51Sim_Mem[sr+W51SIM_Sn_DIPR], W51Sim_Get16(sr+W51SIM_Sn_DPORT));
+			}
+			break;
+		case W51SIM_CMD_DISCON:
+			if ( (status == W51SIM_SOCK_ESTABLISHED) || (status == W51SIM_SOCK_CLOSE_WAIT) ||
+				(status == W51SIM_SOCK_SYNSENT) || (status == W51SIM_SOCK_LISTEN) ) {
+				/* the FIN handshake is not modeled, the socket closes at once */
+				W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_CLOSED;
+				W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_DISCON;
+				state->Sending = 0;
+				W51Sim_Net->Discon(socket);
+			}
+			break;
+		case W51SIM_CMD_CLOSE:
+			W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_CLOSED;
+			state->Sending = 0;
+			W51Sim_Net->Close(socket);
+			break;
+		case W51SIM_CMD_SEND:
+		case W51SIM_CMD_SEND_MAC:
+			W51Sim_Send(socket);
+			break;
+		case W51SIM_CMD_SEND_KEEP:
+			break;
+		case W51SIM_CMD_RECV:
+			state->RxRead = W51Sim_Get16(sr+W51SIM_Sn_RX_RD);
+			break;
+		default:
+			break;
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Write a register or buffer memory location
+ */
+static void W51Sim_Write( uint16 addr, uint8 dat )
+{
+	uint8 socket;
+	uint8 reg;
+	uint16 base;
+	uint16 size;
+	uint16 offset;
+	uint16 start;
+
+	if (addr >= 0x8000) {
+		return;
+	}
+	if (addr == W51SIM_MR) {
+		if ( (dat&0x80) != 0) {
+			W51Sim_Reset();
+		}
+		else {
+			W51Sim_Mem[W51SIM_MR] = dat;
+		}
+		return;
+	}
+	if (addr == W51SIM_IR) {
+		W51Sim_Mem[W51SIM_IR] &= ~(dat&0xF0);
+		return;
+	}
+	if ( (addr >= 0x0400) && (addr < 0x0800) ) {
+		socket = (addr>>8) - 4;
+		reg = addr&0xFF;
+		switch(reg) {
+			case W51SIM_Sn_CR:
+				W51Sim_Command(socket, dat);
+				return;
+			case W51SIM_Sn_IR:
+				W51Sim_Mem[addr] &= ~dat;
+				return;
+			case W51SIM_Sn_SR:
+			case W51SIM_Sn_TX_FSR:
+			case W51SIM_Sn_TX_FSR+1:
+			case W51SIM_Sn_TX_RD:
+			case W51SIM_Sn_TX_RD+1:
+			case W51SIM_Sn_RX_RSR:
+			case W51SIM_Sn_RX_RSR+1:
+				/* read only */
+				return;
+			default:
+				if ( (reg >= W51SIM_Sn_DHAR) && (reg < W51SIM_Sn_DPORT+2) && (W51Sim_Socket[socket].Sending != 0) ) {
+					/* the destination of the SEND in progress is being changed */
+					++W51Sim_Stats.Hazards;
+				}
+				break;
+		}
+	}
+	else if ( (addr >= W51SIM_TX_BASE) && (addr < W51SIM_RX_BASE) ) {
+		offset = addr - W51SIM_TX_BASE;
+		for(socket=0;socket<4;++socket) {
+			W51Sim_Layout(W51Sim_Mem[W51SIM_TMSR], socket, &base, &size);
+			if ( (size != 0) && (offset >= base) && (offset < (base+size)) ) {
+				start = W51Sim_Get16(W51Sim_SocketReg(socket,W51SIM_Sn_TX_RD)) & (size-1);
+				if ( (((offset - base) - start) & (size-1)) < W51Sim_TxUsed(socket) ) {
+					/* the data between the read and write pointers has not been sent */
+					++W51Sim_Stats.Hazards;
+				}
+			}
+		}
+	}
+	W51Sim_Mem[addr] = dat;
+}
+/* ======================================================================== */
+/* SPI frame protocol */
+/* ------------------------------------------------------------------------ */
+void W51Sim_Select( uint8 asserted )
+{
+	if ( (asserted == 0) && (W51Sim_FrameIndex != 0) && (W51Sim_FrameIndex < 4) ) {
+		/* the frame was cut short, and is discarded */
+		++W51Sim_Stats.FrameErrors;
+	}
+	W51Sim_FrameIndex = 0;
+}
+/* ------------------------------------------------------------------------ */
+uint8 W51Sim_Shift( uint8 mosi )
+{
+	uint16 addr;
+	uint8 miso;
+
+	++W51Sim_Stats.Bytes;
+	if (W51Sim_FrameIndex >= 4) {
+		/* the chip select was not released at the end of the frame */
+		if (W51Sim_FrameIndex == 4) {
+			++W51Sim_Stats.FrameErrors;
+			W51Sim_FrameIndex = 5;
+		}
+		return( 0 );
+	}
+	W51Sim_Frame[W51Sim_FrameIndex] = mosi;
+	miso = W51Sim_FrameIndex;
+	if (W51Sim_FrameIndex == 3) {
+		addr = ((uint16)W51Sim_Frame[1]<<8) | W51Sim_Frame[2];
+		if (W51Sim_Frame[0] == W51SIM_WRITE_OP) {
+			++W51Sim_Stats.WriteFrames;
+			W51Sim_Write(addr, mosi);
+		}
+		else if (W51Sim_Frame[0] == W51SIM_READ_OP) {
+			++W51Sim_Stats.ReadFrames;
+			miso = W51Sim_Read(addr);
+		}
+		else {
+			++W51Sim_Stats.FrameErrors;
+		}
+	}
+	++W51Sim_FrameIndex;
+
+	return( miso );
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_Overrun( void )
+{
+	++W51Sim_Stats.Overruns;
+}
+/* ======================================================================== */
+/* Network backend interface */
+/* ------------------------------------------------------------------------ */
+uint8 W51Sim_Status( uint8 socket )
+{
+	return( W51Sim_Mem[W51Sim_SocketReg(socket,W51SIM_Sn_SR)] );
+}
+/* ------------------------------------------------------------------------ */
+uint16 W51Sim_RxFree( uint8 socket )
+{
+	return( W51Sim_RxSize(socket) - W51Sim_RxUsed(socket) );
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_Established( uint8 socket, const uint8* ip, uint16 port )
+{
+	uint16 sr;
+	uint8 status;
+
+	sr = W51Sim_SocketReg(socket,0);
+	status = W51Sim_Mem[sr+W51SIM_Sn_SR];
+	if ( (status == W51SIM_SOCK_LISTEN) || (status == W51SIM_SOCK_SYNSENT) ) {
+		memcpy(&W51Sim_Mem[sr+W51SIM_Sn_DIPR], ip, 4);
+		W51Sim_Set16(sr+W51SIM_Sn_DPORT, port);
+		W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_ESTABLISHED;
+		W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_CON;
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Store received bytes in the Rx buffer of a socket
+ */
+static void W51Sim_Store( uint8 socket, const uint8* data, uint16 length )
+{
+	W51SIM_SOCKET* state;
+	uint16 base;
+	uint16 size;
+	uint16 index;
+
+	state = &W51Sim_Socket[socket];
+	W51Sim_Layout(W51Sim_Mem[W51SIM_RMSR], socket, &base, &size);
+	for(index=0;index<length;++index) {
+		W51Sim_Mem[W51SIM_RX_BASE + base + (state->RxWrite&(size-1))] = data[index];
+		++state->RxWrite;
+	}
+}
+/* ------------------------------------------------------------------------ */
+uint16 W51Sim_Deliver( uint8 socket, const uint8* data, uint16 length )
+{
+	uint8 status;
+	uint16 space;
+
+	status = W51Sim_Status(socket);
+	if ( (status != W51SIM_SOCK_ESTABLISHED) && (status != W51SIM_SOCK_CLOSE_WAIT) ) {
+		return( 0 );
+	}
+	space = W51Sim_RxFree(socket);
+	length = (length > space) ? space : length;
+	if (length != 0) {
+		W51Sim_Store(socket, data, length);
+		W51Sim_Mem[W51Sim_SocketReg(socket,W51SIM_Sn_IR)] |= W51SIM_IR_RECV;
+	}
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+uint16 W51Sim_DeliverUdp( uint8 socket, const uint8* ip, uint16 port, const uint8* data, uint16 length )
+{
+	uint8 header[8];
+
+	if ( (W51Sim_Status(socket) != W51SIM_SOCK_UDP) || (W51Sim_RxFree(socket) < (length+8)) ) {
+		/* the datagram is dropped */
+		return( 0 );
+	}
+	memcpy(&header[0], ip, 4);
+	header[4] = port>>8;
+	header[5] = port&0x00FF;
+	header[6] = length>>8;
+	header[7] = length&0x00FF;
+	W51Sim_Store(socket, header, 8);
+	W51Sim_Store(socket, data, length);
+	W51Sim_Mem[W51Sim_SocketReg(socket,W51SIM_Sn_IR)] |= W51SIM_IR_RECV;
+	return( length );
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_RemoteClosed( uint8 socket )
+{
+	uint16 sr;
+
+	sr = W51Sim_SocketReg(socket,0);
+	if (W51Sim_Mem[sr+W51SIM_Sn_SR] == W51SIM_SOCK_ESTABLISHED) {
+		W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_CLOSE_WAIT;
+		W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_DISCON;
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief The remote reset the connection: the socket closes at once, and the
+ * data in its receive buffer is dropped
+ */
+void W51Sim_RemoteReset( uint8 socket )
+{
+	uint16 sr;
+
+	sr = W51Sim_SocketReg(socket,0);
+	W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_CLOSED;
+	W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_DISCON;
+	W51Sim_Socket[socket].RxRead = W51Sim_Socket[socket].RxWrite;
+	W51Sim_Socket[socket].Sending = 0;
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_Timeout( uint8 socket )
+{
+	uint16 sr;
+
+	sr = W51Sim_SocketReg(socket,0);
+	W51Sim_Mem[sr+W51SIM_Sn_SR] = W51SIM_SOCK_CLOSED;
+	W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_TIMEOUT;
+	W51Sim_Socket[socket].Sending = 0;
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_SendDone( uint8 socket )
+{
+	W51SIM_SOCKET* state;
+	uint16 sr;
+
+	state = &W51Sim_Socket[socket];
+	if (state->Sending != 0) {
+		sr = W51Sim_SocketReg(socket,0);
+		state->Sending = 0;
+		W51Sim_Set16(sr+W51SIM_Sn_TX_RD, state->SendEnd);
+		W51Sim_Mem[sr+W51SIM_Sn_IR] |= W51SIM_IR_SEND_OK;
+	}
+}
+/* ======================================================================== */
+/* Model control */
+/* ------------------------------------------------------------------------ */
+void W51Sim_Init( const W51SIM_NET* net )
+{
+	W51Sim_Net = net;
+	W51Sim_Reset();
+	W51Sim_FrameIndex = 0;
+	W51Sim_Escape = NULL;
+	W51Sim_ClearStats();
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_SetSpiClock( uint32 khz )
+{
+	W51Sim_SpiKhz = (khz == 0) ? 1 : khz;
+}
+/* ------------------------------------------------------------------------ */
+uint32 W51Sim_GetSpiClock( void )
+{
+	return( W51Sim_SpiKhz );
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_GetStats( W51SIM_STATS* stats )
+{
+	W51Sim_Advance(SpiSim_Remaining());
+	*stats = W51Sim_Stats;
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_ClearStats( void )
+{
+	memset(&W51Sim_Stats, 0, sizeof(W51Sim_Stats));
+}
+/* ------------------------------------------------------------------------ */
+uint64_t W51Sim_Now( void )
+{
+	return( W51Sim_Time );
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Advance the simulated time
+ *
+ * The SPI shifts the bytes due by the new time, the network backend is
+ * polled, and when a deadline has been set and passed, control returns to
+ * the caller of W51Sim_SetDeadline() through the escape buffer.
+ */
+void W51Sim_Advance( uint64_t ns )
+{
+	jmp_buf* escape;
+
+	W51Sim_Time += ns;
+	SpiSim_Run();
+	if (W51Sim_Net != NULL) {
+		W51Sim_Net->Poll(ns);
+	}
+	if ( (W51Sim_Escape != NULL) && (W51Sim_Time > W51Sim_Deadline) ) {
+		escape = W51Sim_Escape;
+		W51Sim_Escape = NULL;
+		longjmp(*escape, 1);
+	}
+}
+/* ------------------------------------------------------------------------ */
+void W51Sim_SetDeadline( uint64_t ns, jmp_buf* escape )
+{
+	W51Sim_Deadline = W51Sim_Time + ns;
+	W51Sim_Escape = escape;
+}
+/* ------------------------------------------------------------------------ */
+uint8 W51Sim_Peek( uint16 addr )
+{
+	/* let the last frame written by the driver reach the device */
+	W51Sim_Advance(SpiSim_Remaining());
+	return( W51Sim_Read(addr) );
+}
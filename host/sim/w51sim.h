@@ -0,0 +1,118 @@
+/**
+ * \file Host model of the W5100 and the PSoC SPI masters
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * The model executes the W5100 SPI frame protocol, the common and socket
+ * register file, the Tx/Rx buffer memory and the socket commands, so that
+ * the component API can be compiled and run on a Linux host.  Time is
+ * simulated: the SPI master mocks, CyDelay() and CyDelayUs() advance the
+ * clock, and each byte takes 8 SPI clocks on the bus.
+ *
+ * The network side of the sockets is supplied by a backend (W51SIM_NET),
+ * either the in-memory peer used by the tests and the benchmarks, or the
+ * loopback backend which maps the sockets on to real host sockets.
+ */
+#if !defined(W51SIM_H)
+#define W51SIM_H
+
+#include <setjmp.h>
+#include <cytypes.h>
+
+/* Socket commands, status values and interrupt flags of the device */
+#define W51SIM_CMD_OPEN          ( 0x01 )
+#define W51SIM_CMD_LISTEN        ( 0x02 )
+#define W51SIM_CMD_CONNECT       ( 0x04 )
+#define W51SIM_CMD_DISCON        ( 0x08 )
+#define W51SIM_CMD_CLOSE         ( 0x10 )
+#define W51SIM_CMD_SEND          ( 0x20 )
+#define W51SIM_CMD_SEND_MAC      ( 0x21 )
+#define W51SIM_CMD_SEND_KEEP     ( 0x22 )
+#define W51SIM_CMD_RECV          ( 0x40 )
+
+#define W51SIM_SOCK_CLOSED       ( 0x00 )
+#define W51SIM_SOCK_INIT         ( 0x13 )
+#define W51SIM_SOCK_LISTEN       ( 0x14 )
+#define W51SIM_SOCK_SYNSENT      ( 0x15 )
+#define W51SIM_SOCK_ESTABLISHED  ( 0x17 )
+#define W51SIM_SOCK_CLOSE_WAIT   ( 0x1C )
+#define W51SIM_SOCK_UDP          ( 0x22 )
+#define W51SIM_SOCK_IPRAW        ( 0x32 )
+#define W51SIM_SOCK_MACRAW       ( 0x42 )
+
+#define W51SIM_IR_CON            ( 0x01 )
+#define W51SIM_IR_DISCON         ( 0x02 )
+#define W51SIM_IR_RECV           ( 0x04 )
+#define W51SIM_IR_TIMEOUT        ( 0x08 )
+#define W51SIM_IR_SEND_OK        ( 0x10 )
+
+#define W51SIM_PROTO_TCP         ( 1 )
+#define W51SIM_PROTO_UDP         ( 2 )
+
+/**
+ * \brief Bus and protocol counters of the model
+ */
+typedef struct {
+	uint32 ReadFrames;   /**< read frames latched by the device */
+	uint32 WriteFrames;  /**< write frames latched by the device */
+	uint32 Bytes;        /**< bytes shifted on the bus */
+	uint32 FrameErrors;  /**< chip select held for other than 4 bytes */
+	uint32 Commands;     /**< socket commands executed */
+	uint32 Hazards;      /**< writes over unsent data, or over the destination of a SEND in progress */
+	uint32 Overruns;     /**< bytes lost from a full SPI Rx FIFO */
+} W51SIM_STATS;
+
+/**
+ * \brief Network backend of the socket model
+ *
+ * Each function is called after the model has updated the socket registers
+ * for the command.  Send() is handed the data between the Tx read and write
+ * pointers, and the backend calls W51Sim_SendDone() once it has been sent.
+ * Poll() is called as simulated time advances, with the time elapsed since
+ * the last call, to deliver network events.
+ */
+typedef struct {
+	void (*Open)( uint8 socket, uint8 protocol, uint16 port );
+	void (*Listen)( uint8 socket, uint16 port );
+	void (*Connect)( uint8 socket, const uint8* ip, uint16 port );
+	void (*Send)( uint8 socket, const uint8* data, uint16 length, const uint8* ip, uint16 port );
+	void (*Discon)( uint8 socket );
+	void (*Close)( uint8 socket );
+	void (*Poll)( uint64_t elapsed );
+} W51SIM_NET;
+
+/* Model control */
+void W51Sim_Init( const W51SIM_NET* net );
+void W51Sim_SetSpiClock( uint32 khz );
+uint32 W51Sim_GetSpiClock( void );
+void W51Sim_GetStats( W51SIM_STATS* stats );
+void W51Sim_ClearStats( void );
+
+/* Simulated time, in nanoseconds */
+uint64_t W51Sim_Now( void );
+void W51Sim_Advance( uint64_t ns );
+void W51Sim_SetDeadline( uint64_t ns, jmp_buf* escape );
+
+/* SPI bus interface used by the SPI master mocks */
+void W51Sim_Select( uint8 asserted );
+uint8 W51Sim_Shift( uint8 mosi );
+void W51Sim_Overrun( void );
+
+/* Socket interface used by the network backends */
+uint8 W51Sim_Status( uint8 socket );
+uint16 W51Sim_RxFree( uint8 socket );
+void W51Sim_Established( uint8 socket, const uint8* ip, uint16 port );
+uint16 W51Sim_Deliver( uint8 socket, const uint8* data, uint16 length );
+uint16 W51Sim_DeliverUdp( uint8 socket, const uint8* ip, uint16 port, const uint8* data, uint16 length );
+void W51Sim_RemoteClosed( uint8 socket );
+void W51Sim_RemoteReset( uint8 socket );
+void W51Sim_Timeout( uint8 socket );
+void W51Sim_SendDone( uint8 socket );
+
+/* Direct register access for the tests, after the frame on the bus is done */
+uint8 W51Sim_Peek( uint16 addr );
+
+/* SPI master mocks */
+void SpiSim_Run( void );
+uint64_t SpiSim_Remaining( void );
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * \file Host build replacement for the SCB component API in SPI mode
+ */
+#if !defined(CY_SCB_SPI_H)
+#define CY_SCB_SPI_H
+
+#include <cytypes.h>
+
+extern uint8 SPI_initVar;
+
+void SPI_Start( void );
+void SPI_Stop( void );
+
+#define SPI_SPIM_ACTIVE_SS0         ( 0u )
+#define SPI_SPIM_ACTIVE_SS1         ( 1u )
+#define SPI_SPIM_ACTIVE_SS2         ( 2u )
+#define SPI_SPIM_ACTIVE_SS3         ( 3u )
+#define SPI_FIFO_SIZE               ( 8u )
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * \file Host build replacement for the SPIM component API (SPI Master v2.x)
+ */
+#if !defined(CY_SPIM_SPIM_H)
+#define CY_SPIM_SPIM_H
+
+#include <cytypes.h>
+
+extern uint8 SPIM_initVar;
+
+void SPIM_Start( void );
+void SPIM_Stop( void );
+uint8 SPIM_ReadTxStatus( void );
+uint8 SPIM_ReadRxStatus( void );
+void SPIM_WriteTxData( uint8 txData );
+uint8 SPIM_ReadRxData( void );
+uint8 SPIM_GetRxBufferSize( void );
+uint8 SPIM_GetTxBufferSize( void );
+void SPIM_ClearRxBuffer( void );
+void SPIM_ClearTxBuffer( void );
+void SPIM_ClearFIFO( void );
+void SPIM_SetTxInterruptMode( uint8 intSrc );
+void SPIM_SetRxInterruptMode( uint8 intSrc );
+void SPIM_EnableTxInt( void );
+void SPIM_EnableRxInt( void );
+void SPIM_DisableTxInt( void );
+void SPIM_DisableRxInt( void );
+
+#define SPIM_TX_ISR_NUMBER          ( 10u )
+#define SPIM_RX_ISR_NUMBER          ( 11u )
+#define SPIM_FIFO_SIZE              ( 4u )
+
+#define SPIM_STS_SPI_DONE           ( 0x01u )
+#define SPIM_STS_TX_FIFO_EMPTY      ( 0x02u )
+#define SPIM_STS_TX_FIFO_NOT_FULL   ( 0x04u )
+#define SPIM_STS_BYTE_COMPLETE      ( 0x08u )
+#define SPIM_STS_SPI_IDLE           ( 0x10u )
+#define SPIM_STS_RX_FIFO_FULL       ( 0x10u )
+#define SPIM_STS_RX_FIFO_NOT_EMPTY  ( 0x20u )
+#define SPIM_STS_RX_FIFO_OVERRUN    ( 0x40u )
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * \file Host build replacement for the SCB SPI/UART API
+ */
+#if !defined(CY_SCB_SPI_UART_SPI_H)
+#define CY_SCB_SPI_UART_SPI_H
+
+#include <cytypes.h>
+
+void SPI_SpiSetActiveSlaveSelect( uint32 slaveSelect );
+uint32 SPI_SpiIsBusBusy( void );
+void SPI_SpiUartWriteTxData( uint32 txData );
+uint32 SPI_SpiUartReadRxData( void );
+uint32 SPI_SpiUartGetRxBufferSize( void );
+uint32 SPI_SpiUartGetTxBufferSize( void );
+void SPI_SpiUartClearRxBuffer( void );
+void SPI_SpiUartClearTxBuffer( void );
+
+#endif
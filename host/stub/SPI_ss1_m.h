@@ -0,0 +1,11 @@
+/**
+ * \file Host build replacement for the SCB slave select 1 pin API
+ */
+#if !defined(CY_PINS_SPI_ss1_m_H)
+#define CY_PINS_SPI_ss1_m_H
+
+#include <cytypes.h>
+
+uint8 SPI_ss1_m_Read( void );
+
+#endif
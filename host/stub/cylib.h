@@ -0,0 +1,29 @@
+/**
+ * \file Host build replacement for the Cypress cylib.h
+ *
+ * The delay functions advance the simulated time of the W5100 model, and
+ * the interrupt functions have no effect.
+ */
+#if !defined(CY_BOOT_CYLIB_H)
+#define CY_BOOT_CYLIB_H
+
+#include <string.h>
+#include <cytypes.h>
+
+#define CY_INT_NUMBER_MAX       ( 31u )
+
+void CyDelay( uint32 milliseconds );
+void CyDelayUs( uint16 microseconds );
+void CyDelayCycles( uint32 cycles );
+uint8 CyEnterCriticalSection( void );
+void CyExitCriticalSection( uint8 savedIntrStatus );
+cyisraddress CyIntSetVector( uint8 number, cyisraddress address );
+void CyIntEnable( uint8 number );
+void CyIntDisable( uint8 number );
+void CyIntSetPriority( uint8 number, uint8 priority );
+void CyIntClearPending( uint8 number );
+
+#define CyGlobalIntEnable
+#define CyGlobalIntDisable
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * \file Host build replacement for the Cypress cytypes.h
+ *
+ * Only the types and macros used by the W5100 component are defined.
+ */
+#if !defined(CY_BOOT_CYTYPES_H)
+#define CY_BOOT_CYTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+typedef volatile uint8  reg8;
+typedef volatile uint16 reg16;
+typedef volatile uint32 reg32;
+typedef uint32 cystatus;
+typedef void (*cyisraddress)(void);
+
+#define CY_ISR(name)            void name(void)
+#define CY_ISR_PROTO(name)      void name(void)
+
+#define CYRET_SUCCESS           ( 0x00u )
+#define CYRET_BAD_PARAM         ( 0x01u )
+#define CYRET_INVALID_OBJECT    ( 0x02u )
+#define CYRET_MEMORY            ( 0x03u )
+#define CYRET_LOCKED            ( 0x04u )
+#define CYRET_EMPTY             ( 0x05u )
+#define CYRET_BAD_DATA          ( 0x06u )
+#define CYRET_STARTED           ( 0x07u )
+#define CYRET_FINISHED          ( 0x08u )
+#define CYRET_CANCELED          ( 0x09u )
+#define CYRET_TIMEOUT           ( 0x10u )
+#define CYRET_INVALID_STATE     ( 0x11u )
+#define CYRET_UNKNOWN           ( (cystatus)0xFFFFFFFFu )
+
+#define LO8(x)                  ( (uint8)((x) & 0xFFu) )
+#define HI8(x)                  ( (uint8)((uint16)(x) >> 8) )
+#define LO16(x)                 ( (uint16)((x) & 0xFFFFu) )
+#define HI16(x)                 ( (uint16)((uint32)(x) >> 16) )
+
+/* the host build models the PSoC 5LP */
+#define CY_PSOC3                ( 0 )
+#define CY_PSOC4                ( 0 )
+#define CY_PSOC5LP              ( 1 )
+
+#define CYCODE
+#define CYDATA
+#define CYXDATA
+#define CYREENTRANT
+#define CY_INLINE               inline
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * \file Host build replacement for the PSoC Creator project.h
+ *
+ * Includes the component APIs used by the example application.
+ */
+#include <cytypes.h>
+#include <cylib.h>
+#include <SPIM.h>
+#include <SPI.h>
+#include <W5100.h>
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Substitute the component parameters in a W5100 API template, in the same
+# way as PSoC Creator when it generates the component source.  The values
+# are those of the example projects.
+#
+# usage: subst.sh <SPI instance name> <template> <output>
+sed -e 's/`\$INSTANCE_NAME`/W5100/g' \
+	-e "s/\`\\\$SPI_INSTANCE\`/$1/g" \
+	-e 's/`\$INCLUDE_TCP`/1/g' \
+	-e 's/`\$INCLUDE_UDP`/1/g' \
+	-e 's/`\$CMD_TIMEOUT`/125/g' \
+	-e 's/`\$TIMEOUT`/3000/g' \
+	-e 's/`\$INIT_DELAY`/10/g' \
+	-e 's/`\$SS_NUM`/1/g' \
+	-e 's/`\$MAC`/00-DE-AD-BE-EF-00/g' \
+	-e 's/`\$IP`/192.168.1.101/g' \
+	-e 's/`\$SUBNET_MASK`/255.255.255.0/g' \
+	-e 's/`\$GATEWAY`/192.168.1.1/g' \
+	-e 's/`\$CY_MAJOR_VERSION`/1/g' \
+	-e 's/`\$CY_MINOR_VERSION`/3/g' \
+	-e 's/`#START[^`]*`//g' \
+	-e 's/`#END`//g' \
+	"$2" > "$3"
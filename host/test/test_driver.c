@@ -0,0 +1,596 @@
+/**
+ * \file Functional tests of the W5100 driver against the host model
+ * \author Chuck Erhardt (chuck@e2forlife.com)
+ *
+ * Each test starts the driver on a freshly reset model, and fails when a
+ * check fails, when the driver does not return within 10 seconds of
+ * simulated time, or when the model has seen a framing error, a Rx FIFO
+ * overrun or a write over unsent data.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <W5100.h>
+#include <SPIM.h>
+#include <SPI.h>
+#include "w51sim.h"
+#include "peer.h"
+
+#define TEST_DEADLINE            ( 10000000000ull )
+
+typedef void (*TEST_FUNCTION)( void );
+
+static jmp_buf Test_Escape;
+static int Test_Failed;
+
+static const uint8 Test_ClientIp[4] = { 192, 168, 1, 20 };
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			++Test_Failed; \
+		} \
+	} while (0)
+/* ------------------------------------------------------------------------ */
+static void Test_Fill( uint8* buffer, uint16 length, uint8 seed )
+{
+	uint16 index;
+
+	for(index=0;index<length;++index) {
+		buffer[index] = (uint8)((index * 7) + seed);
+	}
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Wait for the peer to complete the SENDs in progress
+ */
+static void Test_Settle( void )
+{
+	CyDelay(1);
+}
+/* ------------------------------------------------------------------------ */
+/**
+ * \brief Open a TCP server socket and connect the peer to it
+ */
+static uint8 Test_Connect( uint16 port )
+{
+	uint8 socket;
+
+	socket = W5100_TcpOpen(port);
+	CHECK(socket < 4);
+	if (socket < 4) {
+		W5100_TcpStartServer(socket);
+		CHECK(Peer_Accept(socket, Test_ClientIp, 40000) != 0);
+		CHECK(W5100_TcpConnected(socket) != 0);
+	}
+	return( socket );
+}
+/* ======================================================================== */
+/* Tests */
+/* ------------------------------------------------------------------------ */
+static void Test_Start( void )
+{
+	static const uint8 ip[4] = { 192, 168, 1, 101 };
+	static const uint8 gateway[4] = { 192, 168, 1, 1 };
+	static const uint8 mac[6] = { 0x00, 0xDE, 0xAD, 0xBE, 0xEF, 0x00 };
+	uint8 index;
+
+	for(index=0;index<4;++index) {
+		CHECK(W51Sim_Peek(0x000F + index) == ip[index]);
+		CHECK(W51Sim_Peek(0x0001 + index) == gateway[index]);
+		/* the subnet mask is cleared, for the errata */
+		CHECK(W51Sim_Peek(0x0005 + index) == 0);
+	}
+	for(index=0;index<6;++index) {
+		CHECK(W51Sim_Peek(0x0009 + index) == mac[index]);
+	}
+	CHECK(W51Sim_Peek(0x001A) == W5100_RX_MEMORY);
+	CHECK(W51Sim_Peek(0x001B) == W5100_TX_MEMORY);
+	CHECK(W5100_GetIP() == W5100_IPADDRESS(192,168,1,101));
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpServer( void )
+{
+	uint8 socket;
+	uint8 buffer[32];
+	uint16 length;
+
+	socket = Test_Connect(23);
+	CHECK(socket == 0);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_ESTABLISHED);
+
+	length = W5100_TcpSend(socket, (uint8*)"hello", 5);
+	CHECK(length == 5);
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == 5);
+	CHECK(memcmp(buffer, "hello", 5) == 0);
+
+	CHECK(Peer_Write(socket, (const uint8*)"world", 5) == 5);
+	memset(buffer, 0, sizeof(buffer));
+	length = W5100_TcpReceive(socket, buffer, sizeof(buffer));
+	CHECK(length == 5);
+	CHECK(memcmp(buffer, "world", 5) == 0);
+	CHECK(W5100_SocketRxDataWaiting(socket) == 0);
+
+	W5100_TcpDisconnect(socket);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_CLOSED);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpBulk( void )
+{
+	static uint8 data[4096];
+	static uint8 check[4096];
+	uint8 socket;
+	uint16 offset;
+	uint16 length;
+	uint16 total;
+
+	socket = Test_Connect(80);
+	/* send 4K in pieces which wrap the 2K transmit ring */
+	Test_Fill(data, sizeof(data), 3);
+	for(offset=0;offset<sizeof(data);offset+=1000) {
+		length = ((sizeof(data) - offset) > 1000) ? 1000 : (sizeof(data) - offset);
+		CHECK(W5100_TcpSend(socket, &data[offset], length) == length);
+	}
+	Test_Settle();
+	CHECK(Peer_Read(socket, check, sizeof(check)) == sizeof(check));
+	CHECK(memcmp(data, check, sizeof(data)) == 0);
+
+	/* receive 4K in pieces which wrap the 2K receive ring */
+	Test_Fill(data, sizeof(data), 11);
+	memset(check, 0, sizeof(check));
+	offset = 0;
+	total = 0;
+	while (total < sizeof(data)) {
+		if (offset < sizeof(data)) {
+			offset += Peer_Write(socket, &data[offset], ((sizeof(data) - offset) > 700) ? 700 : (sizeof(data) - offset));
+		}
+		length = W5100_TcpReceive(socket, &check[total], 500);
+		total += length;
+		if ( (length == 0) && (offset >= sizeof(data)) ) {
+			break;
+		}
+	}
+	CHECK(total == sizeof(data));
+	CHECK(memcmp(data, check, sizeof(data)) == 0);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpClient( void )
+{
+	uint8 socket;
+
+	socket = W5100_TcpOpen(0);
+	CHECK(socket < 4);
+	CHECK(W5100_TcpConnect(socket, W5100_IPADDRESS(192,168,1,50), 8080) == W5100_CONNECT_ESTABLISHED);
+	CHECK(W5100_TcpConnected(socket) != 0);
+	CHECK(W51Sim_Peek(0x040C + (socket<<8)) == 192);
+	CHECK(W51Sim_Peek(0x040F + (socket<<8)) == 50);
+	W5100_SocketClose(socket);
+
+	/* a refused connection times out */
+	Peer_Refuse(1);
+	socket = W5100_TcpOpen(0);
+	CHECK(W5100_TcpConnect(socket, W5100_IPADDRESS(192,168,1,50), 8080) != W5100_CONNECT_ESTABLISHED);
+	CHECK(W5100_TcpConnected(socket) == 0);
+	W5100_SocketClose(socket);
+	Peer_Refuse(0);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpRemoteClose( void )
+{
+	uint8 socket;
+	uint8 buffer[8];
+
+	socket = Test_Connect(23);
+	CHECK(Peer_Write(socket, (const uint8*)"bye", 3) == 3);
+	Peer_Close(socket);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_CLOSE_WAIT);
+	/* data received before the remote closed may still be read */
+	CHECK(W5100_TcpReceive(socket, buffer, sizeof(buffer)) == 3);
+	CHECK(W5100_SocketProcessConnections(socket) != 0);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_CLOSED);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpRemoteReset( void )
+{
+	uint8 socket;
+	uint8 buffer[8];
+
+	socket = Test_Connect(23);
+	CHECK(Peer_Write(socket, (const uint8*)"dropped", 7) == 7);
+	/* with a receive threshold, the RECV of these bytes is still pending */
+	CHECK(W5100_TcpReceive(socket, buffer, 4) == 4);
+	/* the device drops the received data along with the connection */
+	Peer_Reset(socket);
+	CHECK(W5100_SocketRxDataWaiting(socket) == 0);
+	CHECK(W5100_TcpReceive(socket, buffer, sizeof(buffer)) == 0);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_Udp( void )
+{
+	static const uint8 remote[4] = { 192, 168, 1, 77 };
+	uint8 socket;
+	uint8 buffer[64];
+	uint8 ip[4];
+	uint16 port;
+	uint32 from;
+	uint16 length;
+
+	socket = W5100_UdpOpen(5000);
+	CHECK(socket < 4);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_UDP);
+
+	length = W5100_UdpSend(socket, W5100_IPADDRESS(192,168,1,77), 6000, (uint8*)"datagram", 8);
+	CHECK(length == 8);
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == 8);
+	CHECK(memcmp(buffer, "datagram", 8) == 0);
+	Peer_LastDestination(socket, ip, &port);
+	CHECK(memcmp(ip, remote, 4) == 0);
+	CHECK(port == 6000);
+
+	CHECK(Peer_WriteUdp(socket, remote, 7000, (const uint8*)"reply", 5) == 5);
+	memset(buffer, 0, sizeof(buffer));
+	from = 0;
+	port = 0;
+	length = W5100_UdpReceive(socket, &from, &port, buffer, sizeof(buffer));
+	CHECK(length == 5);
+	CHECK(memcmp(buffer, "reply", 5) == 0);
+	CHECK(from == W5100_IPADDRESS(192,168,1,77));
+	CHECK(port == 7000);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_UdpBackToBack( void )
+{
+	static const uint8 remote[4] = { 192, 168, 1, 78 };
+	uint8 socket;
+	uint8 data[2100];
+	uint8 buffer[2100];
+	uint8 ip[4];
+	uint16 port;
+
+	socket = W5100_UdpOpen(5000);
+	CHECK(socket < 4);
+	Test_Fill(data, sizeof(data), 9);
+	/*
+	 * The second packet is sent while the first may still be in progress,
+	 * and together they do not fit in the transmit buffer.
+	 */
+	CHECK(W5100_UdpSend(socket, W5100_IPADDRESS(192,168,1,77), 6000, data, 1500) == 1500);
+	CHECK(W5100_UdpSend(socket, W5100_IPADDRESS(192,168,1,78), 6001, &data[1500], 600) == 600);
+	Test_Settle();
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == sizeof(data));
+	CHECK(memcmp(buffer, data, sizeof(data)) == 0);
+	Peer_LastDestination(socket, ip, &port);
+	CHECK(memcmp(ip, remote, 4) == 0);
+	CHECK(port == 6001);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_AllSockets( void )
+{
+	uint8 socket[4];
+	uint8 index;
+
+	for(index=0;index<4;++index) {
+		socket[index] = W5100_TcpOpen(1000 + index);
+		CHECK(socket[index] == index);
+	}
+	/* there are only four sockets */
+	CHECK(W5100_TcpOpen(2000) == 0xFF);
+	for(index=0;index<4;++index) {
+		W5100_SocketClose(socket[index]);
+	}
+	CHECK(W5100_TcpOpen(2000) == 0);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_SocketMemory( void )
+{
+	static const uint8 layout = W5100_MEMORY(W5100_MEM_8K, W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K);
+	uint8 socket;
+	uint8 data[4000];
+	uint8 buffer[4000];
+
+	/* socket 0 takes all of the memory, the others are left without any */
+	CHECK(W5100_SetSocketMemory(layout, layout) == CYRET_SUCCESS);
+	CHECK(W51Sim_Peek(0x001A) == layout);
+	CHECK(W51Sim_Peek(0x001B) == layout);
+	socket = Test_Connect(23);
+	CHECK(socket == 0);
+	CHECK(W5100_TcpOpen(24) == 0xFF);
+	Test_Fill(data, sizeof(data), 11);
+	CHECK(W5100_TcpSend(socket, data, sizeof(data)) == sizeof(data));
+	Test_Settle();
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == sizeof(data));
+	CHECK(memcmp(buffer, data, sizeof(data)) == 0);
+	/* the memory may not be re-assigned while a socket is open */
+	CHECK(W5100_SetSocketMemory(W5100_TX_MEMORY, W5100_RX_MEMORY) == CYRET_INVALID_STATE);
+	W5100_SocketClose(socket);
+	CHECK(W5100_SetSocketMemory(W5100_TX_MEMORY, W5100_RX_MEMORY) == CYRET_SUCCESS);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_TcpPrintf( void )
+{
+	static const uint8 layout = W5100_MEMORY(W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K);
+	uint8 socket;
+	char text[0x0400 + 1];
+	uint8 buffer[0x0400];
+	uint16 index;
+
+	/* a string filling the whole 1K buffer is sent, rather than staged */
+	CHECK(W5100_SetSocketMemory(layout, layout) == CYRET_SUCCESS);
+	socket = Test_Connect(23);
+	for(index=0;index<0x0400;++index) {
+		text[index] = 'a' + (index % 26);
+	}
+	text[0x0400] = 0;
+	CHECK(W5100_TcpPrintf(socket, "%s", text) == 0x0400);
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == 0x0400);
+	CHECK(memcmp(buffer, text, 0x0400) == 0);
+
+	CHECK(W5100_TcpPrintf(socket, "<%5d|%-4s|%.3s>", 42, "ab", "xyzw") == 16);
+#if (W5100_COALESCE)
+	W5100_TcpFlush(socket);
+#endif
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == 16);
+	CHECK(memcmp(buffer, "<   42|ab  |xyz>", 16) == 0);
+
+	/* the integer precision is the minimum number of digits */
+	CHECK(W5100_TcpPrintf(socket, "<%.3d|%.0d|%5.2x|%-6.3d|%.3u>", 7, 0, 10, -5, 1234u) == 24);
+#if (W5100_COALESCE)
+	W5100_TcpFlush(socket);
+#endif
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == 24);
+	CHECK(memcmp(buffer, "<007||   0a|-005  |1234>", 24) == 0);
+	W5100_SocketClose(socket);
+}
+/* ------------------------------------------------------------------------ */
+static void Test_CommandStart( void )
+{
+	static const uint8 refused[6] = {
+		W5100_CMD_OPEN, W5100_CMD_CLOSE, W5100_CMD_RECV,
+		W5100_CMD_SEND, W5100_CMD_SEND_MAC, W5100_CMD_CONNECT
+	};
+	uint8 socket;
+	uint8 index;
+
+	socket = Test_Connect(23);
+	/* the commands which keep driver state are refused, and not issued */
+	for(index=0;index<sizeof(refused);++index) {
+		CHECK(W5100_SocketCommandStart(socket, refused[index]) == CYRET_BAD_PARAM);
+	}
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_ESTABLISHED);
+	CHECK(W5100_SocketCommandStart(socket, W5100_CMD_SEND_KEEP) == CYRET_STARTED);
+	CHECK(W5100_SocketCommandStart(socket, W5100_CMD_DISCON) == CYRET_STARTED);
+	CHECK(W5100_SocketCommandDone(socket) != 0);
+	CHECK(W51Sim_Status(socket) == W51SIM_SOCK_CLOSED);
+	W5100_SocketClose(socket);
+}
+#if (W5100_STATS_ENABLE)
+/* ------------------------------------------------------------------------ */
+static void Test_BusStats( void )
+{
+	W5100_BUS_STATS bus;
+	W51SIM_STATS model;
+	uint8 socket;
+	uint8 data[600];
+
+	socket = Test_Connect(23);
+	Test_Fill(data, sizeof(data), 5);
+	W5100_ClearBusStats();
+	W51Sim_ClearStats();
+	W5100_TcpSend(socket, data, sizeof(data));
+	W5100_GetBusStats(&bus);
+	W51Sim_GetStats(&model);
+	/* the driver counts every frame that the device latched */
+	CHECK(bus.ReadFrames + bus.WriteFrames == model.ReadFrames + model.WriteFrames);
+	CHECK(bus.Bytes == model.Bytes);
+	W5100_SocketClose(socket);
+}
+#endif
+#if (W5100_POLL_ENABLE)
+/* ------------------------------------------------------------------------ */
+static uint8 Test_WritableCalls;
+static uint16 Test_WritableSize;
+
+static void Test_OnWritable( uint8 socket, uint16 length )
+{
+	(void)socket;
+	++Test_WritableCalls;
+	Test_WritableSize = length;
+}
+/* ------------------------------------------------------------------------ */
+static void Test_PollWritable( void )
+{
+	static const W5100_SOCKET_HANDLERS handlers = { NULL, NULL, Test_OnWritable, NULL, NULL };
+	uint8 socket;
+
+	socket = Test_Connect(23);
+	W5100_SetSocketHandlers(socket, &handlers);
+	W5100_Poll();
+	Test_WritableCalls = 0;
+	CHECK(W5100_TcpSend(socket, (uint8*)"hello", 5) == 5);
+	Test_Settle();
+	W5100_Poll();
+	/* called once for the SEND, whether or not the send waited for it */
+	CHECK(Test_WritableCalls == 1);
+	/* the default layout gives each socket 2K */
+	CHECK(Test_WritableSize == 0x0800);
+	W5100_Poll();
+	CHECK(Test_WritableCalls == 1);
+	W5100_SetSocketHandlers(socket, NULL);
+	W5100_SocketClose(socket);
+}
+#endif
+#if (W5100_COALESCE)
+/* ------------------------------------------------------------------------ */
+static void Test_CoalesceSend( void )
+{
+	static const W5100_IOVEC iov[2] = { { (uint8*)"ab", 2 }, { (uint8*)"cd", 2 } };
+	uint8 socket;
+	uint8 data[0x0800];
+	uint8 buffer[0x0800 + 5];
+
+	socket = Test_Connect(23);
+	Test_Fill(data, sizeof(data), 7);
+	/* the staged byte and a full buffer do not fit together */
+	W5100_TcpPrint(socket, "x");
+	CHECK(W5100_TcpSend(socket, data, sizeof(data)) == sizeof(data));
+	Test_Settle();
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == sizeof(data) + 1);
+	CHECK(buffer[0] == 'x');
+	CHECK(memcmp(&buffer[1], data, sizeof(data)) == 0);
+	/* the same for the list of segments, with most of the buffer staged */
+	CHECK(W5100_TcpQueue(socket, data, sizeof(data) - 2) == sizeof(data) - 2);
+	CHECK(W5100_TcpSendv(socket, iov, 2) == 4);
+	Test_Settle();
+	Test_Settle();
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == sizeof(data) + 2);
+	CHECK(memcmp(&buffer[sizeof(data) - 2], "abcd", 4) == 0);
+	W5100_SocketClose(socket);
+}
+#endif
+#if (W5100_ADAPTIVE_RTO)
+/* ------------------------------------------------------------------------ */
+static void Test_AdaptiveRto( void )
+{
+	uint8 udp;
+	uint8 tcp;
+	uint16 retry;
+
+	retry = W5100_GetRetryTime();
+	/* the SEND_OK of a UDP packet is not acknowledged by the peer */
+	udp = W5100_UdpOpen(5000);
+	CHECK(W5100_UdpSend(udp, W5100_IPADDRESS(192,168,1,77), 6000, (uint8*)"datagram", 8) == 8);
+	CHECK(W5100_GetRetryTime() == retry);
+	/* a TCP send on the LAN brings the retry time down to the minimum */
+	tcp = Test_Connect(23);
+	CHECK(W5100_TcpSend(tcp, (uint8*)"hello", 5) == 5);
+	CHECK(W5100_GetRetryTime() == W5100_RTO_MIN);
+	W5100_SocketClose(tcp);
+	W5100_SocketClose(udp);
+}
+#endif
+#if (W5100_MEM_PROFILE) && (W5100_ASYNC_SEND)
+/* ------------------------------------------------------------------------ */
+static void Test_Rebalance( void )
+{
+	uint8 socket;
+	uint8 data[2048];
+
+	/* the profile is kept over restarts of the driver */
+	W5100_ClearMemoryProfile();
+	socket = Test_Connect(23);
+	Test_Fill(data, sizeof(data), 1);
+	/* fill the transmit buffer, then ask for another 2K behind it */
+	Peer_HoldSend(socket, 1);
+	CHECK(W5100_TcpWrite(socket, data, sizeof(data)) == sizeof(data));
+	CHECK(W5100_TcpWrite(socket, data, sizeof(data)) == 0);
+	W5100_SocketClose(socket);
+	/* only socket 0 carried data, so it can be given all of the memory */
+	CHECK(W5100_RebalanceMemory() == CYRET_SUCCESS);
+	CHECK(W51Sim_Peek(0x001B) == W5100_MEMORY(W5100_MEM_8K, W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K));
+	CHECK(W51Sim_Peek(0x001A) == W5100_MEMORY(W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K, W5100_MEM_1K));
+}
+#endif
+#if (W5100_ASYNC_SEND)
+/* ------------------------------------------------------------------------ */
+static void Test_TcpWriteBehind( void )
+{
+	uint8 socket;
+	uint8 data[300];
+	uint8 buffer[300];
+
+	socket = Test_Connect(23);
+	Test_Fill(data, sizeof(data), 3);
+	Peer_HoldSend(socket, 1);
+	CHECK(W5100_TcpWrite(socket, data, 100) == 100);
+	/* copied behind the SEND in progress, rather than refused */
+	CHECK(W5100_TcpWrite(socket, &data[100], 200) == 200);
+	CHECK(W5100_SocketSendDone(socket) == 0);
+	Peer_HoldSend(socket, 0);
+	Test_Settle();
+	/* the first SEND completed, so the copied data is sent */
+	CHECK(W5100_SocketSendDone(socket) == 0);
+	Test_Settle();
+	CHECK(W5100_SocketSendDone(socket) != 0);
+	CHECK(Peer_Read(socket, buffer, sizeof(buffer)) == sizeof(data));
+	CHECK(memcmp(buffer, data, sizeof(data)) == 0);
+	W5100_SocketClose(socket);
+}
+#endif
+/* ======================================================================== */
+/* Runner */
+/* ------------------------------------------------------------------------ */
+static void Test_Run( const char* name, TEST_FUNCTION test )
+{
+	W51SIM_STATS stats;
+	int failed;
+
+	failed = Test_Failed;
+	W51Sim_Init(Peer_Init());
+	SPIM_initVar = 0;
+	SPI_initVar = 0;
+	if (setjmp(Test_Escape) == 0) {
+		W51Sim_SetDeadline(TEST_DEADLINE, &Test_Escape);
+		W5100_Start();
+		test();
+		W51Sim_SetDeadline(0, NULL);
+	}
+	else {
+		printf("  did not return within the deadline\n");
+		++Test_Failed;
+	}
+	W51Sim_GetStats(&stats);
+	CHECK(stats.FrameErrors == 0);
+	CHECK(stats.Overruns == 0);
+	CHECK(stats.Hazards == 0);
+	printf("%s %s\n", (failed == Test_Failed) ? "PASS" : "FAIL", name);
+}
+/* ------------------------------------------------------------------------ */
+int main( void )
+{
+	Test_Run("start", Test_Start);
+	Test_Run("tcp_server", Test_TcpServer);
+	Test_Run("tcp_bulk", Test_TcpBulk);
+	Test_Run("tcp_client", Test_TcpClient);
+	Test_Run("tcp_remote_close", Test_TcpRemoteClose);
+	Test_Run("tcp_remote_reset", Test_TcpRemoteReset);
+	Test_Run("udp", Test_Udp);
+	Test_Run("udp_back_to_back", Test_UdpBackToBack);
+	Test_Run("all_sockets", Test_AllSockets);
+	Test_Run("socket_memory", Test_SocketMemory);
+	Test_Run("tcp_printf", Test_TcpPrintf);
+	Test_Run("command_start", Test_CommandStart);
+#if (W5100_STATS_ENABLE)
+	Test_Run("bus_stats", Test_BusStats);
+#endif
+#if (W5100_POLL_ENABLE)
+	Test_Run("poll_writable", Test_PollWritable);
+#endif
+#if (W5100_COALESCE)
+	Test_Run("coalesce_send", Test_CoalesceSend);
+#endif
+#if (W5100_ADAPTIVE_RTO)
+	Test_Run("adaptive_rto", Test_AdaptiveRto);
+#endif
+#if (W5100_MEM_PROFILE) && (W5100_ASYNC_SEND)
+	Test_Run("rebalance", Test_Rebalance);
+#endif
+#if (W5100_ASYNC_SEND)
+	Test_Run("tcp_write_behind", Test_TcpWriteBehind);
+#endif
+
+	return( (Test_Failed == 0) ? 0 : 1 );
+}